@@ -1,3 +1,2 @@
 #define max_point_light_count 15
-#define max_point_light_geom_vertices 90
-#define mesh_per_drawcall_max_instance_count 64
\ No newline at end of file
+#define max_point_light_geom_vertices 90
\ No newline at end of file
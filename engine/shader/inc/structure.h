@@ -1,3 +1,62 @@
 struct MeshInstance {
-    mat4 model_matrix;
+    float model_rows[12];
+    uint  material_index;
+};
+
+mat4 instanceModelMatrix(MeshInstance instance) {
+    vec4 row_0 = vec4(instance.model_rows[0], instance.model_rows[1], instance.model_rows[2], instance.model_rows[3]);
+    vec4 row_1 = vec4(instance.model_rows[4], instance.model_rows[5], instance.model_rows[6], instance.model_rows[7]);
+    vec4 row_2 = vec4(instance.model_rows[8], instance.model_rows[9], instance.model_rows[10], instance.model_rows[11]);
+    return transpose(mat4(row_0, row_1, row_2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+struct MeshMaterial {
+    vec4  base_color_factor;
+    float metallic_factor;
+    float roughness_factor;
+    float normal_scale;
+    float occlusion_strength;
+    vec3  emissive_factor;
+    uint  is_blend;
+    uint  is_double_sided;
+    uint  base_color_texture_index;
+    uint  metallic_roughness_texture_index;
+    uint  normal_texture_index;
+    uint  occlusion_texture_index;
+    uint  emissive_texture_index;
+    uint  _padding_emissive_texture_index_1;
+    uint  _padding_emissive_texture_index_2;
+};
+
+struct GpuCullObject {
+    vec4 center;
+    vec4 half_extent;
+    uint mesh_draw_index;
+    uint _padding_mesh_draw_index_1;
+    uint _padding_mesh_draw_index_2;
+    uint _padding_mesh_draw_index_3;
+};
+
+struct GpuCullMesh {
+    uint index_count;
+    uint first_index;
+    int  vertex_offset;
+    uint command_index;
+    uint instance_base;
+    uint _padding_instance_base_1;
+    uint _padding_instance_base_2;
+    uint _padding_instance_base_3;
+};
+
+struct DrawIndexedIndirectCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int  vertex_offset;
+    uint first_instance;
+};
+
+struct OcclusionCullCandidate {
+    vec4 center;
+    vec4 half_extent;
 };
\ No newline at end of file
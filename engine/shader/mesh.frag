@@ -1,8 +1,10 @@
 #version 460
 
 #extension GL_GOOGLE_include_directive: enable
+#extension GL_EXT_nonuniform_qualifier: require
 
 #include "inc/constants.h"
+#include "inc/structure.h"
 
 struct DirectionalLight {
     vec3  direction;
@@ -39,37 +41,31 @@ layout(set = 0, binding = 4) uniform samplerCube specular_sampler;
 layout(set = 0, binding = 5) uniform sampler2DArray point_lights_shadow;
 layout(set = 0, binding = 6) uniform sampler2D directional_light_shadow;
 
-layout(set = 1, binding = 0) uniform _per_material {
-    vec4  base_color_factor;
-    float metallic_factor;
-    float roughness_factor;
-    float normal_scale;
-    float occlusion_strength;
-    vec3  emissive_factor;
-    uint  is_blend;
-    uint  is_double_sided;
+layout(set = 1, binding = 0) readonly buffer _materials {
+    MeshMaterial materials[];
 };
 
-layout(set = 1, binding = 1) uniform sampler2D base_color_texture_sampler;
-layout(set = 1, binding = 2) uniform sampler2D metallic_roughness_texture_sampler;
-layout(set = 1, binding = 3) uniform sampler2D normal_texture_sampler;
-layout(set = 1, binding = 4) uniform sampler2D occlusion_texture_sampler;
-layout(set = 1, binding = 5) uniform sampler2D emissive_color_texture_sampler;
+layout(set = 1, binding = 1) uniform sampler2D textures[];
 
 layout(location = 0) in vec3 in_world_position;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec3 in_tangent;
 layout(location = 3) in vec2 in_texcoord;
+layout(location = 4) flat in uint in_material_index;
 
 layout(location = 0) out vec4 out_scene_color;
 
-vec3 getBaseColor() {
-    vec3 base_color = texture(base_color_texture_sampler, in_texcoord).xyz * base_color_factor.xyz;
+vec4 sampleMaterialTexture(uint texture_index) {
+    return texture(textures[nonuniformEXT(texture_index)], in_texcoord);
+}
+
+vec3 getBaseColor(MeshMaterial material) {
+    vec3 base_color = sampleMaterialTexture(material.base_color_texture_index).xyz * material.base_color_factor.xyz;
     return base_color;
 }
 
-vec3 calculateNormal() {
-    vec3 tangent_normal = texture(normal_texture_sampler, in_texcoord).xyz * 2.0 - 1.0;
+vec3 calculateNormal(MeshMaterial material) {
+    vec3 tangent_normal = sampleMaterialTexture(material.normal_texture_index).xyz * 2.0 - 1.0;
 
     vec3 N = in_normal;
     vec3 T = in_tangent;
@@ -82,11 +78,13 @@ vec3 calculateNormal() {
 #include "inc/mesh_lighting.h"
 
 void main() {
-    vec3  N                   = calculateNormal();
-    vec3  base_color          = getBaseColor();
-    float metallic            = texture(metallic_roughness_texture_sampler, in_texcoord).b * metallic_factor;
+    MeshMaterial material = materials[in_material_index];
+
+    vec3  N                   = calculateNormal(material);
+    vec3  base_color          = getBaseColor(material);
+    float metallic            = sampleMaterialTexture(material.metallic_roughness_texture_index).b * material.metallic_factor;
     float dielectric_specular = 0.04;
-    float roughness           = texture(metallic_roughness_texture_sampler, in_texcoord).g * roughness_factor;
+    float roughness           = sampleMaterialTexture(material.metallic_roughness_texture_index).g * material.roughness_factor;
 
     vec3 result_color;
 
@@ -34,8 +34,12 @@ layout(set = 0, binding = 0) readonly buffer _per_frame {
     mat4             directional_light_proj_view;
 };
 
-layout(set = 0, binding = 1) readonly buffer _per_drawcall {
-    MeshInstance mesh_instances[mesh_per_drawcall_max_instance_count];
+layout(set = 0, binding = 1) readonly buffer _instances {
+    MeshInstance mesh_instances[];
+};
+
+layout(set = 0, binding = 7) readonly buffer _instance_indices {
+    uint mesh_instance_indices[];
 };
 
 layout(location = 0) in vec3 in_position;
@@ -47,9 +51,11 @@ layout(location = 0) out vec3 out_world_position;
 layout(location = 1) out vec3 out_normal;
 layout(location = 2) out vec3 out_tangent;
 layout(location = 3) out vec2 out_texcoord;
+layout(location = 4) flat out uint out_material_index;
 
 void main() {
-    mat4 model_matrix = mesh_instances[gl_InstanceIndex].model_matrix;
+    MeshInstance instance = mesh_instances[mesh_instance_indices[gl_InstanceIndex]];
+    mat4 model_matrix = instanceModelMatrix(instance);
 
     out_world_position = (model_matrix * vec4(in_position, 1.0)).xyz;
 
@@ -60,4 +66,6 @@ void main() {
     out_tangent = normalize(tangent_matrix * in_tangent);
 
     out_texcoord = in_texcoord;
+
+    out_material_index = instance.material_index;
 }
\ No newline at end of file
@@ -9,14 +9,19 @@ layout(set = 0, binding = 0) readonly buffer _per_frame {
     mat4 light_proj_view;
 };
 
-layout(set = 0, binding = 1) readonly buffer _per_drawcall {
-    MeshInstance mesh_instances[mesh_per_drawcall_max_instance_count];
+layout(set = 0, binding = 1) readonly buffer _instances {
+    MeshInstance mesh_instances[];
+};
+
+layout(set = 0, binding = 2) readonly buffer _instance_indices {
+    uint mesh_instance_indices[];
 };
 
 layout(location = 0) in vec3 in_position;
 
 void main() {
-    mat4 model_matrix = mesh_instances[gl_InstanceIndex].model_matrix;
+    MeshInstance instance = mesh_instances[mesh_instance_indices[gl_InstanceIndex]];
+    mat4 model_matrix = instanceModelMatrix(instance);
 
     gl_Position = light_proj_view * model_matrix * vec4(in_position, 1.0);
 }
\ No newline at end of file
@@ -1,42 +1,38 @@
 #version 460
 
 #extension GL_GOOGLE_include_directive: enable
+#extension GL_EXT_nonuniform_qualifier: require
 
 #include "inc/gbuffer.h"
+#include "inc/structure.h"
 
-layout(set = 1, binding = 0) uniform _per_material {
-    vec4  base_color_factor;
-    float metallic_factor;
-    float roughness_factor;
-    float normal_scale;
-    float occlusion_strength;
-    vec3  emissive_factor;
-    uint  is_blend;
-    uint  is_double_sided;
+layout(set = 1, binding = 0) readonly buffer _materials {
+    MeshMaterial materials[];
 };
 
-layout(set = 1, binding = 1) uniform sampler2D base_color_texture_sampler;
-layout(set = 1, binding = 2) uniform sampler2D metallic_roughness_texture_sampler;
-layout(set = 1, binding = 3) uniform sampler2D normal_texture_sampler;
-layout(set = 1, binding = 4) uniform sampler2D occlusion_texture_sampler;
-layout(set = 1, binding = 5) uniform sampler2D emissive_color_texture_sampler;
+layout(set = 1, binding = 1) uniform sampler2D textures[];
 
 layout(location = 0) in vec3 in_world_position;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec3 in_tangent;
 layout(location = 3) in vec2 in_texcoord;
+layout(location = 4) flat in uint in_material_index;
 
 layout(location = 0) out vec4 out_gbuffer_a;
 layout(location = 1) out vec4 out_gbuffer_b;
 layout(location = 2) out vec4 out_gbuffer_c;
 
-vec3 getBaseColor() {
-    vec3 base_color = texture(base_color_texture_sampler, in_texcoord).xyz * base_color_factor.xyz;
+vec4 sampleMaterialTexture(uint texture_index) {
+    return texture(textures[nonuniformEXT(texture_index)], in_texcoord);
+}
+
+vec3 getBaseColor(MeshMaterial material) {
+    vec3 base_color = sampleMaterialTexture(material.base_color_texture_index).xyz * material.base_color_factor.xyz;
     return base_color;
 }
 
-vec3 calculateNormal() {
-    vec3 tangent_normal = texture(normal_texture_sampler, in_texcoord).xyz * 2.0 - 1.0;
+vec3 calculateNormal(MeshMaterial material) {
+    vec3 tangent_normal = sampleMaterialTexture(material.normal_texture_index).xyz * 2.0 - 1.0;
 
     vec3 N = in_normal;
     vec3 T = in_tangent;
@@ -47,12 +43,14 @@ vec3 calculateNormal() {
 }
 
 void main() {
+    MeshMaterial material = materials[in_material_index];
+
     PGBufferData gbuffer;
-    gbuffer.world_normal     = calculateNormal();
-    gbuffer.base_color       = getBaseColor();
-    gbuffer.metallic         = texture(metallic_roughness_texture_sampler, in_texcoord).b * metallic_factor;
+    gbuffer.world_normal     = calculateNormal(material);
+    gbuffer.base_color       = getBaseColor(material);
+    gbuffer.metallic         = sampleMaterialTexture(material.metallic_roughness_texture_index).b * material.metallic_factor;
     gbuffer.specular         = 0.5;
-    gbuffer.roughness        = texture(metallic_roughness_texture_sampler, in_texcoord).g * roughness_factor;
+    gbuffer.roughness        = sampleMaterialTexture(material.metallic_roughness_texture_index).g * material.roughness_factor;
     gbuffer.shading_model_id = SHADING_MODEL_ID_DEFAULT_LIT;
 
     encodeGBufferData(gbuffer, out_gbuffer_a, out_gbuffer_b, out_gbuffer_c);
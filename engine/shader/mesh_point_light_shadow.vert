@@ -5,16 +5,24 @@
 #include "inc/constants.h"
 #include "inc/structure.h"
 
-layout(set = 0, binding = 1) readonly buffer _per_drawcall {
-    MeshInstance mesh_instances[mesh_per_drawcall_max_instance_count];
+layout(set = 0, binding = 1) readonly buffer _instances {
+    MeshInstance mesh_instances[];
+};
+
+// pairs of instance index and point light mask
+layout(set = 0, binding = 2) readonly buffer _instance_indices {
+    uint mesh_instance_indices[];
 };
 
 layout(location = 0) in vec3 in_position;
 
 layout(location = 0) out vec3 out_position_world_space;
+layout(location = 1) flat out uint out_point_light_mask;
 
 void main() {
-    mat4 model_matrix = mesh_instances[gl_InstanceIndex].model_matrix;
+    MeshInstance instance = mesh_instances[mesh_instance_indices[2 * gl_InstanceIndex]];
+    mat4 model_matrix = instanceModelMatrix(instance);
 
     out_position_world_space = (model_matrix * vec4(in_position, 1.0)).xyz;
+    out_point_light_mask = mesh_instance_indices[2 * gl_InstanceIndex + 1];
 }
\ No newline at end of file
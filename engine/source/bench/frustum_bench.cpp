@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/math/frustum.h"
+
+using namespace Vain;
+
+// times the batch frustum test on every code path the cpu supports against the per
+// entity test, over random boxes around a camera, and fails unless all of them agree
+// on every box. usage: VainFrustumBench [box count] [repeat count]
+
+static constexpr uint32_t k_seed = 1234;
+
+static AxisAlignedBoundingBoxArray randomBoxes(size_t count) {
+    std::mt19937 rng{k_seed};
+    std::uniform_real_distribution<float> position{-200.0f, 200.0f};
+    std::uniform_real_distribution<float> extent{0.1f, 4.0f};
+
+    AxisAlignedBoundingBoxArray aabbs{};
+    aabbs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        AxisAlignedBoundingBox aabb{};
+        aabb.center = {position(rng), position(rng), position(rng)};
+        aabb.half_extent = {extent(rng), extent(rng), extent(rng)};
+        aabbs.push_back(aabb);
+    }
+    return aabbs;
+}
+
+static void intersectPerEntity(
+    const Frustum &frustum,
+    const AxisAlignedBoundingBoxArray &aabbs,
+    std::vector<uint64_t> &visibility
+) {
+    visibility.assign((aabbs.size() + 63) / 64, 0);
+    for (size_t i = 0; i < aabbs.size(); ++i) {
+        AxisAlignedBoundingBox aabb{};
+        aabb.center = {aabbs.center_x[i], aabbs.center_y[i], aabbs.center_z[i]};
+        aabb.half_extent = {
+            aabbs.half_extent_x[i], aabbs.half_extent_y[i], aabbs.half_extent_z[i]
+        };
+        if (frustum.intersect(aabb)) {
+            visibility[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+}
+
+// best of repeat_count runs, in nanoseconds per box
+template <typename Function>
+static double timeBest(size_t box_count, uint32_t repeat_count, Function &&function) {
+    double best = 0.0;
+    for (uint32_t i = 0; i < repeat_count; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+
+        double time = std::chrono::duration<double, std::nano>(end - begin).count();
+        if (i == 0 || time < best) {
+            best = time;
+        }
+    }
+    return best / static_cast<double>(box_count);
+}
+
+static size_t countVisible(const std::vector<uint64_t> &visibility) {
+    size_t count = 0;
+    for (uint64_t word : visibility) {
+        for (; word; word &= word - 1) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    // an odd count leaves a scalar tail behind the simd paths
+    size_t box_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100003;
+    uint32_t repeat_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+    if (box_count == 0 || repeat_count == 0) {
+        std::fprintf(stderr, "usage: %s [box count] [repeat count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    AxisAlignedBoundingBoxArray aabbs = randomBoxes(box_count);
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+    glm::mat4 view = glm::lookAt(
+        glm::vec3{10.0f, 5.0f, -20.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}
+    );
+    Frustum frustum{proj * view, -1.0, 1.0, -1.0, 1.0, 0.0, 1.0};
+
+    std::vector<uint64_t> reference{};
+    double per_entity_time = timeBest(box_count, repeat_count, [&]() {
+        intersectPerEntity(frustum, aabbs, reference);
+    });
+    std::printf(
+        "%zu boxes, %zu visible\n%-12s %8.3f ns per box\n",
+        box_count,
+        countVisible(reference),
+        "per entity",
+        per_entity_time
+    );
+
+    struct PathInfo {
+        FrustumIntersectPath path;
+        const char *name;
+    };
+    const PathInfo paths[] = {
+        {FrustumIntersectPath::SCALAR, "scalar"},
+        {FrustumIntersectPath::SSE, "sse"},
+        {FrustumIntersectPath::AVX2, "avx2"},
+        {FrustumIntersectPath::AUTOMATIC, "automatic"},
+    };
+
+    bool identical = true;
+    std::vector<uint64_t> visibility{};
+    for (const PathInfo &info : paths) {
+        if (!Frustum::intersectPathSupported(info.path)) {
+            std::printf("%-12s unsupported\n", info.name);
+            continue;
+        }
+
+        double time = timeBest(box_count, repeat_count, [&]() {
+            frustum.intersect(aabbs, visibility, info.path);
+        });
+
+        bool match = visibility == reference;
+        identical = identical && match;
+        std::printf(
+            "%-12s %8.3f ns per box, %.2fx%s\n",
+            info.name,
+            time,
+            per_entity_time / time,
+            match ? "" : ", MISMATCH"
+        );
+    }
+
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "function/render/software_occlusion.h"
+
+using namespace Vain;
+
+// rasterizes the occluder proxy of test meshes and the meshes themselves from a fixed
+// set of views, and fails if the proxy covers a pixel the mesh doesn't or lies in
+// front of it anywhere. prints how much of the mesh coverage the proxies keep
+
+static constexpr float k_depth_epsilon = 1e-5f;
+
+using Solid = std::function<bool(int32_t x, int32_t y, int32_t z)>;
+
+// boundary faces of the solid voxels in [0, size), welded so the mesh is closed
+static MeshData voxelMesh(const glm::ivec3 &size, const Solid &solid) {
+    MeshData data{};
+    std::map<std::tuple<int32_t, int32_t, int32_t>, uint32_t> corner_to_vertex;
+    auto vertex = [&](const glm::ivec3 &corner) {
+        auto key = std::make_tuple(corner.x, corner.y, corner.z);
+        auto [iter, inserted] =
+            corner_to_vertex.emplace(key, uint32_t(data.vertices.size()));
+        if (inserted) {
+            MeshVertex mesh_vertex{};
+            mesh_vertex.position = glm::vec3{corner};
+            data.vertices.push_back(mesh_vertex);
+            data.aabb.merge(mesh_vertex.position);
+        }
+        return iter->second;
+    };
+    auto filled = [&](const glm::ivec3 &voxel) {
+        return glm::all(glm::greaterThanEqual(voxel, glm::ivec3{0})) &&
+               glm::all(glm::lessThan(voxel, size)) && solid(voxel.x, voxel.y, voxel.z);
+    };
+
+    for (int32_t z = 0; z < size.z; ++z) {
+        for (int32_t y = 0; y < size.y; ++y) {
+            for (int32_t x = 0; x < size.x; ++x) {
+                glm::ivec3 voxel{x, y, z};
+                if (!filled(voxel)) {
+                    continue;
+                }
+                for (int32_t axis = 0; axis < 3; ++axis) {
+                    for (int32_t side = 0; side < 2; ++side) {
+                        glm::ivec3 neighbor = voxel;
+                        neighbor[axis] += side ? 1 : -1;
+                        if (filled(neighbor)) {
+                            continue;
+                        }
+
+                        glm::ivec3 u{0};
+                        glm::ivec3 v{0};
+                        u[(axis + 1) % 3] = 1;
+                        v[(axis + 2) % 3] = 1;
+                        glm::ivec3 base = voxel;
+                        base[axis] += side;
+                        uint32_t quad[4] = {
+                            vertex(base), vertex(base + u), vertex(base + u + v),
+                            vertex(base + v)
+                        };
+                        for (uint32_t index : {0, 1, 2, 0, 2, 3}) {
+                            data.indices.push_back(quad[index]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return data;
+}
+
+static MeshData sphereMesh(uint32_t rings, uint32_t segments) {
+    MeshData data{};
+    auto push = [&](const glm::vec3 &position) {
+        MeshVertex vertex{};
+        vertex.position = position;
+        data.vertices.push_back(vertex);
+        data.aabb.merge(position);
+    };
+
+    push({0.0f, 1.0f, 0.0f});
+    for (uint32_t ring = 1; ring < rings; ++ring) {
+        float theta = glm::pi<float>() * ring / rings;
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            float phi = 2.0f * glm::pi<float>() * segment / segments;
+            push({std::sin(theta) * std::cos(phi),
+                  std::cos(theta),
+                  std::sin(theta) * std::sin(phi)});
+        }
+    }
+    push({0.0f, -1.0f, 0.0f});
+
+    uint32_t south = uint32_t(data.vertices.size() - 1);
+    auto ring_vertex = [&](uint32_t ring, uint32_t segment) {
+        return 1 + (ring - 1) * segments + segment % segments;
+    };
+    for (uint32_t segment = 0; segment < segments; ++segment) {
+        data.indices.insert(
+            data.indices.end(), {0, ring_vertex(1, segment + 1), ring_vertex(1, segment)}
+        );
+        data.indices.insert(
+            data.indices.end(),
+            {south, ring_vertex(rings - 1, segment), ring_vertex(rings - 1, segment + 1)}
+        );
+        for (uint32_t ring = 1; ring + 1 < rings; ++ring) {
+            uint32_t a = ring_vertex(ring, segment);
+            uint32_t b = ring_vertex(ring, segment + 1);
+            uint32_t c = ring_vertex(ring + 1, segment);
+            uint32_t d = ring_vertex(ring + 1, segment + 1);
+            data.indices.insert(data.indices.end(), {a, b, d, a, d, c});
+        }
+    }
+    return data;
+}
+
+struct TestMesh {
+    const char *name;
+    MeshData data;
+    // open meshes have no inside to hold a proxy
+    bool expect_proxy;
+    // views from inside the bounds too, e.g. a sealed room
+    bool inside_views;
+};
+
+struct Coverage {
+    uint64_t mesh_pixels{};
+    uint64_t proxy_pixels{};
+    uint64_t violations{};
+};
+
+static void compareView(
+    const OccluderMesh &mesh,
+    const OccluderMesh &proxy,
+    const glm::mat4 &model,
+    const glm::mat4 &proj_view,
+    Coverage &coverage
+) {
+    SoftwareOcclusionCuller mesh_culler{};
+    mesh_culler.beginFrame(proj_view);
+    mesh_culler.addOccluder(mesh, model);
+    mesh_culler.rasterize();
+
+    SoftwareOcclusionCuller proxy_culler{};
+    proxy_culler.beginFrame(proj_view);
+    proxy_culler.addOccluder(proxy, model);
+    proxy_culler.rasterize();
+
+    const std::vector<float> &mesh_depth = mesh_culler.depthBuffer();
+    const std::vector<float> &proxy_depth = proxy_culler.depthBuffer();
+    for (size_t i = 0; i < mesh_depth.size(); ++i) {
+        coverage.mesh_pixels += mesh_depth[i] < 1.0f;
+        if (proxy_depth[i] < 1.0f) {
+            ++coverage.proxy_pixels;
+            coverage.violations += mesh_depth[i] > proxy_depth[i] + k_depth_epsilon;
+        }
+    }
+}
+
+int main() {
+    std::vector<TestMesh> meshes{};
+    meshes.push_back(
+        {"block", voxelMesh({4, 3, 2}, [](int32_t, int32_t, int32_t) { return true; }),
+         true,
+         false}
+    );
+    // the window must stay open however coarse the proxy
+    meshes.push_back(
+        {"wall with window",
+         voxelMesh(
+             {12, 8, 2},
+             [](int32_t x, int32_t y, int32_t) {
+                 return !(x >= 5 && x < 7 && y >= 3 && y < 5);
+             }
+         ),
+         true,
+         false}
+    );
+    meshes.push_back(
+        {"concave l",
+         voxelMesh(
+             {6, 6, 3}, [](int32_t x, int32_t y, int32_t) { return x < 2 || y < 2; }
+         ),
+         true,
+         false}
+    );
+    // the enclosed cavity is outside the mesh and must stay empty
+    meshes.push_back(
+        {"sealed room",
+         voxelMesh(
+             {10, 10, 10},
+             [](int32_t x, int32_t y, int32_t z) {
+                 return x < 2 || x > 7 || y < 2 || y > 7 || z < 2 || z > 7;
+             }
+         ),
+         true,
+         true}
+    );
+    meshes.push_back(
+        {"open box",
+         voxelMesh({1, 1, 1}, [](int32_t, int32_t, int32_t) { return true; }),
+         false,
+         false}
+    );
+    meshes.back().data.indices.resize(meshes.back().data.indices.size() - 6);
+    meshes.push_back({"sphere", sphereMesh(24, 32), true, false});
+
+    // rotated and stretched, so the proxy boxes don't line up with the screen
+    glm::mat4 model = glm::rotate(glm::mat4{1.0f}, 0.7f, glm::vec3{0.3f, 1.0f, 0.2f}) *
+                      glm::scale(glm::mat4{1.0f}, glm::vec3{1.0f, 1.3f, 0.8f});
+    float aspect = float(SoftwareOcclusionCuller::k_width) /
+                   float(SoftwareOcclusionCuller::k_height);
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), aspect, 0.05f, 100.0f);
+
+    bool passed = true;
+    for (TestMesh &test : meshes) {
+        std::shared_ptr<OccluderMesh> proxy = buildOccluderMesh(test.data);
+        if (!proxy) {
+            std::printf("%-18s no proxy\n", test.name);
+            passed = passed && !test.expect_proxy;
+            continue;
+        }
+        if (!test.expect_proxy) {
+            std::printf("%-18s unexpected proxy\n", test.name);
+            passed = false;
+            continue;
+        }
+
+        OccluderMesh mesh{};
+        for (const MeshVertex &vertex : test.data.vertices) {
+            mesh.vertices.push_back(vertex.position);
+        }
+        mesh.indices = test.data.indices;
+
+        glm::vec3 center = model * glm::vec4{test.data.aabb.center, 1.0f};
+        float radius = glm::length(test.data.aabb.half_extent) * 1.3f;
+
+        // fibonacci sphere of directions at a far and a close distance
+        Coverage coverage{};
+        const uint32_t direction_count = 48;
+        for (uint32_t i = 0; i < direction_count; ++i) {
+            float y = 1.0f - 2.0f * (i + 0.5f) / direction_count;
+            float ring = std::sqrt(1.0f - y * y);
+            float phi = 2.39996323f * i;
+            glm::vec3 direction{ring * std::cos(phi), y, ring * std::sin(phi)};
+            glm::vec3 up = std::abs(y) > 0.9f ? glm::vec3{1.0f, 0.0f, 0.0f}
+                                              : glm::vec3{0.0f, 1.0f, 0.0f};
+
+            for (float distance : {2.5f, 1.1f}) {
+                glm::vec3 eye = center + direction * radius * distance;
+                glm::mat4 view = glm::lookAt(eye, center, up);
+                compareView(mesh, *proxy, model, proj * view, coverage);
+            }
+            if (test.inside_views) {
+                glm::mat4 view = glm::lookAt(center, center + direction, up);
+                compareView(mesh, *proxy, model, proj * view, coverage);
+            }
+        }
+
+        std::printf(
+            "%-18s %3zu proxy triangles, covers %5.1f%% of the mesh pixels, %llu "
+            "violations\n",
+            test.name,
+            proxy->indices.size() / 3,
+            100.0 * coverage.proxy_pixels / std::max<uint64_t>(coverage.mesh_pixels, 1),
+            static_cast<unsigned long long>(coverage.violations)
+        );
+        passed = passed && coverage.violations == 0 && coverage.proxy_pixels > 0;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -257,6 +257,7 @@ void EditorUI::initialize(WindowUIInitInfo init_info) {
 void EditorUI::preRender() {
     showEditorFileContentWindow(&m_file_content_window_open);
     showObjectDetailWindow(&m_object_detail_window);
+    showRenderStatisticsWindow(&m_render_statistics_window);
 }
 
 void EditorUI::clear() {}
@@ -333,6 +334,114 @@ void EditorUI::showObjectDetailWindow(bool *p_open) {
     ImGui::End();
 }
 
+void EditorUI::showRenderStatisticsWindow(bool *p_open) {
+    ImGuiWindowFlags window_flags = ImGuiWindowFlags_None;
+
+    if (!*p_open) {
+        return;
+    }
+
+    if (!ImGui::Begin("Render Statistics", p_open, window_flags)) {
+        ImGui::End();
+        return;
+    }
+
+    RenderSystem *render_system = g_runtime_global_context.render_system.get();
+    const VisibilityStatistics &statistics = render_system->getVisibilityStatistics();
+
+    bool software_occlusion_culling = render_system->softwareOcclusionCulling();
+    if (ImGui::Checkbox("Software occlusion", &software_occlusion_culling)) {
+        render_system->setSoftwareOcclusionCulling(software_occlusion_culling);
+    }
+
+    bool gpu_driven_culling = render_system->gpuDrivenCulling();
+    if (ImGui::Checkbox("GPU driven culling", &gpu_driven_culling)) {
+        render_system->setGpuDrivenCulling(gpu_driven_culling);
+    }
+
+    CullSettings cull_settings = render_system->getCullSettings();
+    bool cull_settings_changed = false;
+    auto edit_view_cull_settings = [&](const char *label, ViewCullSettings &settings) {
+        if (ImGui::TreeNode(label)) {
+            cull_settings_changed |= ImGui::DragFloat(
+                "Min screen coverage",
+                &settings.min_screen_coverage,
+                0.0005f,
+                0.0f,
+                0.5f,
+                "%.4f"
+            );
+            cull_settings_changed |= ImGui::DragFloat(
+                "Max draw distance", &settings.max_draw_distance, 1.0f, 0.0f, 10000.0f
+            );
+            ImGui::TreePop();
+        }
+    };
+    edit_view_cull_settings("Main camera culling", cull_settings.main_camera);
+    edit_view_cull_settings(
+        "Directional shadow culling", cull_settings.directional_light_shadow
+    );
+    edit_view_cull_settings("Point shadow culling", cull_settings.point_light_shadow);
+    if (cull_settings_changed) {
+        render_system->setCullSettings(cull_settings);
+    }
+
+    ImGui::Text(
+        "Contribution culled: main %u, directional %u, point %u",
+        statistics.main_camera_contribution_culled_count,
+        statistics.directional_light_contribution_culled_count,
+        statistics.point_lights_contribution_culled_count
+    );
+    ImGui::Text(
+        "Shadow casters without receivers: %u",
+        statistics.directional_light_receiver_culled_count
+    );
+    ImGui::Text("Frustum visible: %u", statistics.main_camera_frustum_visible_count);
+    if (software_occlusion_culling) {
+        ImGui::Text(
+            "Software occluders: %u", statistics.main_camera_software_occluder_count
+        );
+        ImGui::Text(
+            "Software occluded: %u", statistics.main_camera_software_occluded_count
+        );
+    }
+    ImGui::Text("Occlusion culled: %u", statistics.main_camera_occluded_count);
+
+    const FrameUploadBuffer &frame_upload_buffer = render_system->getFrameUploadBuffer();
+    ImGui::Text(
+        "Frame upload buffer: %.2f / %.0f MiB per frame%s",
+        frame_upload_buffer.highWaterMark() / (1024.0 * 1024.0),
+        frame_upload_buffer.regionSize() / (1024.0 * 1024.0),
+        frame_upload_buffer.deviceLocal() ? ", device local" : ""
+    );
+
+    const UploadBatcher &upload_batcher = render_system->getUploadBatcher();
+    int upload_budget = static_cast<int>(upload_batcher.frameBudget() / (1024 * 1024));
+    if (ImGui::SliderInt("Upload budget (MiB per frame)", &upload_budget, 1, 256)) {
+        render_system->setUploadFrameBudget(VkDeviceSize{1024 * 1024} * upload_budget);
+    }
+    ImGui::Text(
+        "Uploads waiting: %.2f MiB, %u batches in flight, %.0f MiB staging%s",
+        upload_batcher.pendingBytes() / (1024.0 * 1024.0),
+        upload_batcher.inFlightBatchCount(),
+        upload_batcher.stagingSize() / (1024.0 * 1024.0),
+        upload_batcher.dedicatedTransferQueue() ? ", transfer queue" : ""
+    );
+    ImGui::Text("Objects loading: %u", render_system->pendingSpawnCount());
+
+    const TextureCacheStatistics &texture_cache =
+        render_system->getTextureCacheStatistics();
+    ImGui::Text(
+        "Textures: %u, %.2f MiB, %u shared saving %.2f MiB",
+        texture_cache.texture_count,
+        texture_cache.memory / (1024.0 * 1024.0),
+        texture_cache.hit_count,
+        texture_cache.saved_memory / (1024.0 * 1024.0)
+    );
+
+    ImGui::End();
+}
+
 void EditorUI::buildEditorFileAssetsUITree(EditorFileNode *node) {
     ImGui::TableNextRow();
     ImGui::TableNextColumn();
@@ -370,8 +479,8 @@ void EditorUI::onFileContentItemClicked(EditorFileNode *node) {
         return;
     }
 
-    g_editor_global_context.render_system->spawnObject(node->file_path);
-    VAIN_INFO("Loaded object: {}", node->file_path);
+    g_editor_global_context.render_system->spawnObjectAsync(node->file_path);
+    VAIN_INFO("Spawning object: {}", node->file_path);
 }
 
 }  // namespace Vain
\ No newline at end of file
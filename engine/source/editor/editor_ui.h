@@ -30,11 +30,13 @@ class EditorUI : public WindowUI {
 
     bool m_file_content_window_open = true;
     bool m_object_detail_window = true;
+    bool m_render_statistics_window = true;
 
     std::string getLeafUINodeParentLabel();
 
     void showEditorFileContentWindow(bool *p_open);
     void showObjectDetailWindow(bool *p_open);
+    void showRenderStatisticsWindow(bool *p_open);
 
     void buildEditorFileAssetsUITree(EditorFileNode *node);
     void onFileContentItemClicked(EditorFileNode *node);
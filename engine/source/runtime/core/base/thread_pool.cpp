@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace Vain {
+
+ThreadPool::ThreadPool(uint32_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    m_workers.reserve(thread_count);
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        m_workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_condition.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(
+    uint32_t count,
+    uint32_t grain,
+    const std::function<void(uint32_t begin, uint32_t end)> &func
+) {
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max(grain, 1u);
+    uint32_t chunk_count = (count + grain - 1) / grain;
+    if (chunk_count == 1 || m_workers.empty()) {
+        func(0, count);
+        return;
+    }
+
+    // helpers may only start after the call returned, so they must not touch func
+    // unless they claimed a chunk
+    struct State {
+        std::atomic<uint32_t> next_chunk{0};
+        std::atomic<uint32_t> finished_chunk_count{0};
+        std::mutex mutex{};
+        std::condition_variable condition{};
+    };
+    auto state = std::make_shared<State>();
+
+    auto run_chunks = [state, count, grain, chunk_count, &func]() {
+        uint32_t chunk;
+        while ((chunk = state->next_chunk.fetch_add(1)) < chunk_count) {
+            uint32_t begin = chunk * grain;
+            func(begin, std::min(begin + grain, count));
+
+            if (state->finished_chunk_count.fetch_add(1) + 1 == chunk_count) {
+                std::lock_guard<std::mutex> lock{state->mutex};
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    uint32_t helper_count =
+        std::min(static_cast<uint32_t>(m_workers.size()), chunk_count - 1);
+    for (uint32_t i = 0; i < helper_count; ++i) {
+        enqueue(run_chunks);
+    }
+
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock{state->mutex};
+    state->condition.wait(lock, [&state, chunk_count]() {
+        return state->finished_chunk_count.load() == chunk_count;
+    });
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+}  // namespace Vain
\ No newline at end of file
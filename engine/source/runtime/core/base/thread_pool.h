@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Vain {
+
+class ThreadPool {
+  public:
+    // 0 spawns one worker per hardware thread besides the calling one
+    explicit ThreadPool(uint32_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    template <typename Task>
+    std::future<std::invoke_result_t<std::decay_t<Task>>> submit(Task &&task);
+
+    // splits [0, count) into chunks of at most grain, the calling thread takes chunks
+    // too and the call returns once all of them ran
+    void parallelFor(
+        uint32_t count,
+        uint32_t grain,
+        const std::function<void(uint32_t begin, uint32_t end)> &func
+    );
+
+  private:
+    std::vector<std::thread> m_workers{};
+    std::deque<std::function<void()>> m_tasks{};
+    std::mutex m_mutex{};
+    std::condition_variable m_condition{};
+    bool m_stop{false};
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<std::decay_t<Task>>> ThreadPool::submit(Task &&task) {
+    using Result = std::invoke_result_t<std::decay_t<Task>>;
+
+    // std::function needs a copyable target
+    auto packaged_task =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+    std::future<Result> future = packaged_task->get_future();
+    enqueue([packaged_task]() { (*packaged_task)(); });
+
+    return future;
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -41,7 +41,7 @@ void AxisAlignedBoundingBox::transform(const glm::mat4 &mat) {
 
 bool AxisAlignedBoundingBox::intersect(const glm::vec3 &position, float radius) const {
     glm::vec3 min = minCorner();
-    glm::vec3 max = minCorner();
+    glm::vec3 max = maxCorner();
 
     for (size_t i = 0; i < 3; ++i) {
         if (position[i] < min[i] && min[i] - position[i] > radius) {
@@ -54,6 +54,52 @@ bool AxisAlignedBoundingBox::intersect(const glm::vec3 &position, float radius)
     return true;
 }
 
+bool AxisAlignedBoundingBox::contains(const AxisAlignedBoundingBox &aabb) const {
+    glm::vec3 min = minCorner();
+    glm::vec3 max = maxCorner();
+    glm::vec3 other_min = aabb.minCorner();
+    glm::vec3 other_max = aabb.maxCorner();
+
+    return min.x <= other_min.x && min.y <= other_min.y && min.z <= other_min.z &&
+           max.x >= other_max.x && max.y >= other_max.y && max.z >= other_max.z;
+}
+
+float AxisAlignedBoundingBox::surfaceArea() const {
+    if (empty()) {
+        return 0.0f;
+    }
+
+    glm::vec3 extent = 2.0f * half_extent;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+void AxisAlignedBoundingBoxArray::reserve(size_t count) {
+    center_x.reserve(count);
+    center_y.reserve(count);
+    center_z.reserve(count);
+    half_extent_x.reserve(count);
+    half_extent_y.reserve(count);
+    half_extent_z.reserve(count);
+}
+
+void AxisAlignedBoundingBoxArray::clear() {
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    half_extent_x.clear();
+    half_extent_y.clear();
+    half_extent_z.clear();
+}
+
+void AxisAlignedBoundingBoxArray::push_back(const AxisAlignedBoundingBox &aabb) {
+    center_x.push_back(aabb.center.x);
+    center_y.push_back(aabb.center.y);
+    center_z.push_back(aabb.center.z);
+    half_extent_x.push_back(aabb.half_extent.x);
+    half_extent_y.push_back(aabb.half_extent.y);
+    half_extent_z.push_back(aabb.half_extent.z);
+}
+
 AxisAlignedBoundingBox boundingBoxTransform(
     const AxisAlignedBoundingBox &aabb, const glm::mat4 &transform
 ) {
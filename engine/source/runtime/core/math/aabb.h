@@ -3,6 +3,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <limits>
+#include <vector>
 
 namespace Vain {
 
@@ -31,6 +32,28 @@ class AxisAlignedBoundingBox {
     }
 
     bool intersect(const glm::vec3 &center, float radius) const;
+
+    bool contains(const AxisAlignedBoundingBox &aabb) const;
+
+    float surfaceArea() const;
+};
+
+// structure of arrays bounds for batch culling
+class AxisAlignedBoundingBoxArray {
+  public:
+    std::vector<float> center_x{};
+    std::vector<float> center_y{};
+    std::vector<float> center_z{};
+    std::vector<float> half_extent_x{};
+    std::vector<float> half_extent_y{};
+    std::vector<float> half_extent_z{};
+
+    size_t size() const { return center_x.size(); }
+
+    void reserve(size_t count);
+    void clear();
+
+    void push_back(const AxisAlignedBoundingBox &aabb);
 };
 
 AxisAlignedBoundingBox boundingBoxTransform(
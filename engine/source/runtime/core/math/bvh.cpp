@@ -0,0 +1,269 @@
+#include "bvh.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+namespace Vain {
+
+static constexpr float k_fat_aabb_margin_ratio = 0.1f;
+static constexpr float k_fat_aabb_min_margin = 0.01f;
+
+static AxisAlignedBoundingBox fattenBoundingBox(const AxisAlignedBoundingBox &aabb) {
+    AxisAlignedBoundingBox fat_aabb{};
+    fat_aabb.center = aabb.center;
+    if (aabb.empty()) {
+        fat_aabb.half_extent = glm::vec3{k_fat_aabb_min_margin};
+    } else {
+        fat_aabb.half_extent =
+            aabb.half_extent +
+            glm::max(aabb.half_extent * k_fat_aabb_margin_ratio, k_fat_aabb_min_margin);
+    }
+
+    return fat_aabb;
+}
+
+static AxisAlignedBoundingBox combineBoundingBox(
+    const AxisAlignedBoundingBox &a, const AxisAlignedBoundingBox &b
+) {
+    AxisAlignedBoundingBox aabb = a;
+    aabb.merge(b);
+
+    return aabb;
+}
+
+int32_t BoundingVolumeHierarchy::createProxy(
+    const AxisAlignedBoundingBox &aabb, void *user_data
+) {
+    int32_t proxy = allocateNode();
+
+    Node &node = m_nodes[proxy];
+    node.aabb = fattenBoundingBox(aabb);
+    node.user_data = user_data;
+    node.height = 0;
+
+    insertLeaf(proxy);
+    ++m_proxy_count;
+
+    return proxy;
+}
+
+void BoundingVolumeHierarchy::destroyProxy(int32_t proxy) {
+    assert(0 <= proxy && proxy < static_cast<int32_t>(m_nodes.size()));
+    assert(m_nodes[proxy].isLeaf());
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --m_proxy_count;
+}
+
+bool BoundingVolumeHierarchy::moveProxy(
+    int32_t proxy, const AxisAlignedBoundingBox &aabb
+) {
+    assert(0 <= proxy && proxy < static_cast<int32_t>(m_nodes.size()));
+    assert(m_nodes[proxy].isLeaf());
+
+    if (!aabb.empty() && m_nodes[proxy].aabb.contains(aabb)) {
+        return false;
+    }
+
+    removeLeaf(proxy);
+    m_nodes[proxy].aabb = fattenBoundingBox(aabb);
+    insertLeaf(proxy);
+
+    return true;
+}
+
+void BoundingVolumeHierarchy::clear() {
+    m_nodes.clear();
+    m_root = k_null_node;
+    m_free_list = k_null_node;
+    m_proxy_count = 0;
+}
+
+int32_t BoundingVolumeHierarchy::allocateNode() {
+    if (m_free_list == k_null_node) {
+        m_nodes.emplace_back();
+        return static_cast<int32_t>(m_nodes.size() - 1);
+    }
+
+    int32_t node = m_free_list;
+    m_free_list = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+
+    return node;
+}
+
+void BoundingVolumeHierarchy::freeNode(int32_t node) {
+    m_nodes[node] = Node{};
+    m_nodes[node].parent = m_free_list;
+    m_free_list = node;
+}
+
+void BoundingVolumeHierarchy::insertLeaf(int32_t leaf) {
+    if (m_root == k_null_node) {
+        m_root = leaf;
+        m_nodes[leaf].parent = k_null_node;
+        return;
+    }
+
+    // find the best sibling by the surface area heuristic
+    AxisAlignedBoundingBox leaf_aabb = m_nodes[leaf].aabb;
+    int32_t index = m_root;
+    while (!m_nodes[index].isLeaf()) {
+        const Node &node = m_nodes[index];
+
+        float area = node.aabb.surfaceArea();
+        float combined_area = combineBoundingBox(node.aabb, leaf_aabb).surfaceArea();
+
+        // cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combined_area;
+        // minimum cost of pushing the leaf further down the tree
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        float child_cost[2];
+        for (int i = 0; i < 2; ++i) {
+            const Node &child = m_nodes[i == 0 ? node.child1 : node.child2];
+            float new_area = combineBoundingBox(child.aabb, leaf_aabb).surfaceArea();
+            if (child.isLeaf()) {
+                child_cost[i] = new_area + inheritance_cost;
+            } else {
+                child_cost[i] = new_area - child.aabb.surfaceArea() + inheritance_cost;
+            }
+        }
+
+        if (cost < child_cost[0] && cost < child_cost[1]) {
+            break;
+        }
+
+        index = child_cost[0] < child_cost[1] ? node.child1 : node.child2;
+    }
+
+    int32_t sibling = index;
+
+    int32_t old_parent = m_nodes[sibling].parent;
+    int32_t new_parent = allocateNode();
+    m_nodes[new_parent].parent = old_parent;
+    m_nodes[new_parent].aabb = combineBoundingBox(m_nodes[sibling].aabb, leaf_aabb);
+    m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+    m_nodes[new_parent].child1 = sibling;
+    m_nodes[new_parent].child2 = leaf;
+    m_nodes[sibling].parent = new_parent;
+    m_nodes[leaf].parent = new_parent;
+
+    if (old_parent != k_null_node) {
+        if (m_nodes[old_parent].child1 == sibling) {
+            m_nodes[old_parent].child1 = new_parent;
+        } else {
+            m_nodes[old_parent].child2 = new_parent;
+        }
+    } else {
+        m_root = new_parent;
+    }
+
+    refitAncestors(new_parent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(int32_t leaf) {
+    if (leaf == m_root) {
+        m_root = k_null_node;
+        return;
+    }
+
+    int32_t parent = m_nodes[leaf].parent;
+    int32_t grand_parent = m_nodes[parent].parent;
+    int32_t sibling =
+        m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grand_parent == k_null_node) {
+        m_root = sibling;
+        m_nodes[sibling].parent = k_null_node;
+        freeNode(parent);
+        return;
+    }
+
+    if (m_nodes[grand_parent].child1 == parent) {
+        m_nodes[grand_parent].child1 = sibling;
+    } else {
+        m_nodes[grand_parent].child2 = sibling;
+    }
+    m_nodes[sibling].parent = grand_parent;
+    freeNode(parent);
+
+    refitAncestors(grand_parent);
+}
+
+void BoundingVolumeHierarchy::refitAncestors(int32_t index) {
+    while (index != k_null_node) {
+        index = balance(index);
+
+        Node &node = m_nodes[index];
+        const Node &child1 = m_nodes[node.child1];
+        const Node &child2 = m_nodes[node.child2];
+        node.aabb = combineBoundingBox(child1.aabb, child2.aabb);
+        node.height = 1 + std::max(child1.height, child2.height);
+
+        index = node.parent;
+    }
+}
+
+// rotate the taller grandchild up if the subtree of node is imbalanced
+int32_t BoundingVolumeHierarchy::balance(int32_t a) {
+    Node &node_a = m_nodes[a];
+    if (node_a.isLeaf() || node_a.height < 2) {
+        return a;
+    }
+
+    int32_t b = node_a.child1;
+    int32_t c = node_a.child2;
+    int32_t diff = m_nodes[c].height - m_nodes[b].height;
+
+    if (diff > 1) {
+        std::swap(b, c);
+    } else if (diff >= -1) {
+        return a;
+    }
+
+    // b is the taller child, promote it
+    Node &node_b = m_nodes[b];
+    int32_t f = node_b.child1;
+    int32_t g = node_b.child2;
+
+    node_b.child1 = a;
+    node_b.parent = node_a.parent;
+    node_a.parent = b;
+
+    if (node_b.parent != k_null_node) {
+        if (m_nodes[node_b.parent].child1 == a) {
+            m_nodes[node_b.parent].child1 = b;
+        } else {
+            m_nodes[node_b.parent].child2 = b;
+        }
+    } else {
+        m_root = b;
+    }
+
+    // keep the taller grandchild under b
+    if (m_nodes[f].height < m_nodes[g].height) {
+        std::swap(f, g);
+    }
+    node_b.child2 = f;
+    if (node_a.child1 == b) {
+        node_a.child1 = g;
+    } else {
+        node_a.child2 = g;
+    }
+    m_nodes[g].parent = a;
+
+    const Node &node_a_child1 = m_nodes[node_a.child1];
+    const Node &node_a_child2 = m_nodes[node_a.child2];
+    node_a.aabb = combineBoundingBox(node_a_child1.aabb, node_a_child2.aabb);
+    node_a.height = 1 + std::max(node_a_child1.height, node_a_child2.height);
+
+    node_b.aabb = combineBoundingBox(node_a.aabb, m_nodes[f].aabb);
+    node_b.height = 1 + std::max(node_a.height, m_nodes[f].height);
+
+    return b;
+}
+
+}  // namespace Vain
\ No newline at end of file
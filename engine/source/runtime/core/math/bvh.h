@@ -0,0 +1,94 @@
+#pragma once
+
+#include <assert.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "core/math/aabb.h"
+
+namespace Vain {
+
+// dynamic aabb tree, leaves keep a fattened box so small moves don't touch the tree
+class BoundingVolumeHierarchy {
+  public:
+    static constexpr int32_t k_null_node = -1;
+    // the balancing keeps the tree height logarithmic, a query never holds more than
+    // height + 1 nodes
+    static constexpr int32_t k_query_stack_size = 64;
+
+    int32_t createProxy(const AxisAlignedBoundingBox &aabb, void *user_data);
+    void destroyProxy(int32_t proxy);
+    // returns true if the proxy had to be reinserted
+    bool moveProxy(int32_t proxy, const AxisAlignedBoundingBox &aabb);
+
+    void *getUserData(int32_t proxy) const { return m_nodes[proxy].user_data; }
+    const AxisAlignedBoundingBox &getFatBoundingBox(int32_t proxy) const {
+        return m_nodes[proxy].aabb;
+    }
+
+    size_t proxyCount() const { return m_proxy_count; }
+
+    void clear();
+
+    // overlap: bool(const AxisAlignedBoundingBox &), callback: void(void *user_data)
+    template <typename Overlap, typename Callback>
+    void query(Overlap &&overlap, Callback &&callback) const;
+
+  private:
+    struct Node {
+        AxisAlignedBoundingBox aabb{};
+        void *user_data{};
+        // next free node when the node is in the free list
+        int32_t parent{k_null_node};
+        int32_t child1{k_null_node};
+        int32_t child2{k_null_node};
+        // leaf 0, free -1
+        int32_t height{-1};
+
+        bool isLeaf() const { return child1 == k_null_node; }
+    };
+
+    std::vector<Node> m_nodes{};
+    int32_t m_root{k_null_node};
+    int32_t m_free_list{k_null_node};
+    size_t m_proxy_count{};
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    void refitAncestors(int32_t index);
+
+    int32_t balance(int32_t node);
+};
+
+template <typename Overlap, typename Callback>
+void BoundingVolumeHierarchy::query(Overlap &&overlap, Callback &&callback) const {
+    if (m_root == k_null_node) {
+        return;
+    }
+
+    assert(m_nodes[m_root].height < k_query_stack_size);
+    int32_t stack[k_query_stack_size];
+    int32_t stack_size = 0;
+    stack[stack_size++] = m_root;
+
+    while (stack_size > 0) {
+        const Node &node = m_nodes[stack[--stack_size]];
+
+        if (!overlap(node.aabb)) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            callback(node.user_data);
+        } else {
+            stack[stack_size++] = node.child1;
+            stack[stack_size++] = node.child2;
+        }
+    }
+}
+
+}  // namespace Vain
\ No newline at end of file
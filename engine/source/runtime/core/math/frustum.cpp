@@ -2,6 +2,19 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VAIN_FRUSTUM_SSE
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define VAIN_TARGET_AVX2
+#else
+#define VAIN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 namespace Vain {
 
 Frustum::Frustum(
@@ -45,7 +58,7 @@ Frustum::Frustum(
     near_plane /= glm::vec3{near_plane}.length();
 }
 
-bool Frustum::intersect(const AxisAlignedBoundingBox &aabb) {
+bool Frustum::intersect(const AxisAlignedBoundingBox &aabb) const {
     {
         float signed_distance = glm::dot(right_plane, glm::vec4{aabb.center, 1.0});
         float radius_project = glm::dot(
@@ -127,4 +140,255 @@ bool Frustum::intersect(const AxisAlignedBoundingBox &aabb) {
     return true;
 }
 
+bool Frustum::intersectSwept(
+    const AxisAlignedBoundingBox &aabb, const glm::vec3 &sweep
+) const {
+    const glm::vec4 *planes[6] = {
+        &right_plane, &left_plane, &top_plane, &bottom_plane, &near_plane, &far_plane
+    };
+
+    for (const glm::vec4 *plane : planes) {
+        glm::vec3 normal{*plane};
+
+        // the swept box is outside only if the box at both ends of the sweep is,
+        // test the end reaching furthest inside
+        float signed_distance = glm::dot(*plane, glm::vec4{aabb.center, 1.0}) +
+                                std::min(glm::dot(normal, sweep), 0.0f);
+        float radius_project = glm::dot(glm::abs(normal), aabb.half_extent);
+
+        bool intersecting_or_inside = signed_distance < radius_project;
+        if (!intersecting_or_inside) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct FrustumPlanes {
+    float normal_x[6];
+    float normal_y[6];
+    float normal_z[6];
+    float distance[6];
+    float abs_normal_x[6];
+    float abs_normal_y[6];
+    float abs_normal_z[6];
+};
+
+static FrustumPlanes splatFrustumPlanes(const Frustum &frustum) {
+    const glm::vec4 planes[6] = {
+        frustum.right_plane,
+        frustum.left_plane,
+        frustum.bottom_plane,
+        frustum.top_plane,
+        frustum.far_plane,
+        frustum.near_plane
+    };
+
+    FrustumPlanes result{};
+    for (int i = 0; i < 6; ++i) {
+        result.normal_x[i] = planes[i].x;
+        result.normal_y[i] = planes[i].y;
+        result.normal_z[i] = planes[i].z;
+        result.distance[i] = planes[i].w;
+        result.abs_normal_x[i] = fabs(planes[i].x);
+        result.abs_normal_y[i] = fabs(planes[i].y);
+        result.abs_normal_z[i] = fabs(planes[i].z);
+    }
+
+    return result;
+}
+
+static void intersectScalar(
+    const FrustumPlanes &planes,
+    const AxisAlignedBoundingBoxArray &aabbs,
+    size_t begin,
+    size_t end,
+    uint64_t *visibility
+) {
+    for (size_t i = begin; i < end; ++i) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            // summed in the order of the simd paths, so every path sets the same bits
+            float signed_distance = (planes.normal_x[p] * aabbs.center_x[i] +
+                                     planes.normal_y[p] * aabbs.center_y[i]) +
+                                    (planes.normal_z[p] * aabbs.center_z[i] +
+                                     planes.distance[p]);
+            float radius_project = planes.abs_normal_x[p] * aabbs.half_extent_x[i] +
+                                   planes.abs_normal_y[p] * aabbs.half_extent_y[i] +
+                                   planes.abs_normal_z[p] * aabbs.half_extent_z[i];
+            inside = signed_distance < radius_project;
+        }
+
+        if (inside) {
+            visibility[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+}
+
+#ifdef VAIN_FRUSTUM_SSE
+static size_t intersectSSE(
+    const FrustumPlanes &planes,
+    const AxisAlignedBoundingBoxArray &aabbs,
+    uint64_t *visibility
+) {
+    size_t count = aabbs.size() / 4 * 4;
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&aabbs.center_x[i]);
+        __m128 cy = _mm_loadu_ps(&aabbs.center_y[i]);
+        __m128 cz = _mm_loadu_ps(&aabbs.center_z[i]);
+        __m128 ex = _mm_loadu_ps(&aabbs.half_extent_x[i]);
+        __m128 ey = _mm_loadu_ps(&aabbs.half_extent_y[i]);
+        __m128 ez = _mm_loadu_ps(&aabbs.half_extent_z[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m128 signed_distance = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(planes.normal_x[p]), cx),
+                    _mm_mul_ps(_mm_set1_ps(planes.normal_y[p]), cy)
+                ),
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(planes.normal_z[p]), cz),
+                    _mm_set1_ps(planes.distance[p])
+                )
+            );
+            __m128 radius_project = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(planes.abs_normal_x[p]), ex),
+                    _mm_mul_ps(_mm_set1_ps(planes.abs_normal_y[p]), ey)
+                ),
+                _mm_mul_ps(_mm_set1_ps(planes.abs_normal_z[p]), ez)
+            );
+            inside = _mm_and_ps(inside, _mm_cmplt_ps(signed_distance, radius_project));
+        }
+
+        uint64_t mask = static_cast<uint64_t>(_mm_movemask_ps(inside));
+        visibility[i / 64] |= mask << (i % 64);
+    }
+
+    return count;
+}
+
+VAIN_TARGET_AVX2 static size_t intersectAVX2(
+    const FrustumPlanes &planes,
+    const AxisAlignedBoundingBoxArray &aabbs,
+    uint64_t *visibility
+) {
+    size_t count = aabbs.size() / 8 * 8;
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&aabbs.center_x[i]);
+        __m256 cy = _mm256_loadu_ps(&aabbs.center_y[i]);
+        __m256 cz = _mm256_loadu_ps(&aabbs.center_z[i]);
+        __m256 ex = _mm256_loadu_ps(&aabbs.half_extent_x[i]);
+        __m256 ey = _mm256_loadu_ps(&aabbs.half_extent_y[i]);
+        __m256 ez = _mm256_loadu_ps(&aabbs.half_extent_z[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m256 signed_distance = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(planes.normal_x[p]), cx),
+                    _mm256_mul_ps(_mm256_set1_ps(planes.normal_y[p]), cy)
+                ),
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(planes.normal_z[p]), cz),
+                    _mm256_set1_ps(planes.distance[p])
+                )
+            );
+            __m256 radius_project = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(planes.abs_normal_x[p]), ex),
+                    _mm256_mul_ps(_mm256_set1_ps(planes.abs_normal_y[p]), ey)
+                ),
+                _mm256_mul_ps(_mm256_set1_ps(planes.abs_normal_z[p]), ez)
+            );
+            inside = _mm256_and_ps(
+                inside, _mm256_cmp_ps(signed_distance, radius_project, _CMP_LT_OQ)
+            );
+        }
+
+        uint64_t mask = static_cast<uint64_t>(_mm256_movemask_ps(inside));
+        visibility[i / 64] |= mask << (i % 64);
+    }
+
+    return count;
+}
+
+static bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    // avx needs os support for the ymm state as well
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+bool Frustum::intersectPathSupported(FrustumIntersectPath path) {
+    switch (path) {
+    case FrustumIntersectPath::AUTOMATIC:
+    case FrustumIntersectPath::SCALAR:
+        return true;
+#ifdef VAIN_FRUSTUM_SSE
+    case FrustumIntersectPath::SSE:
+        return true;
+    case FrustumIntersectPath::AVX2: {
+        static const bool s_avx2_supported = cpuSupportsAVX2();
+        return s_avx2_supported;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+void Frustum::intersect(
+    const AxisAlignedBoundingBoxArray &aabbs,
+    std::vector<uint64_t> &visibility,
+    FrustumIntersectPath path
+) const {
+    visibility.assign((aabbs.size() + 63) / 64, 0);
+    if (aabbs.size() == 0) {
+        return;
+    }
+
+    if (path == FrustumIntersectPath::AUTOMATIC) {
+        path = FrustumIntersectPath::SCALAR;
+        if (intersectPathSupported(FrustumIntersectPath::AVX2)) {
+            path = FrustumIntersectPath::AVX2;
+        } else if (intersectPathSupported(FrustumIntersectPath::SSE)) {
+            path = FrustumIntersectPath::SSE;
+        }
+    }
+    assert(intersectPathSupported(path));
+
+    FrustumPlanes planes = splatFrustumPlanes(*this);
+
+    size_t done = 0;
+#ifdef VAIN_FRUSTUM_SSE
+    if (path == FrustumIntersectPath::AVX2) {
+        done = intersectAVX2(planes, aabbs, visibility.data());
+    } else if (path == FrustumIntersectPath::SSE) {
+        done = intersectSSE(planes, aabbs, visibility.data());
+    }
+#endif
+
+    intersectScalar(planes, aabbs, done, aabbs.size(), visibility.data());
+}
+
 }  // namespace Vain
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "core/math/aabb.h"
 
 namespace Vain {
 
+// code paths of the batch intersection, AUTOMATIC takes the widest the cpu supports
+enum class FrustumIntersectPath { AUTOMATIC, SCALAR, SSE, AVX2 };
+
 class Frustum {
   public:
     glm::vec4 right_plane{};
@@ -23,7 +29,20 @@ class Frustum {
         float ndc_far
     );
 
-    bool intersect(const AxisAlignedBoundingBox &aabb);
+    bool intersect(const AxisAlignedBoundingBox &aabb) const;
+    // the volume the box covers when moved along sweep, e.g. a shadow caster extruded
+    // away from the light
+    bool intersectSwept(const AxisAlignedBoundingBox &aabb, const glm::vec3 &sweep) const;
+
+    // one bit per box, box i is bit i % 64 of word i / 64. every supported path sets the
+    // same bits, the others are there to be compared and timed against
+    void intersect(
+        const AxisAlignedBoundingBoxArray &aabbs,
+        std::vector<uint64_t> &visibility,
+        FrustumIntersectPath path = FrustumIntersectPath::AUTOMATIC
+    ) const;
+
+    static bool intersectPathSupported(FrustumIntersectPath path);
 };
 
 }  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "descriptor_allocator.h"
+
+#include <algorithm>
+
+#include "core/base/macro.h"
+
+namespace Vain {
+
+// descriptors of each type a pool holds per set, generous enough that no layout of
+// the passes fills one type long before the set count
+static constexpr struct {
+    VkDescriptorType type;
+    float ratio;
+} k_pool_size_ratios[] = {
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.5f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0.5f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+    {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+};
+
+DescriptorAllocator::~DescriptorAllocator() { clear(); }
+
+void DescriptorAllocator::initialize(VkDevice device, uint32_t initial_pool_set_count) {
+    m_device = device;
+    m_pool_set_count = initial_pool_set_count;
+}
+
+void DescriptorAllocator::clear() {
+    for (VkDescriptorPool pool : m_full_pools) {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+    for (VkDescriptorPool pool : m_ready_pools) {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+    m_full_pools.clear();
+    m_ready_pools.clear();
+}
+
+VkResult DescriptorAllocator::allocate(
+    VkDescriptorSetLayout layout, VkDescriptorSet *set
+) {
+    VkDescriptorSetAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &layout;
+
+    while (true) {
+        bool fresh_pool = m_ready_pools.empty();
+        uint32_t pool_set_count = m_pool_set_count;
+
+        allocate_info.descriptorPool = readyPool();
+        if (allocate_info.descriptorPool == VK_NULL_HANDLE) {
+            return VK_ERROR_OUT_OF_POOL_MEMORY;
+        }
+
+        VkResult res = vkAllocateDescriptorSets(m_device, &allocate_info, set);
+        if (res != VK_ERROR_OUT_OF_POOL_MEMORY && res != VK_ERROR_FRAGMENTED_POOL) {
+            return res;
+        }
+
+        // the pool stays in the chain until reset, the next one is a size class up. a
+        // set that doesn't even fit the biggest class never will
+        m_full_pools.push_back(m_ready_pools.back());
+        m_ready_pools.pop_back();
+        if (fresh_pool && pool_set_count == k_max_pool_set_count) {
+            return res;
+        }
+    }
+}
+
+void DescriptorAllocator::reset() {
+    for (VkDescriptorPool pool : m_ready_pools) {
+        vkResetDescriptorPool(m_device, pool, 0);
+    }
+    for (VkDescriptorPool pool : m_full_pools) {
+        vkResetDescriptorPool(m_device, pool, 0);
+        m_ready_pools.push_back(pool);
+    }
+    m_full_pools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::readyPool() {
+    if (!m_ready_pools.empty()) {
+        return m_ready_pools.back();
+    }
+
+    VkDescriptorPool pool = createPool(m_pool_set_count);
+    if (pool != VK_NULL_HANDLE) {
+        m_ready_pools.push_back(pool);
+        m_pool_set_count = std::min(m_pool_set_count * 2, k_max_pool_set_count);
+    }
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t set_count) {
+    VkDescriptorPoolSize pool_sizes[ARRAY_SIZE(k_pool_size_ratios)];
+    for (uint32_t i = 0; i < ARRAY_SIZE(k_pool_size_ratios); ++i) {
+        pool_sizes[i].type = k_pool_size_ratios[i].type;
+        pool_sizes[i].descriptorCount = std::max(
+            static_cast<uint32_t>(k_pool_size_ratios[i].ratio * set_count), 1u
+        );
+    }
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = ARRAY_SIZE(pool_sizes);
+    pool_info.pPoolSizes = pool_sizes;
+    pool_info.maxSets = set_count;
+
+    VkDescriptorPool pool{};
+    if (vkCreateDescriptorPool(m_device, &pool_info, nullptr, &pool) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create descriptor pool");
+        return VK_NULL_HANDLE;
+    }
+    return pool;
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Vain {
+
+// hands out descriptor sets from a chain of pools. every pool holds each descriptor
+// type in a fixed ratio to its set count, and a pool that runs out is followed by one
+// of the next size class, twice as big up to k_max_pool_set_count. sets are only given
+// back all at once by reset
+class DescriptorAllocator {
+  public:
+    static constexpr uint32_t k_max_pool_set_count{4096};
+
+    DescriptorAllocator() = default;
+    ~DescriptorAllocator();
+
+    void initialize(VkDevice device, uint32_t initial_pool_set_count);
+    void clear();
+
+    VkResult allocate(VkDescriptorSetLayout layout, VkDescriptorSet *set);
+
+    // frees every set of the chain, the pools are kept for reuse
+    void reset();
+
+    uint32_t poolCount() const {
+        return static_cast<uint32_t>(m_full_pools.size() + m_ready_pools.size());
+    }
+
+  private:
+    VkDevice m_device{};
+    uint32_t m_pool_set_count{};
+
+    std::vector<VkDescriptorPool> m_full_pools{};
+    // the back one is allocated from
+    std::vector<VkDescriptorPool> m_ready_pools{};
+
+    VkDescriptorPool readyPool();
+    VkDescriptorPool createPool(uint32_t set_count);
+};
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,501 @@
+#include "upload_batcher.h"
+
+#include <assert.h>
+
+#include <cstring>
+#include <numeric>
+
+#include "core/base/macro.h"
+#include "vulkan_context.h"
+
+namespace Vain {
+
+UploadBatcher::~UploadBatcher() { clear(); }
+
+void UploadBatcher::initialize(VulkanContext *ctx) {
+    m_ctx = ctx;
+    m_graphics_family = m_ctx->queue_indices.graphics_family.value();
+    m_transfer_family = m_ctx->queue_indices.transfer_family.value();
+
+    for (Batch &batch : m_batches) {
+        VkCommandPoolCreateInfo command_pool_create_info{};
+        command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        command_pool_create_info.queueFamilyIndex = m_transfer_family;
+        if (vkCreateCommandPool(
+                m_ctx->device, &command_pool_create_info, nullptr, &batch.command_pool
+            ) != VK_SUCCESS) {
+            VAIN_ERROR("failed to create upload command pool");
+        }
+
+        VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+        command_buffer_allocate_info.sType =
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        command_buffer_allocate_info.commandPool = batch.command_pool;
+        command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_allocate_info.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(
+                m_ctx->device, &command_buffer_allocate_info, &batch.command_buffer
+            ) != VK_SUCCESS) {
+            VAIN_ERROR("failed to allocate upload command buffer");
+        }
+
+        VkFenceCreateInfo fence_create_info{};
+        fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_ctx->device, &fence_create_info, nullptr, &batch.fence) !=
+            VK_SUCCESS) {
+            VAIN_ERROR("failed to create upload fence");
+        }
+    }
+}
+
+void UploadBatcher::clear() {
+    if (!m_ctx) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_in_flight_count; ++i) {
+        Batch &batch = m_batches[(m_oldest_batch + i) % k_batch_count];
+        m_ctx->waitForFences(m_ctx->device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    }
+
+    for (Batch &batch : m_batches) {
+        for (DedicatedStaging &staging : batch.dedicated_stagings) {
+            vmaDestroyBuffer(m_ctx->assets_allocator, staging.buffer, staging.allocation);
+        }
+        vkDestroyFence(m_ctx->device, batch.fence, nullptr);
+        vkDestroyCommandPool(m_ctx->device, batch.command_pool, nullptr);
+        batch = {};
+    }
+    for (PendingUpload &pending : m_pending) {
+        if (pending.dedicated_staging.buffer) {
+            vmaDestroyBuffer(
+                m_ctx->assets_allocator,
+                pending.dedicated_staging.buffer,
+                pending.dedicated_staging.allocation
+            );
+        }
+    }
+    resizeStaging(0);
+
+    m_pending.clear();
+    m_pending_bytes = 0;
+    m_unstaged_count = 0;
+    m_staging_head = 0;
+    m_staging_tail = 0;
+    m_idle_update_count = 0;
+    m_oldest_batch = 0;
+    m_in_flight_count = 0;
+    m_ctx = nullptr;
+}
+
+void UploadBatcher::enqueue(Upload &&upload) {
+    PendingUpload &pending = m_pending.emplace_back();
+    const void *data = upload.data;
+    pending.upload = std::move(upload);
+    pending.upload.data = nullptr;
+    m_pending_bytes += pending.upload.size;
+
+    if (pending.upload.size == 0) {
+        return;
+    }
+    // once one upload waits aside for the ring, later ones must not pass it
+    if (m_unstaged_count > 0 || !stage(pending, data)) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        pending.data.assign(bytes, bytes + pending.upload.size);
+        ++m_unstaged_count;
+    }
+}
+
+void UploadBatcher::enqueueCompletion(std::function<void()> complete) {
+    Upload upload{};
+    upload.complete = std::move(complete);
+    enqueue(std::move(upload));
+}
+
+bool UploadBatcher::update(VkCommandBuffer command_buffer) {
+    bool completed = false;
+    while (m_in_flight_count > 0 &&
+           vkGetFenceStatus(m_ctx->device, m_batches[m_oldest_batch].fence) ==
+               VK_SUCCESS) {
+        retireOldestBatch(command_buffer);
+        completed = true;
+    }
+
+    submitBatch();
+
+    // a quiet stretch hands the staging memory back, the next upload recreates it
+    if (m_pending.empty() && m_in_flight_count == 0 && m_staging_buffer) {
+        if (++m_idle_update_count >= k_staging_release_update_count) {
+            resizeStaging(0);
+        }
+    } else {
+        m_idle_update_count = 0;
+    }
+    return completed;
+}
+
+void UploadBatcher::flush() {
+    if (m_pending.empty() && m_in_flight_count == 0) {
+        return;
+    }
+
+    VkCommandBuffer command_buffer = m_ctx->beginSingleTimeCommands();
+    while (!m_pending.empty() || m_in_flight_count > 0) {
+        if (!m_pending.empty() && m_in_flight_count < k_batch_count && submitBatch()) {
+            continue;
+        }
+        if (m_in_flight_count == 0) {
+            VAIN_ERROR("failed to stage uploads");
+            break;
+        }
+
+        m_ctx->waitForFences(
+            m_ctx->device, 1, &m_batches[m_oldest_batch].fence, VK_TRUE, UINT64_MAX
+        );
+        retireOldestBatch(command_buffer);
+    }
+    m_ctx->endSingleTimeCommands(command_buffer);
+}
+
+void UploadBatcher::acquireBuffer(
+    VkCommandBuffer command_buffer,
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    VkDeviceSize size,
+    VkPipelineStageFlags dst_stage,
+    VkAccessFlags dst_access
+) const {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    // the copies ran on another queue, whose fence made the writes available
+    VkPipelineStageFlags src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (!dedicatedTransferQueue()) {
+        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+
+    vkCmdPipelineBarrier(
+        command_buffer, src_stage, dst_stage, 0, 0, nullptr, 1, &barrier, 0, nullptr
+    );
+}
+
+void UploadBatcher::releaseImage(
+    VkCommandBuffer command_buffer,
+    VkImage image,
+    uint32_t layer_count,
+    uint32_t mip_levels
+) const {
+    if (!dedicatedTransferQueue()) {
+        return;
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = m_transfer_family;
+    barrier.dstQueueFamilyIndex = m_graphics_family;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = mip_levels;
+    barrier.subresourceRange.layerCount = layer_count;
+
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier
+    );
+}
+
+void UploadBatcher::acquireImage(
+    VkCommandBuffer command_buffer,
+    VkImage image,
+    uint32_t layer_count,
+    uint32_t mip_levels
+) const {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = mip_levels;
+    barrier.subresourceRange.layerCount = layer_count;
+
+    VkPipelineStageFlags src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    if (dedicatedTransferQueue()) {
+        // the release made the writes available
+        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        barrier.srcQueueFamilyIndex = m_transfer_family;
+        barrier.dstQueueFamilyIndex = m_graphics_family;
+    } else {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+
+    vkCmdPipelineBarrier(
+        command_buffer,
+        src_stage,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier
+    );
+}
+
+bool UploadBatcher::submitBatch() {
+    if (m_pending.empty() || m_in_flight_count == k_batch_count) {
+        return false;
+    }
+
+    // the budget bounds the bytes copied by a batch, its first upload always goes
+    size_t count = 0;
+    VkDeviceSize batch_bytes = 0;
+    for (PendingUpload &pending : m_pending) {
+        VkDeviceSize size = pending.upload.size;
+        if (count > 0 && batch_bytes + size > m_frame_budget) {
+            break;
+        }
+        if (!pending.data.empty()) {
+            if (!stage(pending, pending.data.data())) {
+                break;
+            }
+            std::vector<uint8_t>().swap(pending.data);
+            --m_unstaged_count;
+        }
+        batch_bytes += size;
+        ++count;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    Batch &batch = m_batches[(m_oldest_batch + m_in_flight_count) % k_batch_count];
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    m_ctx->beginCommandBuffer(batch.command_buffer, &begin_info);
+
+    for (size_t i = 0; i < count; ++i) {
+        PendingUpload &pending = m_pending.front();
+        Upload &upload = pending.upload;
+        if (upload.record) {
+            upload.record(batch.command_buffer, pending.staging);
+        }
+        batch.finishes.push_back(std::move(upload.finish));
+        batch.completes.push_back(std::move(upload.complete));
+
+        if (pending.dedicated_staging.buffer) {
+            batch.dedicated_stagings.push_back(pending.dedicated_staging);
+        }
+        // the ring is taken in queue order, the last upload in it ends the batch part
+        if (pending.staging_end > 0) {
+            batch.staging_end = pending.staging_end;
+        }
+
+        m_pending_bytes -= upload.size;
+        m_pending.pop_front();
+    }
+
+    m_ctx->endCommandBuffer(batch.command_buffer);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch.command_buffer;
+    if (vkQueueSubmit(m_ctx->transfer_queue, 1, &submit_info, batch.fence) !=
+        VK_SUCCESS) {
+        VAIN_ERROR("failed to submit uploads");
+    }
+
+    ++m_in_flight_count;
+    ++m_submit_count;
+    return true;
+}
+
+void UploadBatcher::retireOldestBatch(VkCommandBuffer command_buffer) {
+    assert(m_in_flight_count > 0);
+    Batch &batch = m_batches[m_oldest_batch];
+
+    m_ctx->resetFences(m_ctx->device, 1, &batch.fence);
+    m_ctx->resetCommandPool(m_ctx->device, batch.command_pool, 0);
+
+    for (auto &finish : batch.finishes) {
+        if (finish) {
+            finish(command_buffer);
+        }
+    }
+    for (auto &complete : batch.completes) {
+        if (complete) {
+            complete();
+        }
+    }
+    batch.finishes.clear();
+    batch.completes.clear();
+
+    for (DedicatedStaging &staging : batch.dedicated_stagings) {
+        vmaDestroyBuffer(m_ctx->assets_allocator, staging.buffer, staging.allocation);
+    }
+    batch.dedicated_stagings.clear();
+
+    // batches retire in submission order, so the ring is freed up to this one
+    if (batch.staging_end > 0) {
+        m_staging_tail = batch.staging_end;
+        batch.staging_end = 0;
+    }
+
+    m_oldest_batch = (m_oldest_batch + 1) % k_batch_count;
+    --m_in_flight_count;
+}
+
+bool UploadBatcher::stage(PendingUpload &pending, const void *data) {
+    VkDeviceSize size = pending.upload.size;
+    // image copies want offsets on both the texel size and four bytes
+    VkDeviceSize alignment = std::lcm(pending.upload.alignment, VkDeviceSize{4});
+
+    VkDeviceSize capacity = m_staging_buffer ? m_staging_size : m_frame_budget;
+    if (size > capacity) {
+        pending.staging = createDedicatedStaging(pending.dedicated_staging, size);
+    } else if (!reserveStaging(size, alignment, pending.staging, pending.staging_end)) {
+        return false;
+    }
+
+    if (pending.staging.pointer) {
+        memcpy(pending.staging.pointer, data, size);
+    }
+    return true;
+}
+
+bool UploadBatcher::reserveStaging(
+    VkDeviceSize size,
+    VkDeviceSize alignment,
+    StagingSlice &staging,
+    VkDeviceSize &end
+) {
+    // the ring follows the budget whenever nothing in it is in use
+    if (m_staging_head == m_staging_tail) {
+        m_staging_head = 0;
+        m_staging_tail = 0;
+        if (m_staging_size != m_frame_budget) {
+            resizeStaging(m_frame_budget);
+        }
+    }
+    if (!m_staging_buffer || size > m_staging_size) {
+        return false;
+    }
+
+    // an upload not fitting before the end of the ring starts over at its beginning
+    VkDeviceSize position = m_staging_head % m_staging_size;
+    VkDeviceSize offset = ROUND_UP(position, alignment);
+    if (offset + size > m_staging_size) {
+        offset = 0;
+    }
+    VkDeviceSize begin = offset >= position
+                             ? m_staging_head + (offset - position)
+                             : m_staging_head + (m_staging_size - position);
+    if (begin + size - m_staging_tail > m_staging_size) {
+        return false;
+    }
+
+    staging.buffer = m_staging_buffer;
+    staging.offset = offset;
+    staging.pointer = m_staging_pointer + offset;
+    m_staging_head = begin + size;
+    end = m_staging_head;
+    return true;
+}
+
+UploadBatcher::StagingSlice UploadBatcher::createDedicatedStaging(
+    DedicatedStaging &dedicated_staging, VkDeviceSize size
+) {
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo allocation_info{};
+    if (vmaCreateBuffer(
+            m_ctx->assets_allocator,
+            &buffer_info,
+            &alloc_info,
+            &dedicated_staging.buffer,
+            &dedicated_staging.allocation,
+            &allocation_info
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create upload staging buffer");
+    }
+
+    StagingSlice staging{};
+    staging.buffer = dedicated_staging.buffer;
+    staging.pointer = allocation_info.pMappedData;
+    return staging;
+}
+
+void UploadBatcher::resizeStaging(VkDeviceSize size) {
+    if (m_staging_buffer) {
+        vmaDestroyBuffer(m_ctx->assets_allocator, m_staging_buffer, m_staging_allocation);
+    }
+    m_staging_buffer = VK_NULL_HANDLE;
+    m_staging_allocation = VK_NULL_HANDLE;
+    m_staging_pointer = nullptr;
+    m_staging_size = 0;
+
+    if (size == 0) {
+        return;
+    }
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo allocation_info{};
+    if (vmaCreateBuffer(
+            m_ctx->assets_allocator,
+            &buffer_info,
+            &alloc_info,
+            &m_staging_buffer,
+            &m_staging_allocation,
+            &allocation_info
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create upload staging buffer");
+        return;
+    }
+    m_staging_pointer = static_cast<uint8_t *>(allocation_info.pMappedData);
+    m_staging_size = size;
+}
+
+}  // namespace Vain
\ No newline at end of file
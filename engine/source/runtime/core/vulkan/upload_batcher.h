@@ -0,0 +1,184 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace Vain {
+
+class VulkanContext;
+
+// streams asset data to the device on the transfer queue without blocking the render
+// thread. uploads are written into a staging ring the size of the frame budget as they
+// are enqueued, and every frame the next ones, up to the frame budget of bytes, are
+// copied in one submission tracked by a fence. a finished batch is handed to the
+// graphics queue at the start of the next frame, which acquires ownership when the
+// transfer queue belongs to another family, and only then are its uploads complete and
+// its part of the ring free again
+class UploadBatcher {
+  public:
+    // batches in flight at once, a frame finding them all busy submits nothing
+    static constexpr uint32_t k_batch_count{4};
+    static constexpr VkDeviceSize k_default_frame_budget{32 * 1024 * 1024};
+    // updates without any upload before the staging ring is freed
+    static constexpr uint32_t k_staging_release_update_count{300};
+
+    struct StagingSlice {
+        VkBuffer buffer{};
+        VkDeviceSize offset{};
+        void *pointer{};
+    };
+
+    struct Upload {
+        // only read by enqueue, which copies the bytes straight into the staging ring,
+        // or aside while the ring is full
+        const void *data{};
+        VkDeviceSize size{};
+        // image copies pass their texel size
+        VkDeviceSize alignment{4};
+        // records the copies out of staging on the transfer queue, followed by the
+        // release half of the ownership transfer
+        std::function<void(VkCommandBuffer, const StagingSlice &)> record{};
+        // records on the graphics queue once the copies finished, starting with the
+        // acquire half, then whatever the transfer queue can't do
+        std::function<void(VkCommandBuffer)> finish{};
+        // the resource may be used by commands recorded after finish
+        std::function<void()> complete{};
+    };
+
+    UploadBatcher() = default;
+    ~UploadBatcher();
+
+    void initialize(VulkanContext *ctx);
+    // waits for the batches in flight and drops every upload without completing it
+    void clear();
+
+    void enqueue(Upload &&upload);
+    // complete is called once every upload enqueued before it has completed
+    void enqueueCompletion(std::function<void()> complete);
+
+    // once a frame, with the frame command buffer begun: finishes the batches whose
+    // copies are done into command_buffer and submits the next batch. returns whether
+    // any upload completed
+    bool update(VkCommandBuffer command_buffer);
+    // submits every waiting upload regardless of the budget and waits until all are
+    // complete, finishing them on a single time command buffer
+    void flush();
+
+    // an upload bigger than the budget still goes, alone in its batch
+    void setFrameBudget(VkDeviceSize budget) { m_frame_budget = budget; }
+    VkDeviceSize frameBudget() const { return m_frame_budget; }
+
+    // bytes of the uploads not submitted yet
+    VkDeviceSize pendingBytes() const { return m_pending_bytes; }
+    // 0 while the ring is freed
+    VkDeviceSize stagingSize() const { return m_staging_size; }
+    uint32_t inFlightBatchCount() const { return m_in_flight_count; }
+    uint32_t submitCount() const { return m_submit_count; }
+
+    bool dedicatedTransferQueue() const { return m_transfer_family != m_graphics_family; }
+
+    // makes a range just copied into a buffer visible to dst_access, the buffer is
+    // shared concurrently by both families when they differ
+    void acquireBuffer(
+        VkCommandBuffer command_buffer,
+        VkBuffer buffer,
+        VkDeviceSize offset,
+        VkDeviceSize size,
+        VkPipelineStageFlags dst_stage,
+        VkAccessFlags dst_access
+    ) const;
+    // the halves of the ownership transfer of an image just copied, which stays in
+    // transfer dst layout for the mips to be generated from it. with a single family
+    // release records nothing and acquire is a plain barrier after the copy
+    void releaseImage(
+        VkCommandBuffer command_buffer,
+        VkImage image,
+        uint32_t layer_count,
+        uint32_t mip_levels
+    ) const;
+    void acquireImage(
+        VkCommandBuffer command_buffer,
+        VkImage image,
+        uint32_t layer_count,
+        uint32_t mip_levels
+    ) const;
+
+  private:
+    struct DedicatedStaging {
+        VkBuffer buffer{};
+        VmaAllocation allocation{};
+    };
+
+    struct PendingUpload {
+        Upload upload{};
+        // where the data was staged, no buffer while it waits in data
+        StagingSlice staging{};
+        // ring position past the data, 0 when it isn't in the ring
+        VkDeviceSize staging_end{};
+        // uploads bigger than the ring
+        DedicatedStaging dedicated_staging{};
+        std::vector<uint8_t> data{};
+    };
+
+    struct Batch {
+        VkCommandPool command_pool{};
+        VkCommandBuffer command_buffer{};
+        VkFence fence{};
+
+        // ring position past the data of the batch, 0 when it has none in the ring
+        VkDeviceSize staging_end{};
+        std::vector<DedicatedStaging> dedicated_stagings{};
+
+        std::vector<std::function<void(VkCommandBuffer)>> finishes{};
+        std::vector<std::function<void()>> completes{};
+    };
+
+    VulkanContext *m_ctx{};
+    uint32_t m_graphics_family{};
+    uint32_t m_transfer_family{};
+
+    VkDeviceSize m_frame_budget{k_default_frame_budget};
+
+    std::deque<PendingUpload> m_pending{};
+    VkDeviceSize m_pending_bytes{};
+    // pending uploads whose data waits aside, later ones wait aside too so that the
+    // ring is taken in queue order
+    uint32_t m_unstaged_count{};
+
+    // positions only grow, the ring offset is the position modulo its size. the data
+    // from tail to head is in use
+    VkBuffer m_staging_buffer{};
+    VmaAllocation m_staging_allocation{};
+    uint8_t *m_staging_pointer{};
+    VkDeviceSize m_staging_size{};
+    VkDeviceSize m_staging_head{};
+    VkDeviceSize m_staging_tail{};
+    uint32_t m_idle_update_count{};
+
+    Batch m_batches[k_batch_count]{};
+    // in flight batches follow the oldest one round the array
+    uint32_t m_oldest_batch{};
+    uint32_t m_in_flight_count{};
+    uint32_t m_submit_count{};
+
+    // returns whether a batch was submitted
+    bool submitBatch();
+    void retireOldestBatch(VkCommandBuffer command_buffer);
+    // copies data to staging memory, false when the ring has no room for it yet
+    bool stage(PendingUpload &pending, const void *data);
+    bool reserveStaging(
+        VkDeviceSize size,
+        VkDeviceSize alignment,
+        StagingSlice &staging,
+        VkDeviceSize &end
+    );
+    StagingSlice createDedicatedStaging(DedicatedStaging &staging, VkDeviceSize size);
+    void resizeStaging(VkDeviceSize size);
+};
+
+}  // namespace Vain
\ No newline at end of file
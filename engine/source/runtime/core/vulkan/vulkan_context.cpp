@@ -1,5 +1,8 @@
 #include "vulkan_context.h"
 
+#include <assert.h>
+
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 #include <limits>
@@ -98,6 +101,21 @@ QueueFamilyIndices::QueueFamilyIndices(
         }
         i++;
     }
+
+    // a family without graphics copies alongside rendering, one without compute as
+    // well is usually the dedicated copy engine
+    for (i = 0; i < queue_family_count; ++i) {
+        VkQueueFlags flags = queue_families[i].queueFlags;
+        if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+            continue;
+        }
+        if (!transfer_family.has_value() || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+            transfer_family = i;
+        }
+    }
+    if (!transfer_family.has_value()) {
+        transfer_family = graphics_family;
+    }
 }
 
 SwapChainSupportDetails::SwapChainSupportDetails(
@@ -150,7 +168,7 @@ void VulkanContext::initialize(WindowSystem *window_system) {
 
     createCommandBuffers();
 
-    createDescriptorPool();
+    createDescriptorPools();
 
     createSyncPrimitives();
 
@@ -161,6 +179,8 @@ void VulkanContext::initialize(WindowSystem *window_system) {
     createDepthImageAndView();
 
     createAssetAllocator();
+
+    upload_batcher.initialize(this);
 }
 
 void VulkanContext::clear() {
@@ -178,6 +198,8 @@ void VulkanContext::clear() {
         m_nearest_sampler = VK_NULL_HANDLE;
     }
 
+    upload_batcher.clear();
+
     vmaDestroyAllocator(assets_allocator);
 
     vkDestroyImageView(device, depth_image_view, nullptr);
@@ -194,11 +216,24 @@ void VulkanContext::clear() {
         );
     }
 
-    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+    descriptor_allocator.clear();
+    for (auto &allocator : transient_descriptor_allocators) {
+        allocator.clear();
+    }
+    vkDestroyDescriptorPool(device, ui_descriptor_pool, nullptr);
+    vkDestroyDescriptorPool(device, bindless_descriptor_pool, nullptr);
 
     for (auto cmd_pool : command_pools_per_frame) {
         vkDestroyCommandPool(device, cmd_pool, nullptr);
     }
+    for (auto &cmd_pools : secondary_command_pools_per_frame) {
+        for (auto cmd_pool : cmd_pools) {
+            vkDestroyCommandPool(device, cmd_pool, nullptr);
+        }
+    }
+    for (auto cmd_pool : cached_secondary_command_pools) {
+        vkDestroyCommandPool(device, cmd_pool, nullptr);
+    }
     vkDestroyCommandPool(device, command_pool, nullptr);
     vkDestroyDevice(device, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -251,6 +286,112 @@ void VulkanContext::waitForFlight() const {
     }
 }
 
+void VulkanContext::resetSecondaryCommandPools() {
+    for (uint32_t i = 0; i < k_max_recording_thread_count; ++i) {
+        if (m_secondary_command_buffer_used_counts[m_current_frame_index][i] == 0) {
+            continue;
+        }
+
+        resetCommandPool(
+            device, secondary_command_pools_per_frame[m_current_frame_index][i], 0
+        );
+        m_secondary_command_buffer_used_counts[m_current_frame_index][i] = 0;
+    }
+}
+
+void VulkanContext::resetTransientDescriptorPools() {
+    transient_descriptor_allocators[m_current_frame_index].reset();
+}
+
+VkCommandBuffer VulkanContext::beginSecondaryCommandBuffer(
+    uint32_t thread_index,
+    VkRenderPass render_pass,
+    uint32_t subpass,
+    VkFramebuffer framebuffer
+) {
+    assert(thread_index < k_max_recording_thread_count);
+
+    auto &command_buffers =
+        m_secondary_command_buffers[m_current_frame_index][thread_index];
+    uint32_t &used_count =
+        m_secondary_command_buffer_used_counts[m_current_frame_index][thread_index];
+
+    if (used_count == command_buffers.size()) {
+        command_buffers.push_back(allocateSecondaryCommandBuffer(
+            secondary_command_pools_per_frame[m_current_frame_index][thread_index]
+        ));
+    }
+    VkCommandBuffer command_buffer = command_buffers[used_count++];
+
+    beginInheritingCommandBuffer(
+        command_buffer,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        render_pass,
+        subpass,
+        framebuffer
+    );
+    return command_buffer;
+}
+
+void VulkanContext::beginCachedSecondaryCommandBuffer(
+    uint32_t thread_index,
+    VkCommandBuffer &command_buffer,
+    VkRenderPass render_pass,
+    uint32_t subpass,
+    VkFramebuffer framebuffer
+) {
+    assert(thread_index < k_max_recording_thread_count);
+
+    if (command_buffer == VK_NULL_HANDLE) {
+        command_buffer =
+            allocateSecondaryCommandBuffer(cached_secondary_command_pools[thread_index]);
+    }
+
+    // beginning resets the buffer implicitly, its pool allows that per buffer
+    beginInheritingCommandBuffer(command_buffer, 0, render_pass, subpass, framebuffer);
+}
+
+VkCommandBuffer VulkanContext::allocateSecondaryCommandBuffer(
+    VkCommandPool command_pool
+) {
+    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_allocate_info.commandPool = command_pool;
+    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    command_buffer_allocate_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    if (vkAllocateCommandBuffers(
+            device, &command_buffer_allocate_info, &command_buffer
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to allocate secondary command buffer");
+    }
+    return command_buffer;
+}
+
+void VulkanContext::beginInheritingCommandBuffer(
+    VkCommandBuffer command_buffer,
+    VkCommandBufferUsageFlags flags,
+    VkRenderPass render_pass,
+    uint32_t subpass,
+    VkFramebuffer framebuffer
+) {
+    VkCommandBufferInheritanceInfo inheritance_info{};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.renderPass = render_pass;
+    inheritance_info.subpass = subpass;
+    inheritance_info.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    if (beginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        VAIN_ERROR("failed to begin secondary command buffer");
+    }
+}
+
 bool VulkanContext::prepareBeforePass(
     std::function<void()> passUpdateAfterRecreateSwapchain
 ) {
@@ -613,10 +754,39 @@ bool VulkanContext::isDeviceSuitable(
         return false;
     }
 
-    VkPhysicalDeviceFeatures physical_device_features;
-    vkGetPhysicalDeviceFeatures(physical_device, &physical_device_features);
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &physical_device_properties);
+    if (physical_device_properties.apiVersion < s_vulkan_api_version) {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features{};
+    descriptor_indexing_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    VkPhysicalDeviceFeatures2 physical_device_features{};
+    physical_device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    physical_device_features.pNext = &descriptor_indexing_features;
+    vkGetPhysicalDeviceFeatures2(physical_device, &physical_device_features);
+
+    // bindless materials
+    if (!descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing ||
+        !descriptor_indexing_features.runtimeDescriptorArray ||
+        !descriptor_indexing_features.descriptorBindingPartiallyBound ||
+        !descriptor_indexing_features.descriptorBindingVariableDescriptorCount ||
+        !descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind ||
+        !descriptor_indexing_features.descriptorBindingStorageBufferUpdateAfterBind ||
+        !descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending) {
+        return false;
+    }
 
-    return physical_device_features.samplerAnisotropy;
+    // gpu driven draws, one indirect call covers many meshes at their own instances
+    if (!physical_device_features.features.multiDrawIndirect ||
+        !physical_device_features.features.drawIndirectFirstInstance) {
+        return false;
+    }
+
+    return physical_device_features.features.samplerAnisotropy;
 }
 
 VkFormat VulkanContext::findDepthFormat(VkPhysicalDevice physical_device) {
@@ -624,7 +794,8 @@ VkFormat VulkanContext::findDepthFormat(VkPhysicalDevice physical_device) {
         physical_device,
         {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
     );
 }
 
@@ -749,7 +920,8 @@ void VulkanContext::createLogicalDevice() {
     std::set<uint32_t> queue_families = {
         queue_indices.graphics_family.value(),
         queue_indices.present_family.value(),
-        queue_indices.compute_family.value()
+        queue_indices.compute_family.value(),
+        queue_indices.transfer_family.value()
     };
 
     float queue_priority = 1.0f;
@@ -767,13 +939,27 @@ void VulkanContext::createLogicalDevice() {
     physical_device_features.fragmentStoresAndAtomics = VK_TRUE;
 
     physical_device_features.independentBlend = VK_TRUE;
+    physical_device_features.multiDrawIndirect = VK_TRUE;
+    physical_device_features.drawIndirectFirstInstance = VK_TRUE;
 
     if (m_enable_point_light_shadow) {
         physical_device_features.geometryShader = VK_TRUE;
     }
 
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features{};
+    descriptor_indexing_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    descriptor_indexing_features.runtimeDescriptorArray = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = &descriptor_indexing_features;
     device_create_info.pQueueCreateInfos = queue_create_infos.data();
     device_create_info.queueCreateInfoCount =
         static_cast<uint32_t>(queue_create_infos.size());
@@ -791,6 +977,7 @@ void VulkanContext::createLogicalDevice() {
     vkGetDeviceQueue(device, queue_indices.graphics_family.value(), 0, &graphics_queue);
     vkGetDeviceQueue(device, queue_indices.present_family.value(), 0, &present_queue);
     vkGetDeviceQueue(device, queue_indices.compute_family.value(), 0, &compute_queue);
+    vkGetDeviceQueue(device, queue_indices.transfer_family.value(), 0, &transfer_queue);
 
     // more efficient pointer
     waitForFences = reinterpret_cast<PFN_vkWaitForFences>(
@@ -838,9 +1025,15 @@ void VulkanContext::createLogicalDevice() {
     cmdDrawIndexed = reinterpret_cast<PFN_vkCmdDrawIndexed>(
         vkGetDeviceProcAddr(device, "vkCmdDrawIndexed")
     );
+    cmdDrawIndexedIndirect = reinterpret_cast<PFN_vkCmdDrawIndexedIndirect>(
+        vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirect")
+    );
     cmdClearAttachments = reinterpret_cast<PFN_vkCmdClearAttachments>(
         vkGetDeviceProcAddr(device, "vkCmdClearAttachments")
     );
+    cmdExecuteCommands = reinterpret_cast<PFN_vkCmdExecuteCommands>(
+        vkGetDeviceProcAddr(device, "vkCmdExecuteCommands")
+    );
 }
 
 void VulkanContext::createCommandPool() {
@@ -874,6 +1067,29 @@ void VulkanContext::createCommandPool() {
                 ) != VK_SUCCESS) {
                 VAIN_ERROR("failed to create command pool");
             }
+
+            for (uint32_t j = 0; j < k_max_recording_thread_count; ++j) {
+                if (vkCreateCommandPool(
+                        device,
+                        &command_pool_create_info,
+                        nullptr,
+                        &secondary_command_pools_per_frame[i][j]
+                    ) != VK_SUCCESS) {
+                    VAIN_ERROR("failed to create secondary command pool");
+                }
+            }
+        }
+
+        command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        for (uint32_t i = 0; i < k_max_recording_thread_count; ++i) {
+            if (vkCreateCommandPool(
+                    device,
+                    &command_pool_create_info,
+                    nullptr,
+                    &cached_secondary_command_pools[i]
+                ) != VK_SUCCESS) {
+                VAIN_ERROR("failed to create secondary command pool");
+            }
         }
     }
 }
@@ -895,33 +1111,63 @@ void VulkanContext::createCommandBuffers() {
     }
 }
 
-void VulkanContext::createDescriptorPool() {
-    VkDescriptorPoolSize pool_sizes[7];
-    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-    pool_sizes[0].descriptorCount = 3 + 2 + 2 + 2 + 1 + 1 + 3 + 3;
-    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    pool_sizes[1].descriptorCount = 2;
-    pool_sizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_sizes[2].descriptorCount = k_max_material_count;
-    pool_sizes[3].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    pool_sizes[3].descriptorCount = 5 + 5 * k_max_material_count;
-    pool_sizes[4].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-    pool_sizes[4].descriptorCount = 4 + 1 + 1 + 2;
-    pool_sizes[5].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    pool_sizes[5].descriptorCount = 3;
-    pool_sizes[6].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    pool_sizes[6].descriptorCount = 1;
-
-    VkDescriptorPoolCreateInfo pool_info{};
-    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_info.poolSizeCount = ARRAY_SIZE(pool_sizes);
-    pool_info.pPoolSizes = pool_sizes;
-    pool_info.maxSets = 5 + k_max_material_count;
-    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-    if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) !=
+void VulkanContext::createDescriptorPools() {
+    // the pools grow with the sets asked for, a few dozen cover the passes
+    descriptor_allocator.initialize(device, 64);
+    for (auto &allocator : transient_descriptor_allocators) {
+        allocator.initialize(device, 64);
+    }
+
+    VkDescriptorPoolSize ui_pool_size{};
+    ui_pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    ui_pool_size.descriptorCount = 16;
+
+    VkDescriptorPoolCreateInfo ui_pool_info{};
+    ui_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    ui_pool_info.poolSizeCount = 1;
+    ui_pool_info.pPoolSizes = &ui_pool_size;
+    ui_pool_info.maxSets = 16;
+    ui_pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+    if (vkCreateDescriptorPool(device, &ui_pool_info, nullptr, &ui_descriptor_pool) !=
         VK_SUCCESS) {
-        VAIN_ERROR("failed to create descriptor pool");
+        VAIN_ERROR("failed to create ui descriptor pool");
+    }
+
+    VkPhysicalDeviceDescriptorIndexingProperties descriptor_indexing_properties{};
+    descriptor_indexing_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 physical_device_properties{};
+    physical_device_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    physical_device_properties.pNext = &descriptor_indexing_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &physical_device_properties);
+
+    bindless_texture_count = std::min(
+        {k_max_bindless_texture_count,
+         descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+         descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+         descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+         descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages}
+    );
+
+    VkDescriptorPoolSize bindless_pool_sizes[2];
+    bindless_pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindless_pool_sizes[0].descriptorCount = 1;
+    bindless_pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindless_pool_sizes[1].descriptorCount = bindless_texture_count;
+
+    VkDescriptorPoolCreateInfo bindless_pool_info{};
+    bindless_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    bindless_pool_info.poolSizeCount = ARRAY_SIZE(bindless_pool_sizes);
+    bindless_pool_info.pPoolSizes = bindless_pool_sizes;
+    bindless_pool_info.maxSets = 1;
+    bindless_pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+
+    if (vkCreateDescriptorPool(
+            device, &bindless_pool_info, nullptr, &bindless_descriptor_pool
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create bindless descriptor pool");
     }
 }
 
@@ -1071,7 +1317,8 @@ void VulkanContext::createDepthImageAndView() {
         depth_image_format,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
-            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         0,
         1,
@@ -13,6 +13,9 @@
 #include <optional>
 #include <vector>
 
+#include "core/vulkan/descriptor_allocator.h"
+#include "core/vulkan/upload_batcher.h"
+
 namespace Vain {
 
 enum class DefaultSamplerType { DEFAULT_SAMPLER_LINEAR, DEFAULT_SAMPLER_NEAREST };
@@ -21,6 +24,8 @@ struct QueueFamilyIndices {
     std::optional<uint32_t> graphics_family;
     std::optional<uint32_t> present_family;
     std::optional<uint32_t> compute_family;
+    // graphics_family when the device has no family for copies alone
+    std::optional<uint32_t> transfer_family;
 
     QueueFamilyIndices() = default;
     QueueFamilyIndices(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
@@ -46,7 +51,9 @@ class WindowSystem;
 class VulkanContext {
   public:
     static constexpr uint32_t k_max_frames_in_flight{3};
-    static constexpr uint32_t k_max_material_count{256};
+    // upper bound of the bindless texture array, the device limit may lower it
+    static constexpr uint32_t k_max_bindless_texture_count{1 << 18};
+    static constexpr uint32_t k_max_recording_thread_count{16};
     // static constexpr uint32_t k_max_vertex_blending_mesh_count{256};
 
 #ifndef NDEBUG
@@ -71,12 +78,28 @@ class VulkanContext {
     VkQueue graphics_queue{};
     VkQueue present_queue{};
     VkQueue compute_queue{};
+    VkQueue transfer_queue{};
 
     VkCommandPool command_pool{};
     VkCommandPool command_pools_per_frame[k_max_frames_in_flight]{};
     VkCommandBuffer command_buffers_per_frame[k_max_frames_in_flight]{};
-
-    VkDescriptorPool descriptor_pool{};
+    // secondary command buffers recorded in parallel, a pool is owned by one recording
+    // thread at a time
+    VkCommandPool secondary_command_pools_per_frame[k_max_frames_in_flight]
+                                                   [k_max_recording_thread_count]{};
+    // secondary command buffers kept across frames and recorded again in place, never
+    // reset as a whole
+    VkCommandPool cached_secondary_command_pools[k_max_recording_thread_count]{};
+
+    // sets that live as long as their pass
+    DescriptorAllocator descriptor_allocator{};
+    // sets written and bound within one frame, freed in bulk when the frame comes round
+    DescriptorAllocator transient_descriptor_allocators[k_max_frames_in_flight]{};
+    // imgui frees its own sets
+    VkDescriptorPool ui_descriptor_pool{};
+    // update after bind pool for the bindless materials set
+    VkDescriptorPool bindless_descriptor_pool{};
+    uint32_t bindless_texture_count{};
 
     VkSemaphore image_available_for_render_semaphores[k_max_frames_in_flight]{};
     VkSemaphore image_finished_for_presentation_semaphores[k_max_frames_in_flight]{};
@@ -94,6 +117,8 @@ class VulkanContext {
     VkImageView depth_image_view{};
 
     VmaAllocator assets_allocator{};
+    // asset uploads, copied on transfer_queue a frame budget at a time
+    UploadBatcher upload_batcher{};
 
     // function pointers
     PFN_vkWaitForFences waitForFences{};
@@ -112,7 +137,9 @@ class VulkanContext {
     PFN_vkCmdBindDescriptorSets cmdBindDescriptorSets{};
     PFN_vkCmdDraw cmdDraw{};
     PFN_vkCmdDrawIndexed cmdDrawIndexed{};
+    PFN_vkCmdDrawIndexedIndirect cmdDrawIndexedIndirect{};
     PFN_vkCmdClearAttachments cmdClearAttachments{};
+    PFN_vkCmdExecuteCommands cmdExecuteCommands{};
 
     VulkanContext() = default;
     ~VulkanContext();
@@ -125,6 +152,28 @@ class VulkanContext {
 
     void waitForFlight() const;
 
+    // resets the secondary command pools of the current frame
+    void resetSecondaryCommandPools();
+    // frees the transient descriptor sets of the current frame
+    void resetTransientDescriptorPools();
+    // begins a secondary command buffer continuing subpass of render_pass, recorded from
+    // the pool of thread_index
+    VkCommandBuffer beginSecondaryCommandBuffer(
+        uint32_t thread_index,
+        VkRenderPass render_pass,
+        uint32_t subpass,
+        VkFramebuffer framebuffer
+    );
+    // begins command_buffer again for reuse over many frames, allocating it from the
+    // cached pool of thread_index when it is null. it must not be pending
+    void beginCachedSecondaryCommandBuffer(
+        uint32_t thread_index,
+        VkCommandBuffer &command_buffer,
+        VkRenderPass render_pass,
+        uint32_t subpass,
+        VkFramebuffer framebuffer
+    );
+
     bool prepareBeforePass(std::function<void()> passUpdateAfterRecreateSwapchain);
     void submitRendering(std::function<void()> passUpdateAfterRecreateSwapchain);
 
@@ -139,6 +188,10 @@ class VulkanContext {
         return command_buffers_per_frame[m_current_frame_index];
     }
 
+    DescriptorAllocator &currentTransientDescriptorAllocator() {
+        return transient_descriptor_allocators[m_current_frame_index];
+    }
+
     uint32_t currentFrameIndex() const { return m_current_frame_index; }
 
     uint32_t currentSwapchainImageIndex() const {
@@ -152,7 +205,7 @@ class VulkanContext {
     bool enablePointLightShadow() const { return m_enable_point_light_shadow; }
 
   private:
-    static constexpr uint32_t s_vulkan_api_version{VK_API_VERSION_1_0};
+    static constexpr uint32_t s_vulkan_api_version{VK_API_VERSION_1_2};
     static constexpr std::array s_validation_layers = {"VK_LAYER_KHRONOS_validation"};
     static constexpr std::array s_device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
@@ -166,6 +219,13 @@ class VulkanContext {
     VkSampler m_linear_sampler{};
     std::map<uint32_t, VkSampler> m_mipmap_samplers{};
 
+    // secondary command buffers are kept allocated and reused after each pool reset
+    using SecondaryCommandBuffers = std::vector<VkCommandBuffer>;
+    SecondaryCommandBuffers m_secondary_command_buffers[k_max_frames_in_flight]
+                                                       [k_max_recording_thread_count]{};
+    uint32_t m_secondary_command_buffer_used_counts[k_max_frames_in_flight]
+                                                   [k_max_recording_thread_count]{};
+
     PFN_vkCmdBeginDebugUtilsLabelEXT m_vkCmdBeginDebugUtilsLabelEXT{};
     PFN_vkCmdEndDebugUtilsLabelEXT m_vkCmdEndDebugUtilsLabelEXT{};
 
@@ -182,7 +242,7 @@ class VulkanContext {
     void createLogicalDevice();
     void createCommandPool();
     void createCommandBuffers();
-    void createDescriptorPool();
+    void createDescriptorPools();
     void createSyncPrimitives();
     void createSwapchain();
     void createSwapchainImageViews();
@@ -191,6 +251,15 @@ class VulkanContext {
 
     void clearSwapchain();
     void recreateSwapchain();
+
+    VkCommandBuffer allocateSecondaryCommandBuffer(VkCommandPool command_pool);
+    void beginInheritingCommandBuffer(
+        VkCommandBuffer command_buffer,
+        VkCommandBufferUsageFlags flags,
+        VkRenderPass render_pass,
+        uint32_t subpass,
+        VkFramebuffer framebuffer
+    );
 };
 
 }  // namespace Vain
\ No newline at end of file
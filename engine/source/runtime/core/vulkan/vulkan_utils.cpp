@@ -1,6 +1,7 @@
 #include "vulkan_utils.h"
 
 #include "core/base/macro.h"
+#include "upload_batcher.h"
 #include "vulkan_context.h"
 
 namespace Vain {
@@ -97,18 +98,17 @@ void copyBuffer(
 }
 
 void copyBufferToImage(
-    VulkanContext *ctx,
+    VkCommandBuffer command_buffer,
     VkBuffer buffer,
+    VkDeviceSize buffer_offset,
     VkImage image,
     uint32_t width,
     uint32_t height,
     uint32_t layer_count
 ) {
-    VkCommandBuffer command_buffer = ctx->beginSingleTimeCommands();
-
     VkBufferImageCopy region{};
 
-    region.bufferOffset = 0;
+    region.bufferOffset = buffer_offset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -121,8 +121,6 @@ void copyBufferToImage(
     vkCmdCopyBufferToImage(
         command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region
     );
-
-    ctx->endSingleTimeCommands(command_buffer);
 }
 
 void createImage(
@@ -207,6 +205,80 @@ VkImageView createImageView(
     return image_view;
 }
 
+uint32_t texelSize(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_R8G8B8_SRGB:
+        return 3;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return 4;
+    case VK_FORMAT_R32G32_SFLOAT:
+        return 4 * 2;
+    case VK_FORMAT_R32G32B32_SFLOAT:
+        return 4 * 3;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 4 * 4;
+    default:
+        return 0;
+    }
+}
+
+// copies mip 0 on the transfer queue, the mips are generated on the graphics queue as
+// blits need it
+static void enqueueImageUpload(
+    VulkanContext *ctx,
+    UploadBatcher::Upload &&upload,
+    VkImage image,
+    VkFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t layer_count,
+    uint32_t mip_levels
+) {
+    UploadBatcher *upload_batcher = &ctx->upload_batcher;
+
+    upload.record = [=](VkCommandBuffer command_buffer,
+                        const UploadBatcher::StagingSlice &staging) {
+        transitionImageLayout(
+            command_buffer,
+            image,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            layer_count,
+            mip_levels,
+            VK_IMAGE_ASPECT_COLOR_BIT
+        );
+        copyBufferToImage(
+            command_buffer,
+            staging.buffer,
+            staging.offset,
+            image,
+            width,
+            height,
+            layer_count
+        );
+        upload_batcher->releaseImage(command_buffer, image, layer_count, mip_levels);
+    };
+
+    VkPhysicalDevice physical_device = ctx->physical_device;
+    upload.finish = [=](VkCommandBuffer command_buffer) {
+        upload_batcher->acquireImage(command_buffer, image, layer_count, mip_levels);
+        generateTextureMipMaps(
+            physical_device,
+            command_buffer,
+            image,
+            format,
+            width,
+            height,
+            layer_count,
+            mip_levels
+        );
+    };
+
+    upload_batcher->enqueue(std::move(upload));
+}
+
 void createTexture(
     VulkanContext *ctx,
     uint32_t texture_image_width,
@@ -222,49 +294,13 @@ void createTexture(
         return;
     }
 
-    VkDeviceSize texture_byte_size;
-
-    switch (texture_image_format) {
-    case VK_FORMAT_R8G8B8_UNORM:
-    case VK_FORMAT_R8G8B8_SRGB:
-        texture_byte_size = texture_image_width * texture_image_height * 3;
-        break;
-    case VK_FORMAT_R8G8B8A8_UNORM:
-    case VK_FORMAT_R8G8B8A8_SRGB:
-        texture_byte_size = texture_image_width * texture_image_height * 4;
-        break;
-    case VK_FORMAT_R32G32_SFLOAT:
-        texture_byte_size = texture_image_width * texture_image_height * 4 * 2;
-        break;
-    case VK_FORMAT_R32G32B32_SFLOAT:
-        texture_byte_size = texture_image_width * texture_image_height * 4 * 3;
-        break;
-    case VK_FORMAT_R32G32B32A32_SFLOAT:
-        texture_byte_size = texture_image_width * texture_image_height * 4 * 4;
-        break;
-    default:
-        texture_byte_size = VkDeviceSize(-1);
+    uint32_t texel_size = texelSize(texture_image_format);
+    if (texel_size == 0) {
         VAIN_ERROR("invalid texture image format");
         return;
     }
-
-    VkBuffer inefficient_staging_buffer;
-    VkDeviceMemory inefficient_staging_buffer_memory;
-    createBuffer(
-        ctx->physical_device,
-        ctx->device,
-        texture_byte_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        inefficient_staging_buffer,
-        inefficient_staging_buffer_memory
-    );
-    void *data = nullptr;
-    vkMapMemory(
-        ctx->device, inefficient_staging_buffer_memory, 0, texture_byte_size, 0, &data
-    );
-    memcpy(data, texture_image_pixels, texture_byte_size);
-    vkUnmapMemory(ctx->device, inefficient_staging_buffer_memory);
+    VkDeviceSize texture_byte_size =
+        VkDeviceSize{texture_image_width} * texture_image_height * texel_size;
 
     if (mip_levels == 0) {
         mip_levels = floor(log2(std::max(texture_image_width, texture_image_height))) + 1;
@@ -299,29 +335,23 @@ void createTexture(
         nullptr
     );
 
-    transitionImageLayout(
-        ctx,
+    image_view = createImageView(
+        ctx->device,
         image,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        texture_image_format,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_VIEW_TYPE_2D,
         1,
-        mip_levels,
-        VK_IMAGE_ASPECT_COLOR_BIT
-    );
-    copyBufferToImage(
-        ctx,
-        inefficient_staging_buffer,
-        image,
-        texture_image_width,
-        texture_image_height,
-        1
+        mip_levels
     );
 
-    vkDestroyBuffer(ctx->device, inefficient_staging_buffer, nullptr);
-    vkFreeMemory(ctx->device, inefficient_staging_buffer_memory, nullptr);
-
-    generateTextureMipMaps(
+    UploadBatcher::Upload upload{};
+    upload.data = texture_image_pixels;
+    upload.size = texture_byte_size;
+    upload.alignment = texel_size;
+    enqueueImageUpload(
         ctx,
+        std::move(upload),
         image,
         texture_image_format,
         texture_image_width,
@@ -329,16 +359,6 @@ void createTexture(
         1,
         mip_levels
     );
-
-    image_view = createImageView(
-        ctx->device,
-        image,
-        texture_image_format,
-        VK_IMAGE_ASPECT_COLOR_BIT,
-        VK_IMAGE_VIEW_TYPE_2D,
-        1,
-        mip_levels
-    );
 }
 
 void createCubeMap(
@@ -352,34 +372,14 @@ void createCubeMap(
     VkImageView &image_view,
     VmaAllocation &image_allocation
 ) {
-    VkDeviceSize texture_layer_byte_size;
-    VkDeviceSize cube_byte_size;
-
-    switch (texture_image_format) {
-    case VK_FORMAT_R8G8B8_UNORM:
-    case VK_FORMAT_R8G8B8_SRGB:
-        texture_layer_byte_size = texture_image_width * texture_image_height * 3;
-        break;
-    case VK_FORMAT_R8G8B8A8_UNORM:
-    case VK_FORMAT_R8G8B8A8_SRGB:
-        texture_layer_byte_size = texture_image_width * texture_image_height * 4;
-        break;
-    case VK_FORMAT_R32G32_SFLOAT:
-        texture_layer_byte_size = texture_image_width * texture_image_height * 4 * 2;
-        break;
-    case VK_FORMAT_R32G32B32_SFLOAT:
-        texture_layer_byte_size = texture_image_width * texture_image_height * 4 * 3;
-        break;
-    case VK_FORMAT_R32G32B32A32_SFLOAT:
-        texture_layer_byte_size = texture_image_width * texture_image_height * 4 * 4;
-        break;
-    default:
-        texture_layer_byte_size = VkDeviceSize(-1);
+    uint32_t texel_size = texelSize(texture_image_format);
+    if (texel_size == 0) {
         VAIN_ERROR("invalid texture image format");
         return;
     }
-
-    cube_byte_size = 6 * texture_layer_byte_size;
+    VkDeviceSize texture_layer_byte_size =
+        VkDeviceSize{texture_image_width} * texture_image_height * texel_size;
+    VkDeviceSize cube_byte_size = 6 * texture_layer_byte_size;
 
     if (mip_levels == 0) {
         mip_levels = floor(log2(std::max(texture_image_width, texture_image_height))) + 1;
@@ -415,55 +415,32 @@ void createCubeMap(
         nullptr
     );
 
-    VkBuffer inefficient_staging_buffer;
-    VkDeviceMemory inefficient_staging_buffer_memory;
-    createBuffer(
-        ctx->physical_device,
+    image_view = createImageView(
         ctx->device,
-        cube_byte_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        inefficient_staging_buffer,
-        inefficient_staging_buffer_memory
+        image,
+        texture_image_format,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_VIEW_TYPE_CUBE,
+        6,
+        mip_levels
     );
 
-    void *data = nullptr;
-    vkMapMemory(
-        ctx->device, inefficient_staging_buffer_memory, 0, cube_byte_size, 0, &data
-    );
+    // the faces are copied out of staging as one block
+    std::vector<uint8_t> cube_pixels(cube_byte_size);
     for (int i = 0; i < 6; i++) {
         memcpy(
-            (void *)(static_cast<char *>(data) + texture_layer_byte_size * i),
+            cube_pixels.data() + texture_layer_byte_size * i,
             texture_image_pixels[i],
             static_cast<size_t>(texture_layer_byte_size)
         );
     }
-    vkUnmapMemory(ctx->device, inefficient_staging_buffer_memory);
-
-    transitionImageLayout(
-        ctx,
-        image,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        6,
-        mip_levels,
-        VK_IMAGE_ASPECT_COLOR_BIT
-    );
-
-    copyBufferToImage(
-        ctx,
-        inefficient_staging_buffer,
-        image,
-        texture_image_width,
-        texture_image_height,
-        6
-    );
-
-    vkDestroyBuffer(ctx->device, inefficient_staging_buffer, nullptr);
-    vkFreeMemory(ctx->device, inefficient_staging_buffer_memory, nullptr);
-
-    generateTextureMipMaps(
+    UploadBatcher::Upload upload{};
+    upload.data = cube_pixels.data();
+    upload.size = cube_byte_size;
+    upload.alignment = texel_size;
+    enqueueImageUpload(
         ctx,
+        std::move(upload),
         image,
         texture_image_format,
         texture_image_width,
@@ -471,20 +448,11 @@ void createCubeMap(
         6,
         mip_levels
     );
-
-    image_view = createImageView(
-        ctx->device,
-        image,
-        texture_image_format,
-        VK_IMAGE_ASPECT_COLOR_BIT,
-        VK_IMAGE_VIEW_TYPE_CUBE,
-        6,
-        mip_levels
-    );
 }
 
 void generateTextureMipMaps(
-    VulkanContext *ctx,
+    VkPhysicalDevice physical_device,
+    VkCommandBuffer command_buffer,
     VkImage image,
     VkFormat image_format,
     uint32_t texture_width,
@@ -493,17 +461,13 @@ void generateTextureMipMaps(
     uint32_t mip_levels
 ) {
     VkFormatProperties format_properties;
-    vkGetPhysicalDeviceFormatProperties(
-        ctx->physical_device, image_format, &format_properties
-    );
+    vkGetPhysicalDeviceFormatProperties(physical_device, image_format, &format_properties);
     if (!(format_properties.optimalTilingFeatures &
           VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
         VAIN_ERROR("linear bliting not supported");
         return;
     }
 
-    VkCommandBuffer command_buffer = ctx->beginSingleTimeCommands();
-
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
@@ -603,12 +567,10 @@ void generateTextureMipMaps(
         1,
         &barrier
     );
-
-    ctx->endSingleTimeCommands(command_buffer);
 }
 
 void transitionImageLayout(
-    VulkanContext *ctx,
+    VkCommandBuffer command_buffer,
     VkImage image,
     VkImageLayout old_layout,
     VkImageLayout new_layout,
@@ -616,7 +578,6 @@ void transitionImageLayout(
     uint32_t mip_levels,
     VkImageAspectFlags aspect_mask_bits
 ) {
-    VkCommandBuffer command_buffer = ctx->beginSingleTimeCommands();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -686,8 +647,6 @@ void transitionImageLayout(
         1,
         &barrier
     );
-
-    ctx->endSingleTimeCommands(command_buffer);
 }
 
 };  // namespace Vain
\ No newline at end of file
@@ -39,9 +39,11 @@ void copyBuffer(
     VkDeviceSize size
 );
 
+// records the copy of mip 0 of every layer into command_buffer
 void copyBufferToImage(
-    VulkanContext *ctx,
+    VkCommandBuffer command_buffer,
     VkBuffer buffer,
+    VkDeviceSize buffer_offset,
     VkImage image,
     uint32_t width,
     uint32_t height,
@@ -74,6 +76,12 @@ VkImageView createImageView(
     uint32_t mip_levels
 );
 
+// bytes per texel of the texture formats the loaders produce, 0 for others
+uint32_t texelSize(VkFormat format);
+
+// createTexture and createCubeMap create the image and its view right away and queue a
+// copy of the pixels on the upload batcher of ctx, the image may be sampled once
+// everything queued so far has completed
 void createTexture(
     VulkanContext *ctx,
     uint32_t texture_image_width,
@@ -98,8 +106,10 @@ void createCubeMap(
     VmaAllocation &image_allocation
 );
 
+// the two below only record into command_buffer
 void generateTextureMipMaps(
-    VulkanContext *ctx,
+    VkPhysicalDevice physical_device,
+    VkCommandBuffer command_buffer,
     VkImage image,
     VkFormat image_format,
     uint32_t texture_width,
@@ -109,7 +119,7 @@ void generateTextureMipMaps(
 );
 
 void transitionImageLayout(
-    VulkanContext *ctx,
+    VkCommandBuffer command_buffer,
     VkImage image,
     VkImageLayout old_layout,
     VkImageLayout new_layout,
@@ -1,5 +1,6 @@
 #include "global_context.h"
 
+#include "core/base/thread_pool.h"
 #include "core/log/log_system.h"
 #include "core/meta/auto_register.h"
 #include "function/render/render_system.h"
@@ -14,6 +15,8 @@ RuntimeGlobalContext g_runtime_global_context;
 void RuntimeGlobalContext::startSystems(const std::filesystem::path &config_file_path) {
     log_system = std::make_unique<LogSystem>();
 
+    thread_pool = std::make_unique<ThreadPool>();
+
     config_manager = std::make_unique<ConfigManager>();
     config_manager->initialize(config_file_path);
 
@@ -35,6 +38,7 @@ void RuntimeGlobalContext::shutdownSystems() {
     m_auto_reflection_register.reset();
     asset_manager.reset();
     config_manager.reset();
+    thread_pool.reset();
     log_system.reset();
 }
 
@@ -6,6 +6,7 @@
 namespace Vain {
 
 class LogSystem;
+class ThreadPool;
 class RenderSystem;
 class WindowSystem;
 class ConfigManager;
@@ -18,6 +19,7 @@ class RuntimeGlobalContext {
     void shutdownSystems();
 
     std::unique_ptr<LogSystem> log_system{};
+    std::unique_ptr<ThreadPool> thread_pool{};
     std::unique_ptr<ConfigManager> config_manager{};
     std::unique_ptr<AssetManager> asset_manager{};
     std::unique_ptr<WindowSystem> window_system{};
@@ -0,0 +1,204 @@
+#include "draw_list.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Vain {
+
+static constexpr uint32_t k_radix_bits = 8;
+static constexpr uint32_t k_radix_size = 1 << k_radix_bits;
+
+static uint64_t packField(uint64_t value, uint32_t bits, uint32_t shift) {
+    return (value & ((uint64_t{1} << bits) - 1)) << shift;
+}
+
+// positive floats order like their bit patterns, the high bits make a log scale bucket
+static uint64_t depthBucket(float depth) {
+    depth = std::max(depth, 0.0f);
+
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+
+    return bits >> (32 - DrawList::k_depth_bits);
+}
+
+void DrawList::update(
+    const std::vector<RenderNode> &nodes,
+    uint64_t nodes_version,
+    const glm::mat4 *depth_proj_view
+) {
+    if (m_nodes_version == nodes_version && m_nodes_count == nodes.size()) {
+        return;
+    }
+    m_nodes_version = nodes_version;
+    m_nodes_count = nodes.size();
+
+    constexpr uint32_t depth_shift = 0;
+    constexpr uint32_t material_shift = depth_shift + k_depth_bits;
+    constexpr uint32_t mesh_shift = material_shift + k_material_bits;
+    constexpr uint32_t pipeline_shift = mesh_shift + k_mesh_bits;
+    static_assert(pipeline_shift + k_pipeline_bits == 64);
+
+    ++m_update_count;
+    m_patch_packets.clear();
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        const RenderNode &node = nodes[i];
+        const RenderEntity *entity = node.ref_entity;
+
+        uint64_t depth_bucket = 0;
+        if (depth_proj_view) {
+            glm::vec4 center{entity->world_aabb.center, 1.0f};
+            depth_bucket = depthBucket((*depth_proj_view * center).w);
+        }
+
+        // every pass draws with one pipeline for now, the field keeps room for variants
+        uint64_t pipeline = 0;
+
+        Packet packet{};
+        packet.sort_key = packField(pipeline, k_pipeline_bits, pipeline_shift) |
+                          packField(entity->mesh_asset_id, k_mesh_bits, mesh_shift) |
+                          packField(
+                              entity->material_asset_id, k_material_bits, material_shift
+                          ) |
+                          packField(depth_bucket, k_depth_bits, depth_shift);
+        packet.node_index = i;
+        packet.instance_slot = entity->instance_slot;
+
+        if (packet.instance_slot >= m_slots.size()) {
+            m_slots.resize(packet.instance_slot + 1);
+        }
+        SlotState &slot = m_slots[packet.instance_slot];
+        // an entity listed twice keeps its first node, the others are always patched
+        if (slot.node_stamp == m_update_count) {
+            m_patch_packets.push_back(packet);
+            continue;
+        }
+        slot.node_stamp = m_update_count;
+        slot.sort_key = packet.sort_key;
+        slot.node_index = i;
+    }
+
+    // packets of the last update whose entity is still listed with the same key stay
+    // in sorted order, compacted in place
+    size_t retained_count = 0;
+    for (const Packet &packet : m_packets) {
+        if (packet.instance_slot >= m_slots.size()) {
+            continue;
+        }
+        SlotState &slot = m_slots[packet.instance_slot];
+        if (slot.node_stamp != m_update_count || slot.retained_stamp == m_update_count ||
+            slot.sort_key != packet.sort_key) {
+            continue;
+        }
+        slot.retained_stamp = m_update_count;
+
+        Packet &retained = m_packets[retained_count++];
+        retained.sort_key = packet.sort_key;
+        retained.node_index = slot.node_index;
+        retained.instance_slot = packet.instance_slot;
+    }
+    m_packets.resize(retained_count);
+
+    // the added, moved and rekeyed ones are sorted on their own and merged in
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        uint32_t instance_slot = nodes[i].ref_entity->instance_slot;
+        const SlotState &slot = m_slots[instance_slot];
+        if (slot.node_index == i && slot.retained_stamp != m_update_count) {
+            m_patch_packets.push_back({slot.sort_key, i, instance_slot});
+        }
+    }
+
+    if (!m_patch_packets.empty()) {
+        radixSort(m_patch_packets);
+
+        m_sort_buffer.resize(m_packets.size() + m_patch_packets.size());
+        std::merge(
+            m_packets.begin(),
+            m_packets.end(),
+            m_patch_packets.begin(),
+            m_patch_packets.end(),
+            m_sort_buffer.begin(),
+            [](const Packet &a, const Packet &b) { return a.sort_key < b.sort_key; }
+        );
+        m_packets.swap(m_sort_buffer);
+    }
+
+    buildBatches(nodes);
+}
+
+void DrawList::splitBatches(
+    uint32_t max_chunk_count, std::vector<uint32_t> &chunk_begins
+) const {
+    max_chunk_count = std::max(max_chunk_count, 1u);
+    uint32_t chunk_packet_count =
+        (static_cast<uint32_t>(m_packets.size()) + max_chunk_count - 1) / max_chunk_count;
+
+    chunk_begins.clear();
+    chunk_begins.push_back(0);
+    uint32_t packet_count = 0;
+    for (uint32_t i = 0; i < m_batches.size(); ++i) {
+        packet_count += m_batches[i].packet_count;
+        if (packet_count >= chunk_packet_count && i + 1 < m_batches.size()) {
+            chunk_begins.push_back(i + 1);
+            packet_count = 0;
+        }
+    }
+    chunk_begins.push_back(static_cast<uint32_t>(m_batches.size()));
+}
+
+// lsd radix sort, stable so equal keys keep node order
+void DrawList::radixSort(std::vector<Packet> &packets) {
+    if (packets.empty()) {
+        return;
+    }
+
+    m_sort_buffer.resize(packets.size());
+
+    uint32_t histogram[k_radix_size];
+    for (uint32_t shift = 0; shift < 64; shift += k_radix_bits) {
+        std::memset(histogram, 0, sizeof(histogram));
+        for (const Packet &packet : packets) {
+            ++histogram[(packet.sort_key >> shift) & (k_radix_size - 1)];
+        }
+
+        // every key has the same digit, nothing to move
+        uint32_t first_digit = (packets[0].sort_key >> shift) & (k_radix_size - 1);
+        if (histogram[first_digit] == packets.size()) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t &count : histogram) {
+            uint32_t digit_count = count;
+            count = offset;
+            offset += digit_count;
+        }
+
+        for (const Packet &packet : packets) {
+            m_sort_buffer[histogram[(packet.sort_key >> shift) & (k_radix_size - 1)]++] =
+                packet;
+        }
+        packets.swap(m_sort_buffer);
+    }
+}
+
+// keys may alias once the ids overflow their bits, so runs compare the mesh
+void DrawList::buildBatches(const std::vector<RenderNode> &nodes) {
+    m_batches.clear();
+
+    for (uint32_t i = 0; i < m_packets.size(); ++i) {
+        const RenderNode &node = nodes[m_packets[i].node_index];
+        if (!m_batches.empty()) {
+            const RenderNode &first =
+                nodes[m_packets[m_batches.back().packet_begin].node_index];
+            if (node.ref_mesh == first.ref_mesh) {
+                ++m_batches.back().packet_count;
+                continue;
+            }
+        }
+
+        m_batches.push_back({i, 1});
+    }
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "function/render/render_scene.h"
+
+namespace Vain {
+
+// visible nodes of one view sorted by a packed state key, so that nodes sharing a
+// mesh are adjacent and can be drawn instanced, materials are bound per instance
+class DrawList {
+  public:
+    // pipeline 4 | mesh 24 | material 20 | depth bucket 16, most significant first
+    static constexpr uint32_t k_pipeline_bits = 4;
+    static constexpr uint32_t k_mesh_bits = 24;
+    static constexpr uint32_t k_material_bits = 20;
+    static constexpr uint32_t k_depth_bits = 16;
+
+    struct Packet {
+        uint64_t sort_key{};
+        uint32_t node_index{};
+        uint32_t instance_slot{};
+    };
+
+    // updates only if the node list changed since the last call. packets whose entity
+    // kept its key keep their place, the added and rekeyed ones are sorted and merged
+    // in. depth_proj_view orders the instances of a batch front to back, nullptr
+    // leaves them in node order
+    void update(
+        const std::vector<RenderNode> &nodes,
+        uint64_t nodes_version,
+        const glm::mat4 *depth_proj_view = nullptr
+    );
+
+    const std::vector<Packet> &packets() const { return m_packets; }
+
+    // a run of packets sharing a mesh, drawn instanced
+    struct Batch {
+        uint32_t packet_begin{};
+        uint32_t packet_count{};
+    };
+
+    const std::vector<Batch> &batches() const { return m_batches; }
+
+    // splits the batches into at most max_chunk_count runs of about the same packet
+    // count, chunk i covers batches [chunk_begins[i], chunk_begins[i + 1])
+    void splitBatches(
+        uint32_t max_chunk_count, std::vector<uint32_t> &chunk_begins
+    ) const;
+
+  private:
+    uint64_t m_nodes_version{};
+    size_t m_nodes_count{};
+
+    // node of the entity in the current update and whether its packet kept its place,
+    // indexed by instance slot, valid when the stamps match m_update_count
+    struct SlotState {
+        uint64_t node_stamp{};
+        uint64_t retained_stamp{};
+        uint64_t sort_key{};
+        uint32_t node_index{};
+    };
+
+    uint64_t m_update_count{};
+    std::vector<SlotState> m_slots{};
+
+    std::vector<Packet> m_packets{};
+    std::vector<Batch> m_batches{};
+    // scratch buffers reused across updates
+    std::vector<Packet> m_patch_packets{};
+    std::vector<Packet> m_sort_buffer{};
+
+    void radixSort(std::vector<Packet> &packets);
+    void buildBatches(const std::vector<RenderNode> &nodes);
+};
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "frame_upload_buffer.h"
+
+#include <algorithm>
+#include <string>
+
+#include "core/base/macro.h"
+#include "core/vulkan/vulkan_context.h"
+
+namespace Vain {
+
+static constexpr VkDeviceSize k_min_region_page_count = 2;
+// frames of usage a shrink decision looks back on
+static constexpr uint32_t k_shrink_window_frame_count = 600;
+
+FrameUploadBuffer::~FrameUploadBuffer() { clear(); }
+
+void FrameUploadBuffer::initialize(
+    VulkanContext *ctx, VkDeviceSize alignment, VkDeviceSize max_size
+) {
+    m_ctx = ctx;
+    m_alignment = alignment;
+    m_max_size = max_size;
+
+    resize(k_min_region_page_count * k_page_size);
+}
+
+void FrameUploadBuffer::clear() {
+    if (!m_ctx) {
+        return;
+    }
+
+    destroyBuffer();
+    m_region_size = 0;
+    m_shrink_region_size = 0;
+}
+
+void FrameUploadBuffer::beginFrame(VkDeviceSize reserve_size) {
+    // usage of the frame that just ended
+    m_window_peak = std::max(m_window_peak, m_frame_usage);
+    m_frame_usage = 0;
+    m_overflowed = false;
+
+    VkDeviceSize region_size = m_region_size;
+    VkDeviceSize wanted = std::max(reserve_size, highWaterMark());
+    if (wanted > m_region_size) {
+        // headroom so that a slowly growing scene doesn't resize every frame
+        region_size = pagesFor(wanted + wanted / 2) * k_page_size;
+        m_shrink_region_size = 0;
+    }
+
+    if (++m_window_frame_count == k_shrink_window_frame_count) {
+        VkDeviceSize peak = std::max(m_window_peak, reserve_size);
+        m_last_window_peak = m_window_peak;
+        m_window_peak = 0;
+        m_window_frame_count = 0;
+
+        // a quiet window hands back what is more than twice its peak
+        if (region_size == m_region_size && m_region_size >= 4 * peak) {
+            m_shrink_region_size = pagesFor(2 * peak) * k_page_size;
+        }
+    }
+
+    // the shrink waits for a frame with nothing in flight, the region must still take
+    // what the frames since asked for
+    if (region_size == m_region_size && m_shrink_region_size > 0 && framesDrained()) {
+        region_size = std::max(m_shrink_region_size, pagesFor(wanted) * k_page_size);
+        m_shrink_region_size = 0;
+    }
+
+    VkDeviceSize max_region_size =
+        m_max_size / VulkanContext::k_max_frames_in_flight / k_page_size * k_page_size;
+    region_size = std::max(region_size, k_min_region_page_count * k_page_size);
+    if (region_size > max_region_size) {
+        if (reserve_size > max_region_size) {
+            VAIN_ERROR("frame upload buffer can't hold the reservation of the frame");
+        }
+        region_size = max_region_size;
+    }
+
+    if (region_size != m_region_size) {
+        resize(region_size);
+    }
+
+    m_region_begin = m_region_size * m_ctx->currentFrameIndex();
+}
+
+uint32_t FrameUploadBuffer::allocate(uint32_t size) {
+    // regions start on a page, so aligning within the region aligns in the buffer
+    VkDeviceSize offset = ROUND_UP(m_frame_usage, m_alignment);
+    m_frame_usage = offset + size;
+
+    if (m_frame_usage > m_region_size) {
+        // only allocations nobody reserved get here. the usage still counts so the
+        // region grows next frame
+        if (!m_overflowed) {
+            VAIN_ERROR("frame upload buffer region overflowed, reserve the allocation");
+            m_overflowed = true;
+        }
+        return k_invalid_offset;
+    }
+
+    return static_cast<uint32_t>(m_region_begin + offset);
+}
+
+VkDeviceSize FrameUploadBuffer::highWaterMark() const {
+    return std::max(m_window_peak, m_last_window_peak);
+}
+
+VkDeviceSize FrameUploadBuffer::pagesFor(VkDeviceSize size) const {
+    return std::max((size + k_page_size - 1) / k_page_size, VkDeviceSize{1});
+}
+
+bool FrameUploadBuffer::framesDrained() const {
+    for (VkFence fence : m_ctx->is_frame_in_flight_fences) {
+        if (vkGetFenceStatus(m_ctx->device, fence) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameUploadBuffer::resize(VkDeviceSize region_size) {
+    // frames in flight may still read the other regions and bind descriptors holding
+    // the buffer, only the graphics queue uses it
+    if (m_buffer && !framesDrained()) {
+        m_ctx->waitForFences(
+            m_ctx->device,
+            VulkanContext::k_max_frames_in_flight,
+            m_ctx->is_frame_in_flight_fences,
+            VK_TRUE,
+            UINT64_MAX
+        );
+    }
+    destroyBuffer();
+
+    m_region_size = region_size;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = m_region_size * VulkanContext::k_max_frames_in_flight;
+    // the gpu scene stages its uploads in the buffer
+    buffer_info.usage =
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // device local host visible memory lets the gpu read the data without crossing the
+    // bus, vma falls back to plain host memory when there is none
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_info.requiredFlags =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    alloc_info.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VmaAllocationInfo allocation_info{};
+    if (vmaCreateBuffer(
+            m_ctx->assets_allocator,
+            &buffer_info,
+            &alloc_info,
+            &m_buffer,
+            &m_allocation,
+            &allocation_info
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create frame upload buffer");
+    }
+    m_mapped = allocation_info.pMappedData;
+
+    VkMemoryPropertyFlags memory_properties{};
+    vmaGetAllocationMemoryProperties(
+        m_ctx->assets_allocator, m_allocation, &memory_properties
+    );
+    m_device_local = memory_properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    ++m_version;
+
+    VAIN_INFO(
+        "frame upload buffer uses " + std::to_string(m_region_size / k_page_size) +
+        " MiB per frame" + (m_device_local ? " of device local memory" : "")
+    );
+}
+
+void FrameUploadBuffer::destroyBuffer() {
+    if (m_buffer) {
+        vmaDestroyBuffer(m_ctx->assets_allocator, m_buffer, m_allocation);
+    }
+
+    m_buffer = VK_NULL_HANDLE;
+    m_allocation = VK_NULL_HANDLE;
+    m_mapped = nullptr;
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace Vain {
+
+class VulkanContext;
+
+// resizable host visible buffer the passes write their per frame data and index lists
+// into, one region per frame in flight used in turn. regions are a whole number of
+// pages, sized at the start of a frame from what the frame reserves and the recent high
+// water mark. descriptors bind the single buffer with dynamic offsets, so a resize
+// recreates it, and every descriptor and cached recording holding it is redone.
+// growing can't wait: it stalls until the frames in flight finish, which the headroom
+// keeps rare. a shrink after a quiet stretch waits instead until a frame starts with no
+// frame in flight, and never stalls
+class FrameUploadBuffer {
+  public:
+    static constexpr VkDeviceSize k_page_size{1024 * 1024};
+    // returned by allocate when the region is out of space
+    static constexpr uint32_t k_invalid_offset{UINT32_MAX};
+
+    FrameUploadBuffer() = default;
+    ~FrameUploadBuffer();
+
+    void initialize(VulkanContext *ctx, VkDeviceSize alignment, VkDeviceSize max_size);
+    void clear();
+
+    // call before anything of the frame is recorded, resets the region of the current
+    // frame and resizes the buffer if the region can't take reserve_size bytes, or to
+    // apply a pending shrink. a resize bumps the version
+    void beginFrame(VkDeviceSize reserve_size);
+
+    // returns the offset from the buffer start, aligned for dynamic storage buffers, or
+    // k_invalid_offset when the allocation wasn't reserved and doesn't fit. the caller
+    // skips whatever needed it, the region grows next frame
+    uint32_t allocate(uint32_t size);
+    void *pointer(uint32_t offset) const {
+        return static_cast<uint8_t *>(m_mapped) + offset;
+    }
+
+    // upper bound of the bytes allocate(size) takes from the region
+    VkDeviceSize allocationSize(VkDeviceSize size) const { return size + m_alignment; }
+
+    VkBuffer buffer() const { return m_buffer; }
+    // bumped whenever the buffer is recreated, descriptors holding it must be rewritten
+    uint64_t version() const { return m_version; }
+
+    VkDeviceSize regionSize() const { return m_region_size; }
+    // most bytes a single frame asked for over the last one to two shrink windows
+    VkDeviceSize highWaterMark() const;
+    // whether the pages ended up in device local memory, e.g. resizable bar
+    bool deviceLocal() const { return m_device_local; }
+
+  private:
+    VulkanContext *m_ctx{};
+    VkDeviceSize m_alignment{};
+    VkDeviceSize m_max_size{};
+
+    VkBuffer m_buffer{};
+    VmaAllocation m_allocation{};
+    void *m_mapped{};
+    bool m_device_local{false};
+    uint64_t m_version{};
+
+    VkDeviceSize m_region_size{};
+    VkDeviceSize m_region_begin{};
+    // bytes the current frame asked for, including what didn't fit
+    VkDeviceSize m_frame_usage{};
+    bool m_overflowed{false};
+
+    uint32_t m_window_frame_count{};
+    VkDeviceSize m_window_peak{};
+    VkDeviceSize m_last_window_peak{};
+    // region size a quiet window asked for, 0 when none is pending
+    VkDeviceSize m_shrink_region_size{};
+
+    VkDeviceSize pagesFor(VkDeviceSize size) const;
+    // whether no submitted frame can still read the buffer
+    bool framesDrained() const;
+    // waits for the frames in flight unless they already drained
+    void resize(VkDeviceSize region_size);
+    void destroyBuffer();
+};
+
+}  // namespace Vain
\ No newline at end of file
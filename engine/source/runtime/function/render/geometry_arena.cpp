@@ -0,0 +1,136 @@
+#include "geometry_arena.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "core/base/macro.h"
+#include "core/vulkan/vulkan_context.h"
+
+namespace Vain {
+
+GeometryArena::~GeometryArena() { clear(); }
+
+void GeometryArena::initialize(
+    VulkanContext *ctx,
+    VkBufferUsageFlags usage,
+    uint32_t element_size,
+    uint32_t block_element_count
+) {
+    m_ctx = ctx;
+    m_usage = usage;
+    m_element_size = element_size;
+    m_block_element_count = block_element_count;
+}
+
+void GeometryArena::clear() {
+    for (Block &block : m_blocks) {
+        vmaDestroyBuffer(m_ctx->assets_allocator, block.buffer, block.allocation);
+    }
+    m_blocks.clear();
+}
+
+GeometryArena::Allocation GeometryArena::allocate(uint32_t count) {
+    if (count == 0) {
+        return {};
+    }
+
+    auto find = [&](uint32_t block_index, Allocation &allocation) {
+        auto &free_ranges = m_blocks[block_index].free_ranges;
+        for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+            auto [offset, size] = *it;
+            if (size < count) {
+                continue;
+            }
+
+            free_ranges.erase(it);
+            if (size > count) {
+                free_ranges[offset + count] = size - count;
+            }
+            allocation = {block_index, offset, count};
+            return true;
+        }
+        return false;
+    };
+
+    Allocation allocation{};
+    bool found = false;
+    for (uint32_t i = 0; i < m_blocks.size() && !found; ++i) {
+        found = find(i, allocation);
+    }
+    if (!found) {
+        // meshes larger than a block get a block of their own
+        createBlock(std::max(count, m_block_element_count));
+        found = find(static_cast<uint32_t>(m_blocks.size() - 1), allocation);
+    }
+    assert(found);
+
+    return allocation;
+}
+
+void GeometryArena::free(const Allocation &allocation) {
+    if (allocation.count == 0) {
+        return;
+    }
+
+    auto &free_ranges = m_blocks[allocation.block].free_ranges;
+    uint32_t offset = allocation.offset;
+    uint32_t size = allocation.count;
+
+    auto next = free_ranges.lower_bound(offset);
+    if (next != free_ranges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            free_ranges.erase(prev);
+        }
+    }
+    if (next != free_ranges.end() && offset + size == next->first) {
+        size += next->second;
+        free_ranges.erase(next);
+    }
+    free_ranges[offset] = size;
+}
+
+void GeometryArena::createBlock(uint32_t capacity) {
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = VkDeviceSize{capacity} * m_element_size;
+    buffer_info.usage = m_usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // meshes are copied in while the graphics queue draws others of the block, which
+    // an ownership transfer of the whole buffer can't allow
+    uint32_t queue_families[] = {
+        m_ctx->queue_indices.graphics_family.value(),
+        m_ctx->queue_indices.transfer_family.value()
+    };
+    if (queue_families[0] != queue_families[1]) {
+        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = ARRAY_SIZE(queue_families);
+        buffer_info.pQueueFamilyIndices = queue_families;
+    }
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    Block block{};
+    block.capacity = capacity;
+    if (vmaCreateBuffer(
+            m_ctx->assets_allocator,
+            &buffer_info,
+            &alloc_info,
+            &block.buffer,
+            &block.allocation,
+            nullptr
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create geometry arena block");
+    }
+    block.free_ranges[0] = capacity;
+
+    m_blocks.push_back(std::move(block));
+}
+
+}  // namespace Vain
\ No newline at end of file
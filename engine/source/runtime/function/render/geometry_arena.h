@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace Vain {
+
+class VulkanContext;
+
+// large device local buffers shared by all meshes, suballocated in whole elements so
+// an allocation offset is directly a firstIndex or vertexOffset
+class GeometryArena {
+  public:
+    struct Allocation {
+        uint32_t block{};
+        uint32_t offset{};
+        uint32_t count{};
+    };
+
+    GeometryArena() = default;
+    ~GeometryArena();
+
+    void initialize(
+        VulkanContext *ctx,
+        VkBufferUsageFlags usage,
+        uint32_t element_size,
+        uint32_t block_element_count
+    );
+    void clear();
+
+    // first fit over the blocks, a new block is created when none has room
+    Allocation allocate(uint32_t count);
+    void free(const Allocation &allocation);
+
+    VkBuffer buffer(uint32_t block) const { return m_blocks[block].buffer; }
+    VkDeviceSize byteOffset(const Allocation &allocation) const {
+        return VkDeviceSize{allocation.offset} * m_element_size;
+    }
+
+  private:
+    struct Block {
+        VkBuffer buffer{};
+        VmaAllocation allocation{};
+        uint32_t capacity{};
+        // free ranges keyed by offset, adjacent ranges are merged on free
+        std::map<uint32_t, uint32_t> free_ranges{};
+    };
+
+    VulkanContext *m_ctx{};
+    VkBufferUsageFlags m_usage{};
+    uint32_t m_element_size{};
+    uint32_t m_block_element_count{};
+    std::vector<Block> m_blocks{};
+
+    void createBlock(uint32_t capacity);
+};
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,519 @@
+#include "gpu_scene.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/base/macro.h"
+#include "core/vulkan/vulkan_context.h"
+#include "core/vulkan/vulkan_utils.h"
+#include "function/render/render_resource.h"
+#include "function/render/render_scene.h"
+
+namespace Vain {
+
+static constexpr uint32_t k_initial_object_capacity = 1024;
+static constexpr uint32_t k_initial_mesh_capacity = 256;
+// larger updates, like the first upload of a big scene, go through a staging buffer of
+// their own instead of the frame ring buffer
+static constexpr VkDeviceSize k_max_ring_upload_size = 8 * 1024 * 1024;
+
+static constexpr VkBufferUsageFlags k_table_buffer_usage =
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+// extends the last region when the element directly follows it
+static void addCopy(
+    std::vector<VkBufferCopy> &copies,
+    VkDeviceSize src_offset,
+    VkDeviceSize dst_offset,
+    VkDeviceSize size
+) {
+    if (!copies.empty()) {
+        VkBufferCopy &last = copies.back();
+        if (last.srcOffset + last.size == src_offset &&
+            last.dstOffset + last.size == dst_offset) {
+            last.size += size;
+            return;
+        }
+    }
+
+    copies.push_back({src_offset, dst_offset, size});
+}
+
+GpuScene::~GpuScene() { clear(); }
+
+void GpuScene::initialize(VulkanContext *ctx, RenderResource *res) {
+    m_ctx = ctx;
+    m_res = res;
+
+    reserveObjects(k_initial_object_capacity);
+    reserveMeshes(k_initial_mesh_capacity);
+}
+
+void GpuScene::clear() {
+    if (!m_ctx) {
+        return;
+    }
+
+    destroyBuffer(m_instance_buffer);
+    destroyBuffer(m_object_buffer);
+    destroyBuffer(m_mesh_buffer);
+    destroyBuffer(m_command_buffer);
+    m_object_capacity = 0;
+    m_mesh_capacity = 0;
+
+    m_object_count = 0;
+    m_slot_meshes.clear();
+    m_meshes.clear();
+    m_free_draw_indices.clear();
+    m_command_meshes.clear();
+    m_draw_groups.clear();
+    ++m_draw_groups_version;
+    m_meshes_dirty = false;
+    m_mesh_records_dirty = false;
+}
+
+uint32_t GpuScene::addMesh(const MeshResource &mesh) {
+    uint32_t draw_index;
+    if (!m_free_draw_indices.empty()) {
+        draw_index = m_free_draw_indices.back();
+        m_free_draw_indices.pop_back();
+    } else {
+        draw_index = static_cast<uint32_t>(m_meshes.size());
+        m_meshes.emplace_back();
+    }
+
+    Mesh &draw_mesh = m_meshes[draw_index];
+    draw_mesh = {};
+    draw_mesh.alive = true;
+    draw_mesh.index_count = mesh.index_count;
+    draw_mesh.first_index = mesh.first_index;
+    draw_mesh.vertex_offset = mesh.vertex_offset;
+    draw_mesh.vertex_buffer = mesh.vertex_buffer;
+    draw_mesh.index_buffer = mesh.index_buffer;
+
+    m_meshes_dirty = true;
+    return draw_index;
+}
+
+void GpuScene::removeMesh(uint32_t draw_index) {
+    if (draw_index >= m_meshes.size() || !m_meshes[draw_index].alive) {
+        return;
+    }
+
+    m_meshes[draw_index] = {};
+    m_free_draw_indices.push_back(draw_index);
+
+    // the slots still counted in the mesh must not be taken off its successor
+    for (uint32_t &slot_mesh : m_slot_meshes) {
+        if (slot_mesh == draw_index) {
+            slot_mesh = k_invalid_index;
+        }
+    }
+    m_meshes_dirty = true;
+}
+
+VkDeviceSize GpuScene::ringBufferUsage(const RenderScene &scene) const {
+    VkDeviceSize record_size = sizeof(MeshInstance) + sizeof(GpuCullObject);
+    VkDeviceSize staging_size = scene.dirty_instance_slots.size() * record_size;
+    // any instance change may send the mesh records up again
+    staging_size += m_meshes.size() * sizeof(GpuCullMesh);
+
+    // bigger uploads than this use their own staging buffer, but a smaller one can
+    // still hide behind a bound above it
+    return m_res->ringBufferAllocationSize(
+        static_cast<uint32_t>(std::min(staging_size, k_max_ring_upload_size))
+    );
+}
+
+void GpuScene::update(RenderScene &scene) {
+    uint32_t object_count = static_cast<uint32_t>(scene.instance_entities.size());
+    reserveObjects(object_count);
+    reserveMeshes(static_cast<uint32_t>(m_meshes.size()));
+    m_object_count = object_count;
+
+    m_dirty_slots = scene.dirty_instance_slots;
+    std::sort(m_dirty_slots.begin(), m_dirty_slots.end());
+    scene.clearDirtyInstanceSlots();
+
+    if (m_slot_meshes.size() < object_count) {
+        m_slot_meshes.resize(object_count, k_invalid_index);
+    }
+
+    m_instance_records.clear();
+    m_object_records.clear();
+    std::vector<VkBufferCopy> instance_copies;
+    std::vector<VkBufferCopy> object_copies;
+
+    for (uint32_t slot : m_dirty_slots) {
+        if (slot < m_slot_meshes.size() && m_slot_meshes[slot] != k_invalid_index) {
+            --m_meshes[m_slot_meshes[slot]].instance_count;
+            m_mesh_records_dirty = true;
+        }
+        // the slot was cut off the end of the table
+        if (slot >= object_count) {
+            continue;
+        }
+
+        const RenderEntity *entity = scene.instance_entities[slot];
+        const MeshResource *mesh = m_res->getEntityMesh(*entity);
+        const PBRMaterialResource *material = m_res->getEntityMaterial(*entity);
+
+        // not drawn until both uploads completed, the slot is dirtied again then
+        uint32_t draw_index = mesh && material ? mesh->draw_index : k_invalid_index;
+        if (draw_index != k_invalid_index) {
+            ++m_meshes[draw_index].instance_count;
+            m_mesh_records_dirty = true;
+        }
+        m_slot_meshes[slot] = draw_index;
+
+        addCopy(
+            instance_copies,
+            m_instance_records.size() * sizeof(MeshInstance),
+            slot * sizeof(MeshInstance),
+            sizeof(MeshInstance)
+        );
+        MeshInstance &instance = m_instance_records.emplace_back();
+        instance.setModelMatrix(entity->model_matrix);
+        instance.material_index = material ? material->material_index : 0;
+
+        addCopy(
+            object_copies,
+            m_object_records.size() * sizeof(GpuCullObject),
+            slot * sizeof(GpuCullObject),
+            sizeof(GpuCullObject)
+        );
+        GpuCullObject &object = m_object_records.emplace_back();
+        object.center = glm::vec4{entity->world_aabb.center, 0.0f};
+        object.half_extent = glm::vec4{entity->world_aabb.half_extent, 0.0f};
+        object.mesh_draw_index = draw_index;
+    }
+    m_slot_meshes.resize(object_count);
+
+    if (m_meshes_dirty) {
+        rebuildDrawGroups();
+    }
+
+    std::vector<VkBufferCopy> mesh_copies;
+    m_mesh_records.clear();
+    if (m_mesh_records_dirty) {
+        m_mesh_records.resize(m_meshes.size());
+        for (uint32_t draw_index = 0; draw_index < m_meshes.size(); ++draw_index) {
+            const Mesh &mesh = m_meshes[draw_index];
+            GpuCullMesh &record = m_mesh_records[draw_index];
+            record.index_count = mesh.index_count;
+            record.first_index = mesh.first_index;
+            record.vertex_offset = mesh.vertex_offset;
+            record.command_index = mesh.command_index;
+        }
+
+        // every view lists the instances of a mesh in one run, in command order
+        uint32_t instance_base = 0;
+        for (uint32_t draw_index : m_command_meshes) {
+            m_mesh_records[draw_index].instance_base = instance_base;
+            instance_base += m_meshes[draw_index].instance_count;
+        }
+        assert(instance_base <= object_count);
+
+        if (!m_mesh_records.empty()) {
+            mesh_copies.push_back({0, 0, m_mesh_records.size() * sizeof(GpuCullMesh)});
+        }
+        m_mesh_records_dirty = false;
+    }
+
+    VkDeviceSize staging_size = m_instance_records.size() * sizeof(MeshInstance) +
+                                m_object_records.size() * sizeof(GpuCullObject) +
+                                m_mesh_records.size() * sizeof(GpuCullMesh);
+    if (staging_size > 0) {
+        upload(instance_copies, object_copies, mesh_copies, staging_size);
+    }
+}
+
+void GpuScene::reserveObjects(uint32_t count) {
+    if (count <= m_object_capacity) {
+        return;
+    }
+
+    uint32_t capacity = std::max(count, m_object_capacity * 2);
+    growBuffer(
+        m_instance_buffer,
+        VkDeviceSize{m_object_capacity} * sizeof(MeshInstance),
+        VkDeviceSize{capacity} * sizeof(MeshInstance),
+        k_table_buffer_usage
+    );
+    growBuffer(
+        m_object_buffer,
+        VkDeviceSize{m_object_capacity} * sizeof(GpuCullObject),
+        VkDeviceSize{capacity} * sizeof(GpuCullObject),
+        k_table_buffer_usage
+    );
+    m_object_capacity = capacity;
+}
+
+void GpuScene::reserveMeshes(uint32_t count) {
+    if (count <= m_mesh_capacity) {
+        return;
+    }
+
+    // the mesh records are uploaded whole and the commands rewritten every frame, so
+    // neither is carried over
+    uint32_t capacity = std::max(count, m_mesh_capacity * 2);
+    growBuffer(
+        m_mesh_buffer,
+        0,
+        VkDeviceSize{capacity} * sizeof(GpuCullMesh),
+        k_table_buffer_usage
+    );
+    growBuffer(
+        m_command_buffer,
+        0,
+        VkDeviceSize{capacity} * _draw_view_count * sizeof(VkDrawIndexedIndirectCommand),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+    );
+    m_mesh_capacity = capacity;
+    m_mesh_records_dirty = true;
+}
+
+void GpuScene::growBuffer(
+    Buffer &buffer, VkDeviceSize old_size, VkDeviceSize new_size, VkBufferUsageFlags usage
+) {
+    // the old buffer may still be read by the frames in flight and is bound in their
+    // descriptor sets, growing is rare enough to just wait
+    if (buffer.buffer) {
+        vkDeviceWaitIdle(m_ctx->device);
+    }
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = new_size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    Buffer new_buffer{};
+    if (vmaCreateBuffer(
+            m_ctx->assets_allocator,
+            &buffer_info,
+            &alloc_info,
+            &new_buffer.buffer,
+            &new_buffer.allocation,
+            nullptr
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create gpu scene buffer");
+    }
+
+    if (buffer.buffer && old_size > 0) {
+        copyBuffer(m_ctx, buffer.buffer, new_buffer.buffer, 0, 0, old_size);
+    }
+    destroyBuffer(buffer);
+
+    buffer = new_buffer;
+    ++m_version;
+}
+
+void GpuScene::destroyBuffer(Buffer &buffer) {
+    if (buffer.buffer) {
+        vmaDestroyBuffer(m_ctx->assets_allocator, buffer.buffer, buffer.allocation);
+    }
+    buffer = {};
+}
+
+void GpuScene::rebuildDrawGroups() {
+    ++m_draw_groups_version;
+
+    m_command_meshes.clear();
+    for (uint32_t draw_index = 0; draw_index < m_meshes.size(); ++draw_index) {
+        if (m_meshes[draw_index].alive) {
+            m_command_meshes.push_back(draw_index);
+        }
+    }
+
+    std::sort(
+        m_command_meshes.begin(),
+        m_command_meshes.end(),
+        [&](uint32_t a, uint32_t b) {
+            const Mesh &mesh_a = m_meshes[a];
+            const Mesh &mesh_b = m_meshes[b];
+            if (mesh_a.vertex_buffer != mesh_b.vertex_buffer) {
+                return mesh_a.vertex_buffer < mesh_b.vertex_buffer;
+            }
+            if (mesh_a.index_buffer != mesh_b.index_buffer) {
+                return mesh_a.index_buffer < mesh_b.index_buffer;
+            }
+            return a < b;
+        }
+    );
+
+    m_draw_groups.clear();
+    for (uint32_t command_index = 0; command_index < m_command_meshes.size();
+         ++command_index) {
+        Mesh &mesh = m_meshes[m_command_meshes[command_index]];
+        mesh.command_index = command_index;
+
+        if (!m_draw_groups.empty()) {
+            DrawGroup &group = m_draw_groups.back();
+            if (group.vertex_buffer == mesh.vertex_buffer &&
+                group.index_buffer == mesh.index_buffer) {
+                ++group.command_count;
+                continue;
+            }
+        }
+        m_draw_groups.push_back(
+            {mesh.vertex_buffer, mesh.index_buffer, command_index, 1}
+        );
+    }
+
+    m_meshes_dirty = false;
+    m_mesh_records_dirty = true;
+}
+
+void GpuScene::upload(
+    const std::vector<VkBufferCopy> &instance_copies,
+    const std::vector<VkBufferCopy> &object_copies,
+    const std::vector<VkBufferCopy> &mesh_copies,
+    VkDeviceSize staging_size
+) {
+    bool ring_staging = staging_size <= k_max_ring_upload_size;
+
+    VkBuffer staging_buffer{};
+    VkDeviceMemory staging_buffer_memory{};
+    VkDeviceSize staging_offset = 0;
+    void *staging_pointer = nullptr;
+    if (ring_staging) {
+        uint32_t offset = m_res->allocateRingBuffer(static_cast<uint32_t>(staging_size));
+        // an unreserved overflow stages in a buffer of its own
+        ring_staging = offset != FrameUploadBuffer::k_invalid_offset;
+        staging_offset = ring_staging ? offset : 0;
+    }
+    if (ring_staging) {
+        staging_pointer = m_res->getRingBufferPointer(staging_offset);
+        staging_buffer = m_res->frame_upload_buffer.buffer();
+    } else {
+        createBuffer(
+            m_ctx->physical_device,
+            m_ctx->device,
+            staging_size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            staging_buffer,
+            staging_buffer_memory
+        );
+        vkMapMemory(
+            m_ctx->device, staging_buffer_memory, 0, VK_WHOLE_SIZE, 0, &staging_pointer
+        );
+    }
+
+    // instance records, then object records, then mesh records
+    VkDeviceSize instance_base = 0;
+    VkDeviceSize object_base = m_instance_records.size() * sizeof(MeshInstance);
+    VkDeviceSize mesh_base =
+        object_base + m_object_records.size() * sizeof(GpuCullObject);
+
+    auto *staging_bytes = static_cast<uint8_t *>(staging_pointer);
+    std::memcpy(
+        staging_bytes + instance_base,
+        m_instance_records.data(),
+        m_instance_records.size() * sizeof(MeshInstance)
+    );
+    std::memcpy(
+        staging_bytes + object_base,
+        m_object_records.data(),
+        m_object_records.size() * sizeof(GpuCullObject)
+    );
+    std::memcpy(
+        staging_bytes + mesh_base,
+        m_mesh_records.data(),
+        m_mesh_records.size() * sizeof(GpuCullMesh)
+    );
+
+    auto rebase = [&](std::vector<VkBufferCopy> copies, VkDeviceSize base) {
+        for (VkBufferCopy &copy : copies) {
+            copy.srcOffset += staging_offset + base;
+        }
+        return copies;
+    };
+    std::vector<VkBufferCopy> copies[3] = {
+        rebase(instance_copies, instance_base),
+        rebase(object_copies, object_base),
+        rebase(mesh_copies, mesh_base)
+    };
+    VkBuffer dst_buffers[3] = {
+        m_instance_buffer.buffer, m_object_buffer.buffer, m_mesh_buffer.buffer
+    };
+
+    if (!ring_staging) {
+        // the frames in flight may still read the slots being overwritten
+        vkDeviceWaitIdle(m_ctx->device);
+
+        VkCommandBuffer command_buffer = m_ctx->beginSingleTimeCommands();
+        for (uint32_t i = 0; i < ARRAY_SIZE(copies); ++i) {
+            if (!copies[i].empty()) {
+                vkCmdCopyBuffer(
+                    command_buffer,
+                    staging_buffer,
+                    dst_buffers[i],
+                    copies[i].size(),
+                    copies[i].data()
+                );
+            }
+        }
+        m_ctx->endSingleTimeCommands(command_buffer);
+
+        vkDestroyBuffer(m_ctx->device, staging_buffer, nullptr);
+        vkFreeMemory(m_ctx->device, staging_buffer_memory, nullptr);
+        return;
+    }
+
+    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
+
+    // earlier frames read the tables in the vertex shaders and the cull pass
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(copies); ++i) {
+        if (!copies[i].empty()) {
+            vkCmdCopyBuffer(
+                command_buffer,
+                staging_buffer,
+                dst_buffers[i],
+                copies[i].size(),
+                copies[i].data()
+            );
+        }
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "function/render/render_type.h"
+
+namespace Vain {
+
+class VulkanContext;
+class RenderResource;
+class RenderScene;
+struct MeshResource;
+
+// device local copy of the scene instance table for gpu driven rendering. every entity
+// has a MeshInstance and a GpuCullObject at its instance slot, every mesh a GpuCullMesh
+// at its draw index and one indirect command per view. only changed slots are uploaded
+class GpuScene {
+  public:
+    enum {
+        _draw_view_main_camera = 0,
+        _draw_view_directional_light,
+        _draw_view_point_lights,
+        _draw_view_count
+    };
+
+    static constexpr uint32_t k_invalid_index{0xFFFFFFFF};
+
+    // meshes sharing the arena blocks, drawn by one indirect call per view
+    struct DrawGroup {
+        VkBuffer vertex_buffer{};
+        VkBuffer index_buffer{};
+        uint32_t first_command{};
+        uint32_t command_count{};
+    };
+
+    GpuScene() = default;
+    ~GpuScene();
+
+    void initialize(VulkanContext *ctx, RenderResource *res);
+    void clear();
+
+    // returns the draw index of the mesh
+    uint32_t addMesh(const MeshResource &mesh);
+    void removeMesh(uint32_t draw_index);
+
+    // call once per frame after prepareBeforePass, records the uploads of the changed
+    // slots into the current command buffer and clears the dirty slots of the scene
+    void update(RenderScene &scene);
+    // upper bound of the ring buffer bytes the next update stages its uploads in
+    VkDeviceSize ringBufferUsage(const RenderScene &scene) const;
+
+    VkBuffer instanceBuffer() const { return m_instance_buffer.buffer; }
+    VkBuffer objectBuffer() const { return m_object_buffer.buffer; }
+    VkBuffer meshBuffer() const { return m_mesh_buffer.buffer; }
+    VkBuffer commandBuffer() const { return m_command_buffer.buffer; }
+
+    uint32_t objectCount() const { return m_object_count; }
+    // draw indices in use, including freed ones below the highest
+    uint32_t meshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+    uint32_t meshCapacity() const { return m_mesh_capacity; }
+
+    // bumped whenever a buffer is recreated, descriptors holding them must be rewritten
+    uint64_t version() const { return m_version; }
+
+    const std::vector<DrawGroup> &drawGroups() const { return m_draw_groups; }
+    // bumped whenever the draw groups or the mesh set behind them change
+    uint64_t drawGroupsVersion() const { return m_draw_groups_version; }
+
+  private:
+    struct Buffer {
+        VkBuffer buffer{};
+        VmaAllocation allocation{};
+    };
+
+    struct Mesh {
+        bool alive{false};
+        uint32_t index_count{};
+        uint32_t first_index{};
+        int32_t vertex_offset{};
+        VkBuffer vertex_buffer{};
+        VkBuffer index_buffer{};
+        uint32_t command_index{k_invalid_index};
+        uint32_t instance_count{};
+    };
+
+    VulkanContext *m_ctx{};
+    RenderResource *m_res{};
+
+    Buffer m_instance_buffer{};
+    Buffer m_object_buffer{};
+    Buffer m_mesh_buffer{};
+    Buffer m_command_buffer{};
+    uint32_t m_object_capacity{};
+    uint32_t m_mesh_capacity{};
+    uint64_t m_version{};
+
+    uint32_t m_object_count{};
+    // draw index of the mesh each slot was counted in
+    std::vector<uint32_t> m_slot_meshes{};
+
+    std::vector<Mesh> m_meshes{};
+    std::vector<uint32_t> m_free_draw_indices{};
+    // meshes were added or removed, the draw groups and command indices are rebuilt
+    bool m_meshes_dirty{false};
+    // the instance counts changed, the mesh records are uploaded again
+    bool m_mesh_records_dirty{false};
+    // draw index of the mesh of each command, grouped by arena blocks
+    std::vector<uint32_t> m_command_meshes{};
+    std::vector<DrawGroup> m_draw_groups{};
+    uint64_t m_draw_groups_version{};
+
+    // scratch for the uploads of one update
+    std::vector<uint32_t> m_dirty_slots{};
+    std::vector<MeshInstance> m_instance_records{};
+    std::vector<GpuCullObject> m_object_records{};
+    std::vector<GpuCullMesh> m_mesh_records{};
+
+    void reserveObjects(uint32_t count);
+    void reserveMeshes(uint32_t count);
+    void growBuffer(
+        Buffer &buffer,
+        VkDeviceSize old_size,
+        VkDeviceSize new_size,
+        VkBufferUsageFlags usage
+    );
+    void destroyBuffer(Buffer &buffer);
+
+    void rebuildDrawGroups();
+    void upload(
+        const std::vector<VkBufferCopy> &instance_copies,
+        const std::vector<VkBufferCopy> &object_copies,
+        const std::vector<VkBufferCopy> &mesh_copies,
+        VkDeviceSize staging_size
+    );
+};
+
+}  // namespace Vain
\ No newline at end of file
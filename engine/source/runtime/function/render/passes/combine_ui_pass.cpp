@@ -306,16 +306,8 @@ void CombineUIPass::createPipelines() {
 void CombineUIPass::allocateDecriptorSets() {
     descriptor_sets.resize(1);
 
-    VkDescriptorSetAllocateInfo post_process_global_descriptor_set_alloc_info{};
-    post_process_global_descriptor_set_alloc_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    post_process_global_descriptor_set_alloc_info.descriptorPool = m_ctx->descriptor_pool;
-    post_process_global_descriptor_set_alloc_info.descriptorSetCount = 1;
-    post_process_global_descriptor_set_alloc_info.pSetLayouts =
-        &descriptor_set_layouts[0];
-
-    VkResult res = vkAllocateDescriptorSets(
-        m_ctx->device, &post_process_global_descriptor_set_alloc_info, &descriptor_sets[0]
+    VkResult res = m_ctx->descriptor_allocator.allocate(
+        descriptor_set_layouts[0], &descriptor_sets[0]
     );
     if (res != VK_SUCCESS) {
         VAIN_ERROR("failed to allocate descriptor set");
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+
+#include "function/render/draw_list.h"
 #include "function/render/render_pass.h"
 #include "function/render/render_type.h"
 
@@ -18,12 +21,38 @@ class DirectionalLightPass : public RenderPass {
     void draw(const RenderScene &scene);
 
   private:
+    // per frame data and instance index lists at fixed places, so that the recorded
+    // command buffers can be executed again while the draws stay the same
+    struct FrameResource {
+        uint32_t capacity{};
+        VkBuffer buffer{};
+        VmaAllocation allocation{};
+        void *pointer{};
+        uint32_t *instance_indices{};
+
+        VkDescriptorSet descriptor_set{};
+        CachedRecording recording{};
+    };
+
+    DrawList m_draw_list{};
+    std::vector<uint32_t> m_chunk_begins{};
+
+    std::array<FrameResource, VulkanContext::k_max_frames_in_flight> m_frames{};
+
     void createAttachments();
     void createRenderPass();
     void createDescriptorSetLayouts();
     void createPipelines();
     void allocateDescriptorSets();
     void createFramebuffer();
+
+    void recordFrame(
+        const RenderScene &scene, FrameResource &frame, const RecordingKey &key
+    );
+    void reserveFrameResource(FrameResource &frame, uint32_t instance_count);
+    void destroyFrameResource(FrameResource &frame);
+    void updateFrameDescriptorSet(const FrameResource &frame, bool gpu_driven_culling);
+    VkDeviceSize instanceIndicesOffset() const;
 };
 
 }  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "gpu_cull_pass.h"
+
+#include <algorithm>
+
+#include "core/base/macro.h"
+#include "core/math/frustum.h"
+#include "core/vulkan/vulkan_utils.h"
+#include "function/render/render_scene.h"
+
+namespace Vain {
+
+static std::vector<uint8_t> s_gpu_cull_reset_comp = {
+#include "gpu_cull_reset.comp.spv.h"
+};
+
+static std::vector<uint8_t> s_gpu_cull_comp = {
+#include "gpu_cull.comp.spv.h"
+};
+
+static void setFrustumPlanes(const glm::mat4 &proj_view, glm::vec4 *planes) {
+    Frustum frustum{proj_view, -1.0, 1.0, -1.0, 1.0, 0.0, 1.0};
+    planes[0] = frustum.right_plane;
+    planes[1] = frustum.left_plane;
+    planes[2] = frustum.top_plane;
+    planes[3] = frustum.bottom_plane;
+    planes[4] = frustum.near_plane;
+    planes[5] = frustum.far_plane;
+}
+
+GpuCullPass::~GpuCullPass() { clear(); }
+
+void GpuCullPass::initialize(RenderPassInitInfo *init_info) {
+    RenderPass::initialize(init_info);
+
+    createDescriptorSetLayouts();
+    createPipelines();
+    allocateDescriptorSets();
+}
+
+void GpuCullPass::clear() {
+    for (auto pipeline : pipelines) {
+        vkDestroyPipeline(m_ctx->device, pipeline, nullptr);
+    }
+    pipelines.clear();
+
+    for (auto pipeline_layout : pipeline_layouts) {
+        vkDestroyPipelineLayout(m_ctx->device, pipeline_layout, nullptr);
+    }
+    pipeline_layouts.clear();
+
+    for (auto descriptor_set_layout : descriptor_set_layouts) {
+        vkDestroyDescriptorSetLayout(m_ctx->device, descriptor_set_layout, nullptr);
+    }
+    descriptor_set_layouts.clear();
+}
+
+VkDeviceSize GpuCullPass::ringBufferUsage(const RenderScene &scene) const {
+    uint32_t object_count = static_cast<uint32_t>(scene.instance_entities.size());
+    return m_res->ringBufferAllocationSize(sizeof(GpuCullPerFrameStorageBufferObject)) +
+           2 * m_res->instanceIndicesAllocationSize(object_count) +
+           m_res->instanceIndicesAllocationSize(object_count, 2);
+}
+
+void GpuCullPass::draw(const RenderScene &scene) {
+    const GpuScene &gpu_scene = m_res->gpu_scene;
+    if (gpu_scene.meshCount() == 0) {
+        return;
+    }
+
+    updateGpuSceneDescriptorSet();
+
+    uint32_t object_count = gpu_scene.objectCount();
+
+    uint32_t per_frame_dynamic_offset =
+        m_res->allocateRingBuffer(sizeof(GpuCullPerFrameStorageBufferObject));
+    if (per_frame_dynamic_offset == FrameUploadBuffer::k_invalid_offset) {
+        // an unreserved overflow, the draws repeat the commands of the last cull
+        return;
+    }
+    uint32_t view_instance_firsts[] = {
+        m_res->allocateInstanceIndices(object_count),
+        m_res->allocateInstanceIndices(object_count),
+        m_res->allocateInstanceIndices(object_count, 2),
+    };
+    if (std::count(
+            std::begin(view_instance_firsts),
+            std::end(view_instance_firsts),
+            FrameUploadBuffer::k_invalid_offset
+        )) {
+        // without index lists every object is culled, the reset still clears the
+        // commands
+        object_count = 0;
+    }
+
+    auto *per_frame = static_cast<GpuCullPerFrameStorageBufferObject *>(
+        m_res->getRingBufferPointer(per_frame_dynamic_offset)
+    );
+    *per_frame = {};
+
+    setFrustumPlanes(
+        m_res->mesh_per_frame_storage_buffer_object.proj_view_matrix,
+        per_frame->main_camera_planes
+    );
+    setFrustumPlanes(
+        m_res->mesh_per_frame_storage_buffer_object.directional_light_proj_view,
+        per_frame->directional_light_planes
+    );
+
+    if (m_ctx->enablePointLightShadow()) {
+        per_frame->point_light_num =
+            m_res->mesh_per_frame_storage_buffer_object.point_light_num;
+    }
+    for (uint32_t i = 0; i < per_frame->point_light_num; ++i) {
+        per_frame->point_lights_position_and_radius[i] =
+            m_res->point_light_shadow_per_frame_storage_buffer_object
+                .point_lights_position_and_radius[i];
+    }
+
+    per_frame->object_count = object_count;
+    per_frame->mesh_count = gpu_scene.meshCount();
+    per_frame->mesh_capacity = gpu_scene.meshCapacity();
+
+    // an object is in at most one command per view, so a view never lists more
+    // instances than there are objects
+    per_frame->view_instance_first[GpuScene::_draw_view_main_camera] =
+        view_instance_firsts[0];
+    per_frame->view_instance_first[GpuScene::_draw_view_directional_light] =
+        view_instance_firsts[1];
+    per_frame->view_instance_first[GpuScene::_draw_view_point_lights] =
+        view_instance_firsts[2];
+
+    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
+
+    float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    m_ctx->pushEvent(command_buffer, "GPU Cull", color);
+
+    {
+        // the previous frame still draws from the commands
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr
+        );
+    }
+
+    m_ctx->cmdBindPipeline(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[_pipeline_type_reset]
+    );
+    m_ctx->cmdBindDescriptorSets(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipeline_layouts[_pipeline_type_reset],
+        0,
+        1,
+        &descriptor_sets[0],
+        1,
+        &per_frame_dynamic_offset
+    );
+    vkCmdDispatch(
+        command_buffer, (gpu_scene.meshCount() + 63) / 64, GpuScene::_draw_view_count, 1
+    );
+
+    {
+        // the cull dispatch counts instances into the reset commands
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr
+        );
+    }
+
+    if (object_count > 0) {
+        m_ctx->cmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[_pipeline_type_cull]
+        );
+        m_ctx->cmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            pipeline_layouts[_pipeline_type_cull],
+            0,
+            1,
+            &descriptor_sets[0],
+            1,
+            &per_frame_dynamic_offset
+        );
+        vkCmdDispatch(command_buffer, (object_count + 63) / 64, 1, 1);
+    }
+
+    {
+        // commands are read by the draws, index lists by the vertex shaders
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask =
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr
+        );
+    }
+
+    m_ctx->popEvent(command_buffer);
+}
+
+void GpuCullPass::createDescriptorSetLayouts() {
+    descriptor_set_layouts.resize(1);
+
+    // per frame, objects, meshes, commands, instance index lists
+    VkDescriptorSetLayoutBinding gpu_cull_layout_bindings[5]{};
+    for (uint32_t i = 0; i < ARRAY_SIZE(gpu_cull_layout_bindings); ++i) {
+        gpu_cull_layout_bindings[i].binding = i;
+        gpu_cull_layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        gpu_cull_layout_bindings[i].descriptorCount = 1;
+        gpu_cull_layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    gpu_cull_layout_bindings[0].descriptorType =
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+    VkDescriptorSetLayoutCreateInfo gpu_cull_layout_create_info{};
+    gpu_cull_layout_create_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    gpu_cull_layout_create_info.bindingCount = ARRAY_SIZE(gpu_cull_layout_bindings);
+    gpu_cull_layout_create_info.pBindings = gpu_cull_layout_bindings;
+
+    VkResult res = vkCreateDescriptorSetLayout(
+        m_ctx->device, &gpu_cull_layout_create_info, nullptr, &descriptor_set_layouts[0]
+    );
+    if (res != VK_SUCCESS) {
+        VAIN_ERROR("failed to create descriptor set layout");
+    }
+}
+
+void GpuCullPass::createPipelines() {
+    pipelines.resize(_pipeline_type_count);
+    pipeline_layouts.resize(_pipeline_type_count);
+
+    std::vector<uint8_t> *shader_codes[_pipeline_type_count] = {
+        &s_gpu_cull_reset_comp, &s_gpu_cull_comp
+    };
+
+    for (uint32_t i = 0; i < _pipeline_type_count; ++i) {
+        VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+        pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_create_info.setLayoutCount = 1;
+        pipeline_layout_create_info.pSetLayouts = &descriptor_set_layouts[0];
+
+        VkResult res = vkCreatePipelineLayout(
+            m_ctx->device, &pipeline_layout_create_info, nullptr, &pipeline_layouts[i]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create pipeline layout");
+        }
+
+        VkShaderModule comp_shader_module =
+            createShaderModule(m_ctx->device, *shader_codes[i]);
+
+        VkComputePipelineCreateInfo compute_pipeline_create_info{};
+        compute_pipeline_create_info.sType =
+            VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        compute_pipeline_create_info.stage.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        compute_pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        compute_pipeline_create_info.stage.module = comp_shader_module;
+        compute_pipeline_create_info.stage.pName = "main";
+        compute_pipeline_create_info.layout = pipeline_layouts[i];
+
+        res = vkCreateComputePipelines(
+            m_ctx->device,
+            VK_NULL_HANDLE,
+            1,
+            &compute_pipeline_create_info,
+            nullptr,
+            &pipelines[i]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create compute pipeline");
+        }
+
+        vkDestroyShaderModule(m_ctx->device, comp_shader_module, nullptr);
+    }
+}
+
+void GpuCullPass::allocateDescriptorSets() {
+    descriptor_sets.resize(1);
+
+    VkResult res = m_ctx->descriptor_allocator.allocate(
+        descriptor_set_layouts[0], &descriptor_sets[0]
+    );
+    if (res != VK_SUCCESS) {
+        VAIN_ERROR("failed to allocate descriptor sets");
+    }
+
+    updateGpuSceneDescriptorSet();
+}
+
+void GpuCullPass::updateGpuSceneDescriptorSet() {
+    const GpuScene &gpu_scene = m_res->gpu_scene;
+    const FrameUploadBuffer &frame_upload_buffer = m_res->frame_upload_buffer;
+    if (m_gpu_scene_version == gpu_scene.version() &&
+        m_ring_buffer_version == frame_upload_buffer.version()) {
+        return;
+    }
+    m_gpu_scene_version = gpu_scene.version();
+    m_ring_buffer_version = frame_upload_buffer.version();
+
+    VkBuffer ring_buffer = frame_upload_buffer.buffer();
+
+    VkDescriptorBufferInfo buffer_infos[5]{};
+    buffer_infos[0] = {ring_buffer, 0, sizeof(GpuCullPerFrameStorageBufferObject)};
+    buffer_infos[1] = {gpu_scene.objectBuffer(), 0, VK_WHOLE_SIZE};
+    buffer_infos[2] = {gpu_scene.meshBuffer(), 0, VK_WHOLE_SIZE};
+    buffer_infos[3] = {gpu_scene.commandBuffer(), 0, VK_WHOLE_SIZE};
+    // the index lists are in the ring buffer, each view finds its own through
+    // view_instance_first
+    buffer_infos[4] = {ring_buffer, 0, VK_WHOLE_SIZE};
+
+    VkWriteDescriptorSet writes[5]{};
+    for (uint32_t i = 0; i < ARRAY_SIZE(writes); ++i) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = descriptor_sets[0];
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+    vkUpdateDescriptorSets(m_ctx->device, ARRAY_SIZE(writes), writes, 0, nullptr);
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "function/render/render_pass.h"
+#include "function/render/render_type.h"
+
+namespace Vain {
+
+class RenderScene;
+
+// gpu driven culling, tests every gpu scene object against the main camera, the
+// directional light and the point lights, and writes the indirect draw commands and
+// instance index lists the mesh passes draw from
+class GpuCullPass : public RenderPass {
+  public:
+    enum {
+        _pipeline_type_reset = 0,
+        _pipeline_type_cull,
+        _pipeline_type_count
+    };
+
+    GpuCullPass() = default;
+    ~GpuCullPass();
+
+    virtual void initialize(RenderPassInitInfo *init_info) override;
+    virtual void clear() override;
+
+    // call after the gpu scene update and before the mesh passes
+    void draw(const RenderScene &scene);
+    // upper bound of the ring buffer bytes draw takes
+    VkDeviceSize ringBufferUsage(const RenderScene &scene) const;
+
+  private:
+    uint64_t m_gpu_scene_version{};
+    uint64_t m_ring_buffer_version{};
+
+    void createDescriptorSetLayouts();
+    void createPipelines();
+    void allocateDescriptorSets();
+    void updateGpuSceneDescriptorSet();
+};
+
+}  // namespace Vain
\ No newline at end of file
@@ -81,6 +81,8 @@ void MainPass::draw(
     UIPass &ui_pass,
     CombineUIPass &combine_ui_pass
 ) {
+    updateRingBufferDescriptors();
+
     VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
 
     {
@@ -116,20 +118,18 @@ void MainPass::draw(
         render_pass_begin_info.clearValueCount = ARRAY_SIZE(clear_values);
         render_pass_begin_info.pClearValues = clear_values;
 
+        // the gbuffer is recorded in secondary command buffers
         m_ctx->cmdBeginRenderPass(
-            command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE
+            command_buffer,
+            &render_pass_begin_info,
+            VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
         );
     }
 
     float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 
-    {
-        m_ctx->pushEvent(command_buffer, "Base Pass", color);
-
-        drawMeshGbuffer(scene);
-
-        m_ctx->popEvent(command_buffer);
-    }
+    // only secondary command buffers may be executed here, they carry their own events
+    drawMeshGbuffer(scene);
 
     m_ctx->cmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -204,6 +204,8 @@ void MainPass::drawForward(
     UIPass &ui_pass,
     CombineUIPass &combine_ui_pass
 ) {
+    updateRingBufferDescriptors();
+
     VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
 
     {
@@ -260,16 +262,10 @@ void MainPass::drawForward(
         m_ctx->popEvent(command_buffer);
     }
 
-    m_ctx->cmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
+    m_ctx->cmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    {
-        m_ctx->pushEvent(command_buffer, "Forward Lighting", color);
-
-        drawMeshLighting(scene);
-        drawSkybox();
-
-        m_ctx->popEvent(command_buffer);
-    }
+    // only secondary command buffers may be executed here, they carry their own events
+    drawMeshLighting(scene);
 
     m_ctx->cmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -320,6 +316,14 @@ void MainPass::drawForward(
     m_ctx->cmdEndRenderPass(command_buffer);
 }
 
+VkDeviceSize MainPass::ringBufferUsage(const RenderScene &scene) const {
+    // the mesh draws and the deferred lighting each write a per frame object
+    uint32_t node_count =
+        static_cast<uint32_t>(scene.main_camera_visible_mesh_nodes.size());
+    return 2 * m_res->ringBufferAllocationSize(sizeof(MeshPerFrameStorageBufferObject)) +
+           m_res->instanceIndicesAllocationSize(node_count);
+}
+
 void MainPass::onResize() {
     clearAttachmentsAndFramebuffers();
 
@@ -686,7 +690,7 @@ void MainPass::createDescriptorSetLayouts() {
     descriptor_set_layouts.resize(_layout_type_count);
 
     {
-        VkDescriptorSetLayoutBinding mesh_global_layout_bindings[7]{};
+        VkDescriptorSetLayoutBinding mesh_global_layout_bindings[8]{};
 
         VkDescriptorSetLayoutBinding
             &mesh_global_layout_per_frame_storage_buffer_binding =
@@ -699,13 +703,13 @@ void MainPass::createDescriptorSetLayouts() {
             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
         VkDescriptorSetLayoutBinding
-            &mesh_global_layout_per_drawcall_storage_buffer_binding =
+            &mesh_global_layout_instances_storage_buffer_binding =
                 mesh_global_layout_bindings[1];
-        mesh_global_layout_per_drawcall_storage_buffer_binding.binding = 1;
-        mesh_global_layout_per_drawcall_storage_buffer_binding.descriptorType =
-            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-        mesh_global_layout_per_drawcall_storage_buffer_binding.descriptorCount = 1;
-        mesh_global_layout_per_drawcall_storage_buffer_binding.stageFlags =
+        mesh_global_layout_instances_storage_buffer_binding.binding = 1;
+        mesh_global_layout_instances_storage_buffer_binding.descriptorType =
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        mesh_global_layout_instances_storage_buffer_binding.descriptorCount = 1;
+        mesh_global_layout_instances_storage_buffer_binding.stageFlags =
             VK_SHADER_STAGE_VERTEX_BIT;
 
         VkDescriptorSetLayoutBinding &mesh_global_layout_brdfLUT_texture_binding =
@@ -743,6 +747,13 @@ void MainPass::createDescriptorSetLayouts() {
             mesh_global_layout_brdfLUT_texture_binding;
         mesh_global_layout_directional_light_shadow_texture_binding.binding = 6;
 
+        VkDescriptorSetLayoutBinding
+            &mesh_global_layout_instance_indices_storage_buffer_binding =
+                mesh_global_layout_bindings[7];
+        mesh_global_layout_instance_indices_storage_buffer_binding =
+            mesh_global_layout_instances_storage_buffer_binding;
+        mesh_global_layout_instance_indices_storage_buffer_binding.binding = 7;
+
         VkDescriptorSetLayoutCreateInfo mesh_global_layout_create_info{};
         mesh_global_layout_create_info.sType =
             VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -762,74 +773,65 @@ void MainPass::createDescriptorSetLayouts() {
     }
 
     {
-        VkDescriptorSetLayoutBinding mesh_material_layout_bindings[6]{};
+        VkDescriptorSetLayoutBinding mesh_materials_layout_bindings[2]{};
 
         // (set = 1, binding = 0 in fragment shader)
-        VkDescriptorSetLayoutBinding &mesh_material_layout_uniform_buffer_binding =
-            mesh_material_layout_bindings[0];
-        mesh_material_layout_uniform_buffer_binding.binding = 0;
-        mesh_material_layout_uniform_buffer_binding.descriptorType =
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        mesh_material_layout_uniform_buffer_binding.descriptorCount = 1;
-        mesh_material_layout_uniform_buffer_binding.stageFlags =
+        VkDescriptorSetLayoutBinding &mesh_materials_layout_storage_buffer_binding =
+            mesh_materials_layout_bindings[0];
+        mesh_materials_layout_storage_buffer_binding.binding = 0;
+        mesh_materials_layout_storage_buffer_binding.descriptorType =
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        mesh_materials_layout_storage_buffer_binding.descriptorCount = 1;
+        mesh_materials_layout_storage_buffer_binding.stageFlags =
             VK_SHADER_STAGE_FRAGMENT_BIT;
-        mesh_material_layout_uniform_buffer_binding.pImmutableSamplers = nullptr;
+        mesh_materials_layout_storage_buffer_binding.pImmutableSamplers = nullptr;
 
         // (set = 1, binding = 1 in fragment shader)
-        VkDescriptorSetLayoutBinding &mesh_material_layout_base_color_texture_binding =
-            mesh_material_layout_bindings[1];
-        mesh_material_layout_base_color_texture_binding.binding = 1;
-        mesh_material_layout_base_color_texture_binding.descriptorType =
+        VkDescriptorSetLayoutBinding &mesh_materials_layout_textures_binding =
+            mesh_materials_layout_bindings[1];
+        mesh_materials_layout_textures_binding.binding = 1;
+        mesh_materials_layout_textures_binding.descriptorType =
             VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        mesh_material_layout_base_color_texture_binding.descriptorCount = 1;
-        mesh_material_layout_base_color_texture_binding.stageFlags =
-            VK_SHADER_STAGE_FRAGMENT_BIT;
-        mesh_material_layout_base_color_texture_binding.pImmutableSamplers = nullptr;
+        mesh_materials_layout_textures_binding.descriptorCount =
+            m_ctx->bindless_texture_count;
+        mesh_materials_layout_textures_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        mesh_materials_layout_textures_binding.pImmutableSamplers = nullptr;
+
+        // materials are added while earlier frames are still in flight
+        VkDescriptorBindingFlags mesh_materials_layout_binding_flags[2] = {
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+        };
 
-        // (set = 1, binding = 2 in fragment shader)
-        VkDescriptorSetLayoutBinding
-            &mesh_material_layout_matallic_roughness_texture_binding =
-                mesh_material_layout_bindings[2];
-        mesh_material_layout_matallic_roughness_texture_binding =
-            mesh_material_layout_base_color_texture_binding;
-        mesh_material_layout_matallic_roughness_texture_binding.binding = 2;
-
-        // (set = 1, binding = 3 in fragment shader)
-        VkDescriptorSetLayoutBinding &mesh_material_layout_normal_texture_binding =
-            mesh_material_layout_bindings[3];
-        mesh_material_layout_normal_texture_binding =
-            mesh_material_layout_base_color_texture_binding;
-        mesh_material_layout_normal_texture_binding.binding = 3;
-
-        // (set = 1, binding = 4 in fragment shader)
-        VkDescriptorSetLayoutBinding &mesh_material_layout_occlusion_texture_binding =
-            mesh_material_layout_bindings[4];
-        mesh_material_layout_occlusion_texture_binding =
-            mesh_material_layout_base_color_texture_binding;
-        mesh_material_layout_occlusion_texture_binding.binding = 4;
-
-        // (set = 1, binding = 5 in fragment shader)
-        VkDescriptorSetLayoutBinding &mesh_material_layout_emissive_texture_binding =
-            mesh_material_layout_bindings[5];
-        mesh_material_layout_emissive_texture_binding =
-            mesh_material_layout_base_color_texture_binding;
-        mesh_material_layout_emissive_texture_binding.binding = 5;
-
-        VkDescriptorSetLayoutCreateInfo mesh_material_layout_create_info{};
-        mesh_material_layout_create_info.sType =
+        VkDescriptorSetLayoutBindingFlagsCreateInfo mesh_materials_layout_flags_info{};
+        mesh_materials_layout_flags_info.sType =
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        mesh_materials_layout_flags_info.bindingCount =
+            ARRAY_SIZE(mesh_materials_layout_binding_flags);
+        mesh_materials_layout_flags_info.pBindingFlags =
+            mesh_materials_layout_binding_flags;
+
+        VkDescriptorSetLayoutCreateInfo mesh_materials_layout_create_info{};
+        mesh_materials_layout_create_info.sType =
             VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        mesh_material_layout_create_info.bindingCount =
-            ARRAY_SIZE(mesh_material_layout_bindings);
-        mesh_material_layout_create_info.pBindings = mesh_material_layout_bindings;
+        mesh_materials_layout_create_info.pNext = &mesh_materials_layout_flags_info;
+        mesh_materials_layout_create_info.flags =
+            VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        mesh_materials_layout_create_info.bindingCount =
+            ARRAY_SIZE(mesh_materials_layout_bindings);
+        mesh_materials_layout_create_info.pBindings = mesh_materials_layout_bindings;
 
         VkResult res = vkCreateDescriptorSetLayout(
             m_ctx->device,
-            &mesh_material_layout_create_info,
+            &mesh_materials_layout_create_info,
             nullptr,
-            &descriptor_set_layouts[_layout_type_mesh_per_material]
+            &descriptor_set_layouts[_layout_type_mesh_materials]
         );
         if (res != VK_SUCCESS) {
-            VAIN_ERROR("failed to create mesh material layout");
+            VAIN_ERROR("failed to create mesh materials layout");
         }
     }
 
@@ -943,7 +945,7 @@ void MainPass::createPipelines() {
     {
         VkDescriptorSetLayout layouts[2] = {
             descriptor_set_layouts[_layout_type_mesh_global],
-            descriptor_set_layouts[_layout_type_mesh_per_material]
+            descriptor_set_layouts[_layout_type_mesh_materials]
         };
         VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
         pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -1290,7 +1292,7 @@ void MainPass::createPipelines() {
     {
         VkDescriptorSetLayout layouts[2] = {
             descriptor_set_layouts[_layout_type_mesh_global],
-            descriptor_set_layouts[_layout_type_mesh_per_material]
+            descriptor_set_layouts[_layout_type_mesh_materials]
         };
         VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
         pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -1727,17 +1729,8 @@ void MainPass::createSwapchainFramebuffers() {
 }
 
 void MainPass::allocateMeshGlobalDescriptorSet() {
-    VkDescriptorSetAllocateInfo mesh_global_descriptor_set_alloc_info{};
-    mesh_global_descriptor_set_alloc_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    mesh_global_descriptor_set_alloc_info.descriptorPool = m_ctx->descriptor_pool;
-    mesh_global_descriptor_set_alloc_info.descriptorSetCount = 1;
-    mesh_global_descriptor_set_alloc_info.pSetLayouts =
-        &descriptor_set_layouts[_layout_type_mesh_global];
-
-    VkResult res = vkAllocateDescriptorSets(
-        m_ctx->device,
-        &mesh_global_descriptor_set_alloc_info,
+    VkResult res = m_ctx->descriptor_allocator.allocate(
+        descriptor_set_layouts[_layout_type_mesh_global],
         &descriptor_sets[_layout_type_mesh_global]
     );
     if (res != VK_SUCCESS) {
@@ -1745,8 +1738,7 @@ void MainPass::allocateMeshGlobalDescriptorSet() {
     }
 
     VkDescriptorBufferInfo mesh_per_frame_storage_buffer_info{};
-    mesh_per_frame_storage_buffer_info.buffer =
-        m_res->global_render_resource.storage_buffer.global_upload_ringbuffer;
+    mesh_per_frame_storage_buffer_info.buffer = m_res->frame_upload_buffer.buffer();
     mesh_per_frame_storage_buffer_info.offset = 0;
     mesh_per_frame_storage_buffer_info.range = sizeof(MeshPerFrameStorageBufferObject);
     assert(
@@ -1754,16 +1746,18 @@ void MainPass::allocateMeshGlobalDescriptorSet() {
         m_res->global_render_resource.storage_buffer.max_storage_buffer_range
     );
 
-    VkDescriptorBufferInfo mesh_per_drawcall_storage_buffer_info{};
-    mesh_per_drawcall_storage_buffer_info.buffer =
-        m_res->global_render_resource.storage_buffer.global_upload_ringbuffer;
-    mesh_per_drawcall_storage_buffer_info.offset = 0;
-    mesh_per_drawcall_storage_buffer_info.range =
-        sizeof(MeshPerDrawcallStorageBufferObject);
-    assert(
-        mesh_per_drawcall_storage_buffer_info.range <
-        m_res->global_render_resource.storage_buffer.max_storage_buffer_range
-    );
+    VkDescriptorBufferInfo mesh_instances_storage_buffer_info{};
+    mesh_instances_storage_buffer_info.buffer = m_res->gpu_scene.instanceBuffer();
+    mesh_instances_storage_buffer_info.offset = 0;
+    mesh_instances_storage_buffer_info.range = VK_WHOLE_SIZE;
+
+    // the per pass index lists live in the ring buffer, binding 7 sees all of it, the
+    // list of a draw is reached through firstInstance
+    VkDescriptorBufferInfo mesh_instance_indices_storage_buffer_info{};
+    mesh_instance_indices_storage_buffer_info.buffer =
+        m_res->frame_upload_buffer.buffer();
+    mesh_instance_indices_storage_buffer_info.offset = 0;
+    mesh_instance_indices_storage_buffer_info.range = VK_WHOLE_SIZE;
 
     VkDescriptorImageInfo brdf_texture_image_info = {};
     brdf_texture_image_info.sampler =
@@ -1802,7 +1796,7 @@ void MainPass::allocateMeshGlobalDescriptorSet() {
     directional_light_shadow_texture_image_info.imageLayout =
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-    VkWriteDescriptorSet mesh_global_descriptor_writes[7]{};
+    VkWriteDescriptorSet mesh_global_descriptor_writes[8]{};
 
     mesh_global_descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     mesh_global_descriptor_writes[0].dstSet = descriptor_sets[_layout_type_mesh_global];
@@ -1817,10 +1811,9 @@ void MainPass::allocateMeshGlobalDescriptorSet() {
     mesh_global_descriptor_writes[1].dstSet = descriptor_sets[_layout_type_mesh_global];
     mesh_global_descriptor_writes[1].dstBinding = 1;
     mesh_global_descriptor_writes[1].dstArrayElement = 0;
-    mesh_global_descriptor_writes[1].descriptorType =
-        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    mesh_global_descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     mesh_global_descriptor_writes[1].descriptorCount = 1;
-    mesh_global_descriptor_writes[1].pBufferInfo = &mesh_per_drawcall_storage_buffer_info;
+    mesh_global_descriptor_writes[1].pBufferInfo = &mesh_instances_storage_buffer_info;
 
     mesh_global_descriptor_writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     mesh_global_descriptor_writes[2].dstSet = descriptor_sets[_layout_type_mesh_global];
@@ -1848,6 +1841,11 @@ void MainPass::allocateMeshGlobalDescriptorSet() {
     mesh_global_descriptor_writes[6].pImageInfo =
         &directional_light_shadow_texture_image_info;
 
+    mesh_global_descriptor_writes[7] = mesh_global_descriptor_writes[1];
+    mesh_global_descriptor_writes[7].dstBinding = 7;
+    mesh_global_descriptor_writes[7].pBufferInfo =
+        &mesh_instance_indices_storage_buffer_info;
+
     vkUpdateDescriptorSets(
         m_ctx->device,
         ARRAY_SIZE(mesh_global_descriptor_writes),
@@ -1855,21 +1853,13 @@ void MainPass::allocateMeshGlobalDescriptorSet() {
         0,
         nullptr
     );
+    m_instance_table_version = m_res->gpu_scene.version();
+    m_ring_buffer_version = m_res->frame_upload_buffer.version();
 }
 
 void MainPass::allocateSkyBoxDescriptorSet() {
-    VkDescriptorSetAllocateInfo skybox_descriptor_set_alloc_info{};
-    skybox_descriptor_set_alloc_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    skybox_descriptor_set_alloc_info.descriptorPool = m_ctx->descriptor_pool;
-    skybox_descriptor_set_alloc_info.descriptorSetCount = 1;
-    skybox_descriptor_set_alloc_info.pSetLayouts =
-        &descriptor_set_layouts[_layout_type_skybox];
-
-    VkResult res = vkAllocateDescriptorSets(
-        m_ctx->device,
-        &skybox_descriptor_set_alloc_info,
-        &descriptor_sets[_layout_type_skybox]
+    VkResult res = m_ctx->descriptor_allocator.allocate(
+        descriptor_set_layouts[_layout_type_skybox], &descriptor_sets[_layout_type_skybox]
     );
     if (res != VK_SUCCESS) {
         VAIN_ERROR("failed to allocate skybox set");
@@ -1878,8 +1868,7 @@ void MainPass::allocateSkyBoxDescriptorSet() {
     VkDescriptorBufferInfo mesh_per_frame_storage_buffer_info = {};
     mesh_per_frame_storage_buffer_info.offset = 0;
     mesh_per_frame_storage_buffer_info.range = sizeof(MeshPerFrameStorageBufferObject);
-    mesh_per_frame_storage_buffer_info.buffer =
-        m_res->global_render_resource.storage_buffer.global_upload_ringbuffer;
+    mesh_per_frame_storage_buffer_info.buffer = m_res->frame_upload_buffer.buffer();
     assert(
         mesh_per_frame_storage_buffer_info.range <
         m_res->global_render_resource.storage_buffer.max_storage_buffer_range
@@ -1922,18 +1911,8 @@ void MainPass::allocateSkyBoxDescriptorSet() {
 }
 
 void MainPass::allocateGbufferLightingDescriptorSet() {
-    VkDescriptorSetAllocateInfo gbuffer_light_global_descriptor_set_alloc_info{};
-    gbuffer_light_global_descriptor_set_alloc_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    gbuffer_light_global_descriptor_set_alloc_info.descriptorPool =
-        m_ctx->descriptor_pool;
-    gbuffer_light_global_descriptor_set_alloc_info.descriptorSetCount = 1;
-    gbuffer_light_global_descriptor_set_alloc_info.pSetLayouts =
-        &descriptor_set_layouts[_layout_type_deferred_lighting];
-
-    VkResult res = vkAllocateDescriptorSets(
-        m_ctx->device,
-        &gbuffer_light_global_descriptor_set_alloc_info,
+    VkResult res = m_ctx->descriptor_allocator.allocate(
+        descriptor_set_layouts[_layout_type_deferred_lighting],
         &descriptor_sets[_layout_type_deferred_lighting]
     );
     if (res != VK_SUCCESS) {
@@ -1941,6 +1920,42 @@ void MainPass::allocateGbufferLightingDescriptorSet() {
     }
 }
 
+void MainPass::updateRingBufferDescriptors() {
+    const FrameUploadBuffer &frame_upload_buffer = m_res->frame_upload_buffer;
+    if (m_ring_buffer_version == frame_upload_buffer.version()) {
+        return;
+    }
+    m_ring_buffer_version = frame_upload_buffer.version();
+
+    VkDescriptorBufferInfo per_frame_storage_buffer_info{};
+    per_frame_storage_buffer_info.buffer = frame_upload_buffer.buffer();
+    per_frame_storage_buffer_info.offset = 0;
+    per_frame_storage_buffer_info.range = sizeof(MeshPerFrameStorageBufferObject);
+
+    VkDescriptorBufferInfo instance_indices_storage_buffer_info{};
+    instance_indices_storage_buffer_info.buffer = frame_upload_buffer.buffer();
+    instance_indices_storage_buffer_info.offset = 0;
+    instance_indices_storage_buffer_info.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[3]{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = descriptor_sets[_layout_type_mesh_global];
+    writes[0].dstBinding = 0;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    writes[0].descriptorCount = 1;
+    writes[0].pBufferInfo = &per_frame_storage_buffer_info;
+
+    writes[1] = writes[0];
+    writes[1].dstBinding = 7;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[1].pBufferInfo = &instance_indices_storage_buffer_info;
+
+    writes[2] = writes[0];
+    writes[2].dstSet = descriptor_sets[_layout_type_skybox];
+
+    vkUpdateDescriptorSets(m_ctx->device, ARRAY_SIZE(writes), writes, 0, nullptr);
+}
+
 void MainPass::clearAttachmentsAndFramebuffers() {
     for (auto &attachment : framebuffer_info.attachments) {
         vkDestroyImage(m_ctx->device, attachment.image, nullptr);
@@ -1954,167 +1969,156 @@ void MainPass::clearAttachmentsAndFramebuffers() {
 }
 
 void MainPass::drawMeshGbuffer(const RenderScene &scene) {
-    using MeshBatch = std::unordered_map<const MeshResource *, std::vector<glm::mat4>>;
-
-    std::unordered_map<const PBRMaterialResource *, MeshBatch>
-        main_camera_mesh_drawcall_batch;
+    drawMeshes(
+        scene, _pipeline_type_mesh_gbuffer, _subpass_basepass, "Mesh GBuffer", false
+    );
+}
 
-    for (const auto &node : scene.main_camera_visible_mesh_nodes) {
-        auto &mesh_batch = main_camera_mesh_drawcall_batch[node.ref_material];
-        auto &batch_nodes = mesh_batch[node.ref_mesh];
+void MainPass::drawMeshes(
+    const RenderScene &scene,
+    RenderPipeLineType pipeline_type,
+    uint32_t subpass,
+    const char *event_name,
+    bool draw_skybox
+) {
+    m_draw_list.update(
+        scene.main_camera_visible_mesh_nodes,
+        scene.main_camera_visible_mesh_nodes_version,
+        &m_res->mesh_per_frame_storage_buffer_object.proj_view_matrix
+    );
 
-        batch_nodes.push_back(node.model_matrix);
+    const auto &packets = m_draw_list.packets();
+    const auto &batches = m_draw_list.batches();
+
+    uint32_t per_frame_dynamic_offset =
+        m_res->allocateRingBuffer(sizeof(MeshPerFrameStorageBufferObject));
+    // one instance index slot per packet, a batch owns the slots from its first packet
+    // on so chunks write disjoint ranges, occluded nodes only leave some of them unused
+    uint32_t first_instance = m_res->allocateInstanceIndices(packets.size());
+    // an unreserved overflow skips the meshes of the frame
+    if (per_frame_dynamic_offset == FrameUploadBuffer::k_invalid_offset ||
+        first_instance == FrameUploadBuffer::k_invalid_offset) {
+        return;
     }
+    *static_cast<MeshPerFrameStorageBufferObject *>(
+        m_res->getRingBufferPointer(per_frame_dynamic_offset)
+    ) = m_res->mesh_per_frame_storage_buffer_object;
 
-    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
+    m_draw_list.splitBatches(recordingChunkCount(packets.size()), m_chunk_begins);
+    uint32_t chunk_count = static_cast<uint32_t>(m_chunk_begins.size() - 1);
 
-    float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_ctx->pushEvent(command_buffer, "Mesh GBuffer", color);
+    updateInstanceTableDescriptor(descriptor_sets[_layout_type_mesh_global], 1);
 
-    m_ctx->cmdBindPipeline(
-        command_buffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelines[_pipeline_type_mesh_gbuffer]
-    );
+    auto record = [&](VkCommandBuffer command_buffer, uint32_t chunk) {
+        float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        m_ctx->pushEvent(command_buffer, event_name, color);
 
-    VkViewport viewport = {
-        0.0,
-        0.0,
-        static_cast<float>(m_ctx->swapchain_extent.width),
-        static_cast<float>(m_ctx->swapchain_extent.height),
-        0.0,
-        1.0
-    };
-    VkRect2D scissor = {
-        0, 0, m_ctx->swapchain_extent.width, m_ctx->swapchain_extent.height
-    };
+        m_ctx->cmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[pipeline_type]
+        );
 
-    m_ctx->cmdSetViewport(command_buffer, 0, 1, &viewport);
-    m_ctx->cmdSetScissor(command_buffer, 0, 1, &scissor);
+        VkViewport viewport = {
+            0.0,
+            0.0,
+            static_cast<float>(m_ctx->swapchain_extent.width),
+            static_cast<float>(m_ctx->swapchain_extent.height),
+            0.0,
+            1.0
+        };
+        VkRect2D scissor = {
+            0, 0, m_ctx->swapchain_extent.width, m_ctx->swapchain_extent.height
+        };
 
-    uint32_t per_frame_dynamic_offset = ROUND_UP(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-        m_res->global_render_resource.storage_buffer.min_storage_buffer_offset_alignment
-    );
-    m_res->global_render_resource.storage_buffer
-        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-        per_frame_dynamic_offset + sizeof(MeshPerFrameStorageBufferObject);
-    assert(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-        m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-            m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
-    );
-    MeshPerFrameStorageBufferObject *per_frame_storage_buffer_object =
-        reinterpret_cast<MeshPerFrameStorageBufferObject *>(
-            reinterpret_cast<uintptr_t>(m_res->global_render_resource.storage_buffer
-                                            .global_upload_ringbuffer_memory_pointer) +
-            per_frame_dynamic_offset
-        );
-    *per_frame_storage_buffer_object = m_res->mesh_per_frame_storage_buffer_object;
+        m_ctx->cmdSetViewport(command_buffer, 0, 1, &viewport);
+        m_ctx->cmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    for (auto &[material, mesh_batch] : main_camera_mesh_drawcall_batch) {
+        // instances and materials are reached through gl_InstanceIndex, nothing is
+        // rebound per draw
+        VkDescriptorSet mesh_descriptor_sets[2] = {
+            descriptor_sets[_layout_type_mesh_global], m_res->materials_descriptor_set
+        };
         m_ctx->cmdBindDescriptorSets(
             command_buffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipeline_layouts[_pipeline_type_mesh_gbuffer],
-            1,
-            1,
-            &material->material_descriptor_set,
+            pipeline_layouts[pipeline_type],
             0,
-            nullptr
+            ARRAY_SIZE(mesh_descriptor_sets),
+            mesh_descriptor_sets,
+            1,
+            &per_frame_dynamic_offset
         );
 
-        for (auto &[mesh, batch_nodes] : mesh_batch) {
-            uint32_t total_instance_count = batch_nodes.size();
-            if (total_instance_count == 0) {
+        MeshBufferBinding mesh_buffer_binding{};
+
+        for (uint32_t batch_index = m_chunk_begins[chunk];
+             batch_index < m_chunk_begins[chunk + 1];
+             ++batch_index) {
+            const DrawList::Batch &batch = batches[batch_index];
+            const MeshResource *mesh =
+                scene.main_camera_visible_mesh_nodes
+                    [packets[batch.packet_begin].node_index]
+                        .ref_mesh;
+
+            uint32_t batch_first_instance = first_instance + batch.packet_begin;
+            uint32_t *instance_indices =
+                m_res->getInstanceIndexPointer(batch_first_instance);
+
+            uint32_t instance_count = 0;
+            for (uint32_t i = 0; i < batch.packet_count; ++i) {
+                const RenderNode &node = scene.main_camera_visible_mesh_nodes
+                                             [packets[batch.packet_begin + i].node_index];
+                if (scene.main_camera_occluded_entities.count(node.ref_entity)) {
+                    continue;
+                }
+
+                instance_indices[instance_count++] = node.instance_index;
+            }
+            if (instance_count == 0) {
                 continue;
             }
 
-            VkDeviceSize offset = 0;
-            m_ctx->cmdBindVertexBuffers(
-                command_buffer, 0, 1, &mesh->vertex_buffer, &offset
-            );
-            m_ctx->cmdBindIndexBuffer(
-                command_buffer, mesh->index_buffer, 0, VK_INDEX_TYPE_UINT32
+            bindMeshBuffers(command_buffer, *mesh, mesh_buffer_binding);
+            m_ctx->cmdDrawIndexed(
+                command_buffer,
+                mesh->index_count,
+                instance_count,
+                mesh->first_index,
+                mesh->vertex_offset,
+                batch_first_instance
             );
+        }
 
-            uint32_t per_drawcall_max_instance = k_mesh_per_drawcall_max_instance_count;
-            uint32_t drawcall_count =
-                ROUND_UP(total_instance_count, per_drawcall_max_instance) /
-                per_drawcall_max_instance;
-
-            for (uint32_t drawcall_index = 0; drawcall_index < drawcall_count;
-                 ++drawcall_index) {
-                uint32_t current_instance_count = per_drawcall_max_instance;
-                if (total_instance_count - per_drawcall_max_instance * drawcall_index <
-                    per_drawcall_max_instance) {
-                    // rest
-                    current_instance_count =
-                        total_instance_count - per_drawcall_max_instance * drawcall_index;
-                }
-
-                uint32_t per_drawcall_dynamic_offset = ROUND_UP(
-                    m_res->global_render_resource.storage_buffer
-                        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-                    m_res->global_render_resource.storage_buffer
-                        .min_storage_buffer_offset_alignment
-                );
-                m_res->global_render_resource.storage_buffer
-                    .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-                    per_drawcall_dynamic_offset +
-                    sizeof(MeshPerDrawcallStorageBufferObject);
-                assert(
-                    m_res->global_render_resource.storage_buffer
-                        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-                    m_res->global_render_resource.storage_buffer
-                            .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-                        m_res->global_render_resource.storage_buffer
-                            .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
-                );
-
-                MeshPerDrawcallStorageBufferObject *per_drawcall_storage_buffer_object =
-                    reinterpret_cast<MeshPerDrawcallStorageBufferObject *>(
-                        reinterpret_cast<uintptr_t>(
-                            m_res->global_render_resource.storage_buffer
-                                .global_upload_ringbuffer_memory_pointer
-                        ) +
-                        per_drawcall_dynamic_offset
-                    );
-                for (uint32_t i = 0; i < current_instance_count; ++i) {
-                    per_drawcall_storage_buffer_object->mesh_instances[i].model_matrix =
-                        batch_nodes[per_drawcall_max_instance * drawcall_index + i];
-                }
+        // the node list is empty when culling runs on the gpu
+        if (scene.gpuDrivenCulling()) {
+            drawIndirect(command_buffer, GpuScene::_draw_view_main_camera);
+        }
 
-                uint32_t dynamic_offsets[2] = {
-                    per_frame_dynamic_offset, per_drawcall_dynamic_offset
-                };
-
-                m_ctx->cmdBindDescriptorSets(
-                    command_buffer,
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipeline_layouts[_pipeline_type_mesh_gbuffer],
-                    0,
-                    1,
-                    &descriptor_sets[_layout_type_mesh_global],
-                    2,
-                    dynamic_offsets
-                );
-
-                m_ctx->cmdDrawIndexed(
-                    command_buffer, mesh->index_count, current_instance_count, 0, 0, 0
-                );
-            }
+        // the skybox shares the subpass, draw it after the meshes of the last chunk
+        if (draw_skybox && chunk == chunk_count - 1) {
+            drawSkybox(command_buffer, per_frame_dynamic_offset);
         }
-    }
 
-    m_ctx->popEvent(command_buffer);
+        m_ctx->popEvent(command_buffer);
+    };
+
+    recordSecondaryCommandBuffers(
+        chunk_count,
+        subpass,
+        m_swapchain_framebuffers[m_ctx->currentSwapchainImageIndex()],
+        record
+    );
 }
 
 void MainPass::drawDeferredLighting() {
+    uint32_t per_frame_dynamic_offset =
+        m_res->allocateRingBuffer(sizeof(MeshPerFrameStorageBufferObject));
+    if (per_frame_dynamic_offset == FrameUploadBuffer::k_invalid_offset) {
+        return;
+    }
+    *static_cast<MeshPerFrameStorageBufferObject *>(
+        m_res->getRingBufferPointer(per_frame_dynamic_offset)
+    ) = m_res->mesh_per_frame_storage_buffer_object;
+
     VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
 
     float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
@@ -2141,30 +2145,6 @@ void MainPass::drawDeferredLighting() {
     m_ctx->cmdSetViewport(command_buffer, 0, 1, &viewport);
     m_ctx->cmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    uint32_t per_frame_dynamic_offset = ROUND_UP(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-        m_res->global_render_resource.storage_buffer.min_storage_buffer_offset_alignment
-    );
-    m_res->global_render_resource.storage_buffer
-        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-        per_frame_dynamic_offset + sizeof(MeshPerFrameStorageBufferObject);
-    assert(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-        m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-            m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
-    );
-    MeshPerFrameStorageBufferObject *per_frame_storage_buffer_object =
-        reinterpret_cast<MeshPerFrameStorageBufferObject *>(
-            reinterpret_cast<uintptr_t>(m_res->global_render_resource.storage_buffer
-                                            .global_upload_ringbuffer_memory_pointer) +
-            per_frame_dynamic_offset
-        );
-    *per_frame_storage_buffer_object = m_res->mesh_per_frame_storage_buffer_object;
-
     VkDescriptorSet sets[3] = {
         descriptor_sets[_layout_type_mesh_global],
         descriptor_sets[_layout_type_deferred_lighting],
@@ -2190,193 +2170,18 @@ void MainPass::drawDeferredLighting() {
 }
 
 void MainPass::drawMeshLighting(const RenderScene &scene) {
-    using MeshBatch = std::unordered_map<const MeshResource *, std::vector<glm::mat4>>;
-
-    std::unordered_map<const PBRMaterialResource *, MeshBatch>
-        main_camera_mesh_drawcall_batch;
-
-    for (const auto &node : scene.main_camera_visible_mesh_nodes) {
-        auto &mesh_batch = main_camera_mesh_drawcall_batch[node.ref_material];
-        auto &batch_nodes = mesh_batch[node.ref_mesh];
-
-        batch_nodes.push_back(node.model_matrix);
-    }
-
-    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
-
-    float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_ctx->pushEvent(command_buffer, "Mesh Lighting", color);
-
-    m_ctx->cmdBindPipeline(
-        command_buffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelines[_pipeline_type_mesh_lighting]
-    );
-
-    VkViewport viewport = {
-        0.0,
-        0.0,
-        static_cast<float>(m_ctx->swapchain_extent.width),
-        static_cast<float>(m_ctx->swapchain_extent.height),
-        0.0,
-        1.0
-    };
-    VkRect2D scissor = {
-        0, 0, m_ctx->swapchain_extent.width, m_ctx->swapchain_extent.height
-    };
-
-    m_ctx->cmdSetViewport(command_buffer, 0, 1, &viewport);
-    m_ctx->cmdSetScissor(command_buffer, 0, 1, &scissor);
-
-    uint32_t per_frame_dynamic_offset = ROUND_UP(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-        m_res->global_render_resource.storage_buffer.min_storage_buffer_offset_alignment
+    drawMeshes(
+        scene,
+        _pipeline_type_mesh_lighting,
+        _subpass_forward_lighting,
+        "Mesh Lighting",
+        true
     );
-    m_res->global_render_resource.storage_buffer
-        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-        per_frame_dynamic_offset + sizeof(MeshPerFrameStorageBufferObject);
-    assert(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-        m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-            m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
-    );
-    MeshPerFrameStorageBufferObject *per_frame_storage_buffer_object =
-        reinterpret_cast<MeshPerFrameStorageBufferObject *>(
-            reinterpret_cast<uintptr_t>(m_res->global_render_resource.storage_buffer
-                                            .global_upload_ringbuffer_memory_pointer) +
-            per_frame_dynamic_offset
-        );
-    *per_frame_storage_buffer_object = m_res->mesh_per_frame_storage_buffer_object;
-
-    for (auto &[material, mesh_batch] : main_camera_mesh_drawcall_batch) {
-        m_ctx->cmdBindDescriptorSets(
-            command_buffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipeline_layouts[_pipeline_type_mesh_gbuffer],
-            1,
-            1,
-            &material->material_descriptor_set,
-            0,
-            nullptr
-        );
-
-        for (auto &[mesh, batch_nodes] : mesh_batch) {
-            uint32_t total_instance_count = batch_nodes.size();
-            if (total_instance_count == 0) {
-                continue;
-            }
-
-            VkDeviceSize offset = 0;
-            m_ctx->cmdBindVertexBuffers(
-                command_buffer, 0, 1, &mesh->vertex_buffer, &offset
-            );
-            m_ctx->cmdBindIndexBuffer(
-                command_buffer, mesh->index_buffer, 0, VK_INDEX_TYPE_UINT32
-            );
-
-            uint32_t per_drawcall_max_instance = k_mesh_per_drawcall_max_instance_count;
-            uint32_t drawcall_count =
-                ROUND_UP(total_instance_count, per_drawcall_max_instance) /
-                per_drawcall_max_instance;
-
-            for (uint32_t drawcall_index = 0; drawcall_index < drawcall_count;
-                 ++drawcall_index) {
-                uint32_t current_instance_count = per_drawcall_max_instance;
-                if (total_instance_count - per_drawcall_max_instance * drawcall_index <
-                    per_drawcall_max_instance) {
-                    // rest
-                    current_instance_count =
-                        total_instance_count - per_drawcall_max_instance * drawcall_index;
-                }
-
-                uint32_t per_drawcall_dynamic_offset = ROUND_UP(
-                    m_res->global_render_resource.storage_buffer
-                        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-                    m_res->global_render_resource.storage_buffer
-                        .min_storage_buffer_offset_alignment
-                );
-                m_res->global_render_resource.storage_buffer
-                    .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-                    per_drawcall_dynamic_offset +
-                    sizeof(MeshPerDrawcallStorageBufferObject);
-                assert(
-                    m_res->global_render_resource.storage_buffer
-                        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-                    m_res->global_render_resource.storage_buffer
-                            .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-                        m_res->global_render_resource.storage_buffer
-                            .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
-                );
-
-                MeshPerDrawcallStorageBufferObject *per_drawcall_storage_buffer_object =
-                    reinterpret_cast<MeshPerDrawcallStorageBufferObject *>(
-                        reinterpret_cast<uintptr_t>(
-                            m_res->global_render_resource.storage_buffer
-                                .global_upload_ringbuffer_memory_pointer
-                        ) +
-                        per_drawcall_dynamic_offset
-                    );
-                for (uint32_t i = 0; i < current_instance_count; ++i) {
-                    per_drawcall_storage_buffer_object->mesh_instances[i].model_matrix =
-                        batch_nodes[per_drawcall_max_instance * drawcall_index + i];
-                }
-
-                uint32_t dynamic_offsets[2] = {
-                    per_frame_dynamic_offset, per_drawcall_dynamic_offset
-                };
-
-                m_ctx->cmdBindDescriptorSets(
-                    command_buffer,
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipeline_layouts[_pipeline_type_mesh_gbuffer],
-                    0,
-                    1,
-                    &descriptor_sets[_layout_type_mesh_global],
-                    2,
-                    dynamic_offsets
-                );
-
-                m_ctx->cmdDrawIndexed(
-                    command_buffer, mesh->index_count, current_instance_count, 0, 0, 0
-                );
-            }
-        }
-    }
-
-    m_ctx->popEvent(command_buffer);
 }
 
-void MainPass::drawSkybox() {
-    uint32_t per_frame_dynamic_offset = ROUND_UP(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-        m_res->global_render_resource.storage_buffer.min_storage_buffer_offset_alignment
-    );
-    m_res->global_render_resource.storage_buffer
-        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-        per_frame_dynamic_offset + sizeof(MeshPerFrameStorageBufferObject);
-    assert(
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-        m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-            m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
-    );
-    MeshPerFrameStorageBufferObject *per_frame_storage_buffer_object =
-        reinterpret_cast<MeshPerFrameStorageBufferObject *>(
-            reinterpret_cast<uintptr_t>(m_res->global_render_resource.storage_buffer
-                                            .global_upload_ringbuffer_memory_pointer) +
-            per_frame_dynamic_offset
-        );
-    *per_frame_storage_buffer_object = m_res->mesh_per_frame_storage_buffer_object;
-
-    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
-
+void MainPass::drawSkybox(
+    VkCommandBuffer command_buffer, uint32_t per_frame_dynamic_offset
+) {
     float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
     m_ctx->pushEvent(command_buffer, "Skybox", color);
 
@@ -2,6 +2,7 @@
 
 #include "function/render/passes/combine_ui_pass.h"
 #include "function/render/passes/tone_mapping_pass.h"
+#include "function/render/draw_list.h"
 #include "function/render/passes/ui_pass.h"
 #include "function/render/render_pass.h"
 
@@ -18,7 +19,7 @@ class MainPass : public RenderPass {
   public:
     enum LayoutType : uint8_t {
         _layout_type_mesh_global = 0,
-        _layout_type_mesh_per_material,
+        _layout_type_mesh_materials,
         _layout_type_skybox,
         _layout_type_deferred_lighting,
         _layout_type_count
@@ -54,11 +55,20 @@ class MainPass : public RenderPass {
 
     void onResize();
 
+    // upper bound of the ring buffer bytes draw or drawForward take
+    VkDeviceSize ringBufferUsage(const RenderScene &scene) const;
+
   private:
     VkImageView m_point_light_shadow_color_image_view{};
     VkImageView m_directional_light_shadow_color_image_view{};
     std::vector<VkFramebuffer> m_swapchain_framebuffers{};
 
+    // shared by the gbuffer and forward lighting draws, they walk the same nodes
+    DrawList m_draw_list{};
+    std::vector<uint32_t> m_chunk_begins{};
+    // ring buffer version the per frame and index list descriptors were written at
+    uint64_t m_ring_buffer_version{};
+
     void createAttachments();
     void createRenderPass();
     void createDescriptorSetLayouts();
@@ -70,13 +80,22 @@ class MainPass : public RenderPass {
     void allocateMeshGlobalDescriptorSet();
     void allocateSkyBoxDescriptorSet();
     void allocateGbufferLightingDescriptorSet();
+    void updateRingBufferDescriptors();
 
     void clearAttachmentsAndFramebuffers();
 
     void drawMeshGbuffer(const RenderScene &scene);
     void drawDeferredLighting();
     void drawMeshLighting(const RenderScene &scene);
-    void drawSkybox();
+    void drawSkybox(VkCommandBuffer command_buffer, uint32_t per_frame_dynamic_offset);
+    // records the main camera nodes of subpass in parallel
+    void drawMeshes(
+        const RenderScene &scene,
+        RenderPipeLineType pipeline_type,
+        uint32_t subpass,
+        const char *event_name,
+        bool draw_skybox
+    );
 };
 
 }  // namespace Vain
\ No newline at end of file
@@ -0,0 +1,716 @@
+#include "occlusion_cull_pass.h"
+
+#include <algorithm>
+
+#include "core/base/macro.h"
+#include "core/vulkan/vulkan_utils.h"
+#include "function/render/render_scene.h"
+
+namespace Vain {
+
+static std::vector<uint8_t> s_depth_pyramid_comp = {
+#include "depth_pyramid.comp.spv.h"
+};
+
+static std::vector<uint8_t> s_occlusion_cull_comp = {
+#include "occlusion_cull.comp.spv.h"
+};
+
+static constexpr uint32_t k_max_depth_pyramid_level_count = 16;
+static constexpr uint32_t k_occlusion_cull_initial_capacity = 1024;
+
+static uint32_t previousPowerOfTwo(uint32_t value) {
+    uint32_t result = 1;
+    while (result * 2 <= value) {
+        result *= 2;
+    }
+
+    return result;
+}
+
+static VkImageAspectFlags depthImageAspectMask(VkFormat format) {
+    if (format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT) {
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+OcclusionCullPass::~OcclusionCullPass() { clear(); }
+
+void OcclusionCullPass::initialize(RenderPassInitInfo *init_info) {
+    RenderPass::initialize(init_info);
+
+    createDepthPyramid();
+    createDescriptorSetLayouts();
+    createPipelines();
+    allocateDescriptorSets();
+
+    for (auto &frame : m_frames) {
+        reserveFrameResource(frame, k_occlusion_cull_initial_capacity);
+    }
+    updateDepthPyramidDescriptorSets();
+}
+
+void OcclusionCullPass::clear() {
+    for (auto &frame : m_frames) {
+        destroyFrameResource(frame);
+    }
+
+    for (auto pipeline : pipelines) {
+        vkDestroyPipeline(m_ctx->device, pipeline, nullptr);
+    }
+    pipelines.clear();
+
+    for (auto pipeline_layout : pipeline_layouts) {
+        vkDestroyPipelineLayout(m_ctx->device, pipeline_layout, nullptr);
+    }
+    pipeline_layouts.clear();
+
+    for (auto descriptor_set_layout : descriptor_set_layouts) {
+        vkDestroyDescriptorSetLayout(m_ctx->device, descriptor_set_layout, nullptr);
+    }
+    descriptor_set_layouts.clear();
+
+    destroyDepthPyramid();
+}
+
+void OcclusionCullPass::onResize() {
+    destroyDepthPyramid();
+    createDepthPyramid();
+    updateDepthPyramidDescriptorSets();
+}
+
+void OcclusionCullPass::updateOcclusion(RenderScene &scene) {
+    // the current slot was waited for, the others are read once their fence signaled
+    const FrameResource *latest = nullptr;
+    for (uint32_t i = 0; i < VulkanContext::k_max_frames_in_flight; ++i) {
+        const FrameResource &frame = m_frames[i];
+        if (frame.frame_number == 0 ||
+            (latest && frame.frame_number < latest->frame_number)) {
+            continue;
+        }
+        if (i != m_ctx->currentFrameIndex() &&
+            vkGetFenceStatus(m_ctx->device, m_ctx->is_frame_in_flight_fences[i]) !=
+                VK_SUCCESS) {
+            continue;
+        }
+        latest = &frame;
+    }
+
+    scene.main_camera_occluded_entities.clear();
+    // the candidates of a frame older than a removal may be gone
+    if (latest && latest->entity_epoch >= scene.entityRemovalEpoch()) {
+        const uint32_t *visibility =
+            reinterpret_cast<const uint32_t *>(latest->cull_output_pointer);
+        for (size_t i = 0; i < latest->candidates.size(); ++i) {
+            const RenderEntity *entity = latest->candidates[i];
+            if (!visibility[i] && entity->epoch <= latest->entity_epoch) {
+                scene.main_camera_occluded_entities.insert(entity);
+            }
+        }
+    }
+
+    scene.visibility_statistics.main_camera_occluded_count =
+        scene.main_camera_occluded_entities.size();
+}
+
+void OcclusionCullPass::draw(const RenderScene &scene) {
+    FrameResource &frame = m_frames[m_ctx->currentFrameIndex()];
+
+    frame.frame_number = ++m_frame_number;
+    frame.entity_epoch = scene.entityEpoch();
+    frame.candidates.clear();
+    for (const auto &node : scene.main_camera_visible_mesh_nodes) {
+        frame.candidates.push_back(node.ref_entity);
+    }
+    if (frame.candidates.empty()) {
+        return;
+    }
+
+    uint32_t candidate_count = frame.candidates.size();
+    reserveFrameResource(frame, candidate_count);
+    VkDescriptorSet cull_descriptor_set = writeCullDescriptorSet(frame);
+    if (!cull_descriptor_set) {
+        frame.candidates.clear();
+        return;
+    }
+
+    auto *cull_input = reinterpret_cast<OcclusionCullPerFrameStorageBufferObject *>(
+        frame.cull_input_pointer
+    );
+    cull_input->proj_view_matrix =
+        m_res->mesh_per_frame_storage_buffer_object.proj_view_matrix;
+    cull_input->depth_pyramid_width = m_depth_pyramid_width;
+    cull_input->depth_pyramid_height = m_depth_pyramid_height;
+    cull_input->depth_pyramid_level_count = m_depth_pyramid_level_count;
+    cull_input->candidate_count = candidate_count;
+
+    auto *candidates = reinterpret_cast<OcclusionCullCandidate *>(cull_input + 1);
+    for (uint32_t i = 0; i < candidate_count; ++i) {
+        const AxisAlignedBoundingBox &aabb = frame.candidates[i]->world_aabb;
+        candidates[i].center = glm::vec4{aabb.center, 0.0f};
+        candidates[i].half_extent = glm::vec4{aabb.half_extent, 0.0f};
+    }
+
+    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
+
+    float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    m_ctx->pushEvent(command_buffer, "Occlusion Cull", color);
+
+    {
+        VkImageMemoryBarrier barriers[2]{};
+
+        // the main pass depth becomes the source of the first level
+        barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].image = m_ctx->depth_image;
+        barriers[0].subresourceRange = {
+            depthImageAspectMask(m_ctx->depth_image_format), 0, 1, 0, 1
+        };
+
+        // the pyramid is rebuilt from scratch every frame
+        barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[1].srcAccessMask = 0;
+        barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].image = m_depth_pyramid;
+        barriers[1].subresourceRange = {
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, m_depth_pyramid_level_count, 0, 1
+        };
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            ARRAY_SIZE(barriers),
+            barriers
+        );
+    }
+
+    VkMemoryBarrier level_barrier{};
+    level_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    level_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    level_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    m_ctx->cmdBindPipeline(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[_pipeline_type_depth_pyramid]
+    );
+
+    uint32_t in_width = m_ctx->swapchain_extent.width;
+    uint32_t in_height = m_ctx->swapchain_extent.height;
+    for (uint32_t level = 0; level < m_depth_pyramid_level_count; ++level) {
+        uint32_t out_width = std::max(m_depth_pyramid_width >> level, 1u);
+        uint32_t out_height = std::max(m_depth_pyramid_height >> level, 1u);
+
+        m_ctx->cmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            pipeline_layouts[_pipeline_type_depth_pyramid],
+            0,
+            1,
+            &descriptor_sets[level],
+            0,
+            nullptr
+        );
+
+        uint32_t sizes[4] = {in_width, in_height, out_width, out_height};
+        vkCmdPushConstants(
+            command_buffer,
+            pipeline_layouts[_pipeline_type_depth_pyramid],
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(sizes),
+            sizes
+        );
+
+        vkCmdDispatch(command_buffer, (out_width + 7) / 8, (out_height + 7) / 8, 1);
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1,
+            &level_barrier,
+            0,
+            nullptr,
+            0,
+            nullptr
+        );
+
+        in_width = out_width;
+        in_height = out_height;
+    }
+
+    m_ctx->cmdBindPipeline(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[_pipeline_type_occlusion_cull]
+    );
+    m_ctx->cmdBindDescriptorSets(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipeline_layouts[_pipeline_type_occlusion_cull],
+        0,
+        1,
+        &cull_descriptor_set,
+        0,
+        nullptr
+    );
+    vkCmdDispatch(command_buffer, (candidate_count + 63) / 64, 1, 1);
+
+    {
+        // visibility is read on the host once the fence of this slot signals
+        VkBufferMemoryBarrier buffer_barrier{};
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.buffer = frame.cull_output_buffer;
+        buffer_barrier.offset = 0;
+        buffer_barrier.size = VK_WHOLE_SIZE;
+
+        // hand the depth back in the layout the main pass leaves it in
+        VkImageMemoryBarrier image_barrier{};
+        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_barrier.srcAccessMask = 0;
+        image_barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.image = m_ctx->depth_image;
+        image_barrier.subresourceRange = {
+            depthImageAspectMask(m_ctx->depth_image_format), 0, 1, 0, 1
+        };
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            0,
+            0,
+            nullptr,
+            1,
+            &buffer_barrier,
+            1,
+            &image_barrier
+        );
+    }
+
+    m_ctx->popEvent(command_buffer);
+}
+
+void OcclusionCullPass::createDepthPyramid() {
+    m_depth_pyramid_width = previousPowerOfTwo(m_ctx->swapchain_extent.width);
+    m_depth_pyramid_height = previousPowerOfTwo(m_ctx->swapchain_extent.height);
+
+    m_depth_pyramid_level_count = 1;
+    while ((std::max(m_depth_pyramid_width, m_depth_pyramid_height) >>
+            m_depth_pyramid_level_count) > 0 &&
+           m_depth_pyramid_level_count < k_max_depth_pyramid_level_count) {
+        ++m_depth_pyramid_level_count;
+    }
+
+    createImage(
+        m_ctx->physical_device,
+        m_ctx->device,
+        m_depth_pyramid_width,
+        m_depth_pyramid_height,
+        VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0,
+        1,
+        m_depth_pyramid_level_count,
+        m_depth_pyramid,
+        m_depth_pyramid_memory
+    );
+
+    m_depth_pyramid_view = createImageView(
+        m_ctx->device,
+        m_depth_pyramid,
+        VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_VIEW_TYPE_2D,
+        1,
+        m_depth_pyramid_level_count
+    );
+
+    m_depth_pyramid_level_views.resize(m_depth_pyramid_level_count);
+    for (uint32_t level = 0; level < m_depth_pyramid_level_count; ++level) {
+        VkImageViewCreateInfo image_view_create_info{};
+        image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        image_view_create_info.image = m_depth_pyramid;
+        image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        image_view_create_info.format = VK_FORMAT_R32_SFLOAT;
+        image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        image_view_create_info.subresourceRange.baseMipLevel = level;
+        image_view_create_info.subresourceRange.levelCount = 1;
+        image_view_create_info.subresourceRange.baseArrayLayer = 0;
+        image_view_create_info.subresourceRange.layerCount = 1;
+
+        VkResult res = vkCreateImageView(
+            m_ctx->device,
+            &image_view_create_info,
+            nullptr,
+            &m_depth_pyramid_level_views[level]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create depth pyramid level view");
+        }
+    }
+}
+
+void OcclusionCullPass::destroyDepthPyramid() {
+    for (auto view : m_depth_pyramid_level_views) {
+        vkDestroyImageView(m_ctx->device, view, nullptr);
+    }
+    m_depth_pyramid_level_views.clear();
+
+    vkDestroyImageView(m_ctx->device, m_depth_pyramid_view, nullptr);
+    vkDestroyImage(m_ctx->device, m_depth_pyramid, nullptr);
+    vkFreeMemory(m_ctx->device, m_depth_pyramid_memory, nullptr);
+    m_depth_pyramid_view = VK_NULL_HANDLE;
+    m_depth_pyramid = VK_NULL_HANDLE;
+    m_depth_pyramid_memory = VK_NULL_HANDLE;
+}
+
+void OcclusionCullPass::createDescriptorSetLayouts() {
+    descriptor_set_layouts.resize(_pipeline_type_count);
+
+    // depth pyramid, one set per level
+    {
+        VkDescriptorSetLayoutBinding depth_pyramid_layout_bindings[2]{};
+        depth_pyramid_layout_bindings[0].binding = 0;
+        depth_pyramid_layout_bindings[0].descriptorType =
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        depth_pyramid_layout_bindings[0].descriptorCount = 1;
+        depth_pyramid_layout_bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        depth_pyramid_layout_bindings[1].binding = 1;
+        depth_pyramid_layout_bindings[1].descriptorType =
+            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        depth_pyramid_layout_bindings[1].descriptorCount = 1;
+        depth_pyramid_layout_bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo depth_pyramid_layout_create_info{};
+        depth_pyramid_layout_create_info.sType =
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        depth_pyramid_layout_create_info.bindingCount =
+            ARRAY_SIZE(depth_pyramid_layout_bindings);
+        depth_pyramid_layout_create_info.pBindings = depth_pyramid_layout_bindings;
+
+        VkResult res = vkCreateDescriptorSetLayout(
+            m_ctx->device,
+            &depth_pyramid_layout_create_info,
+            nullptr,
+            &descriptor_set_layouts[_pipeline_type_depth_pyramid]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create descriptor set layout");
+        }
+    }
+
+    // occlusion cull, one set per frame in flight
+    {
+        VkDescriptorSetLayoutBinding occlusion_cull_layout_bindings[3]{};
+        occlusion_cull_layout_bindings[0].binding = 0;
+        occlusion_cull_layout_bindings[0].descriptorType =
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        occlusion_cull_layout_bindings[0].descriptorCount = 1;
+        occlusion_cull_layout_bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        occlusion_cull_layout_bindings[1].binding = 1;
+        occlusion_cull_layout_bindings[1].descriptorType =
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        occlusion_cull_layout_bindings[1].descriptorCount = 1;
+        occlusion_cull_layout_bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        occlusion_cull_layout_bindings[2].binding = 2;
+        occlusion_cull_layout_bindings[2].descriptorType =
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        occlusion_cull_layout_bindings[2].descriptorCount = 1;
+        occlusion_cull_layout_bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo occlusion_cull_layout_create_info{};
+        occlusion_cull_layout_create_info.sType =
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        occlusion_cull_layout_create_info.bindingCount =
+            ARRAY_SIZE(occlusion_cull_layout_bindings);
+        occlusion_cull_layout_create_info.pBindings = occlusion_cull_layout_bindings;
+
+        VkResult res = vkCreateDescriptorSetLayout(
+            m_ctx->device,
+            &occlusion_cull_layout_create_info,
+            nullptr,
+            &descriptor_set_layouts[_pipeline_type_occlusion_cull]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create descriptor set layout");
+        }
+    }
+}
+
+void OcclusionCullPass::createPipelines() {
+    pipelines.resize(_pipeline_type_count);
+    pipeline_layouts.resize(_pipeline_type_count);
+
+    std::vector<uint8_t> *shader_codes[_pipeline_type_count] = {
+        &s_depth_pyramid_comp, &s_occlusion_cull_comp
+    };
+
+    // source and destination size of the reduced level
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = 4 * sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < _pipeline_type_count; ++i) {
+        VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+        pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_create_info.setLayoutCount = 1;
+        pipeline_layout_create_info.pSetLayouts = &descriptor_set_layouts[i];
+        if (i == _pipeline_type_depth_pyramid) {
+            pipeline_layout_create_info.pushConstantRangeCount = 1;
+            pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+        }
+
+        VkResult res = vkCreatePipelineLayout(
+            m_ctx->device, &pipeline_layout_create_info, nullptr, &pipeline_layouts[i]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create pipeline layout");
+        }
+
+        VkShaderModule comp_shader_module =
+            createShaderModule(m_ctx->device, *shader_codes[i]);
+
+        VkComputePipelineCreateInfo compute_pipeline_create_info{};
+        compute_pipeline_create_info.sType =
+            VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        compute_pipeline_create_info.stage.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        compute_pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        compute_pipeline_create_info.stage.module = comp_shader_module;
+        compute_pipeline_create_info.stage.pName = "main";
+        compute_pipeline_create_info.layout = pipeline_layouts[i];
+
+        res = vkCreateComputePipelines(
+            m_ctx->device,
+            VK_NULL_HANDLE,
+            1,
+            &compute_pipeline_create_info,
+            nullptr,
+            &pipelines[i]
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to create compute pipeline");
+        }
+
+        vkDestroyShaderModule(m_ctx->device, comp_shader_module, nullptr);
+    }
+}
+
+void OcclusionCullPass::allocateDescriptorSets() {
+    descriptor_sets.resize(k_max_depth_pyramid_level_count);
+
+    for (VkDescriptorSet &descriptor_set : descriptor_sets) {
+        VkResult res = m_ctx->descriptor_allocator.allocate(
+            descriptor_set_layouts[_pipeline_type_depth_pyramid], &descriptor_set
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to allocate descriptor sets");
+        }
+    }
+}
+
+void OcclusionCullPass::updateDepthPyramidDescriptorSets() {
+    VkSampler sampler =
+        m_ctx->getOrCreateDefaultSampler(DefaultSamplerType::DEFAULT_SAMPLER_NEAREST);
+
+    for (uint32_t level = 0; level < m_depth_pyramid_level_count; ++level) {
+        VkDescriptorImageInfo in_depth_info{};
+        in_depth_info.sampler = sampler;
+        if (level == 0) {
+            in_depth_info.imageView = m_ctx->depth_image_view;
+            in_depth_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        } else {
+            in_depth_info.imageView = m_depth_pyramid_level_views[level - 1];
+            in_depth_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorImageInfo out_depth_info{};
+        out_depth_info.imageView = m_depth_pyramid_level_views[level];
+        out_depth_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet writes[2]{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = descriptor_sets[level];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].descriptorCount = 1;
+        writes[0].pImageInfo = &in_depth_info;
+
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = descriptor_sets[level];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].descriptorCount = 1;
+        writes[1].pImageInfo = &out_depth_info;
+
+        vkUpdateDescriptorSets(m_ctx->device, ARRAY_SIZE(writes), writes, 0, nullptr);
+    }
+}
+
+VkDescriptorSet OcclusionCullPass::writeCullDescriptorSet(const FrameResource &frame) {
+    // written for the frame only, the transient pool of the slot is reset with it
+    VkDescriptorSet descriptor_set{};
+    VkResult res = m_ctx->currentTransientDescriptorAllocator().allocate(
+        descriptor_set_layouts[_pipeline_type_occlusion_cull], &descriptor_set
+    );
+    if (res != VK_SUCCESS) {
+        VAIN_ERROR("failed to allocate descriptor sets");
+        return VK_NULL_HANDLE;
+    }
+
+    VkDescriptorImageInfo depth_pyramid_info{};
+    depth_pyramid_info.sampler =
+        m_ctx->getOrCreateDefaultSampler(DefaultSamplerType::DEFAULT_SAMPLER_NEAREST);
+    depth_pyramid_info.imageView = m_depth_pyramid_view;
+    depth_pyramid_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkDescriptorBufferInfo cull_input_info{};
+    cull_input_info.buffer = frame.cull_input_buffer;
+    cull_input_info.offset = 0;
+    cull_input_info.range = sizeof(OcclusionCullPerFrameStorageBufferObject) +
+                            sizeof(OcclusionCullCandidate) * frame.capacity;
+
+    VkDescriptorBufferInfo cull_output_info{};
+    cull_output_info.buffer = frame.cull_output_buffer;
+    cull_output_info.offset = 0;
+    cull_output_info.range = sizeof(uint32_t) * frame.capacity;
+
+    VkWriteDescriptorSet writes[3]{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = descriptor_set;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].descriptorCount = 1;
+    writes[0].pImageInfo = &depth_pyramid_info;
+
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = descriptor_set;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[1].descriptorCount = 1;
+    writes[1].pBufferInfo = &cull_input_info;
+
+    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[2].dstSet = descriptor_set;
+    writes[2].dstBinding = 2;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].descriptorCount = 1;
+    writes[2].pBufferInfo = &cull_output_info;
+
+    vkUpdateDescriptorSets(m_ctx->device, ARRAY_SIZE(writes), writes, 0, nullptr);
+    return descriptor_set;
+}
+
+void OcclusionCullPass::reserveFrameResource(
+    FrameResource &frame, uint32_t candidate_count
+) {
+    if (candidate_count <= frame.capacity) {
+        return;
+    }
+
+    // only called for the current slot, whose previous submission has finished
+    destroyFrameResource(frame);
+    frame.capacity = std::max(candidate_count, frame.capacity * 2);
+
+    VkDeviceSize cull_input_size = sizeof(OcclusionCullPerFrameStorageBufferObject) +
+                                   sizeof(OcclusionCullCandidate) * frame.capacity;
+    VkDeviceSize cull_output_size = sizeof(uint32_t) * frame.capacity;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_info.requiredFlags =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VmaAllocationInfo allocation_info{};
+
+    buffer_info.size = cull_input_size;
+    alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    vmaCreateBuffer(
+        m_ctx->assets_allocator,
+        &buffer_info,
+        &alloc_info,
+        &frame.cull_input_buffer,
+        &frame.cull_input_allocation,
+        &allocation_info
+    );
+    frame.cull_input_pointer = allocation_info.pMappedData;
+
+    buffer_info.size = cull_output_size;
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+    vmaCreateBuffer(
+        m_ctx->assets_allocator,
+        &buffer_info,
+        &alloc_info,
+        &frame.cull_output_buffer,
+        &frame.cull_output_allocation,
+        &allocation_info
+    );
+    frame.cull_output_pointer = allocation_info.pMappedData;
+}
+
+void OcclusionCullPass::destroyFrameResource(FrameResource &frame) {
+    if (frame.cull_input_buffer) {
+        vmaDestroyBuffer(
+            m_ctx->assets_allocator, frame.cull_input_buffer, frame.cull_input_allocation
+        );
+    }
+    if (frame.cull_output_buffer) {
+        vmaDestroyBuffer(
+            m_ctx->assets_allocator,
+            frame.cull_output_buffer,
+            frame.cull_output_allocation
+        );
+    }
+
+    frame.cull_input_buffer = VK_NULL_HANDLE;
+    frame.cull_input_allocation = VK_NULL_HANDLE;
+    frame.cull_input_pointer = nullptr;
+    frame.cull_output_buffer = VK_NULL_HANDLE;
+    frame.cull_output_allocation = VK_NULL_HANDLE;
+    frame.cull_output_pointer = nullptr;
+}
+
+}  // namespace Vain
\ No newline at end of file
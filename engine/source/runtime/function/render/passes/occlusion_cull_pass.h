@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+
+#include "function/render/render_pass.h"
+#include "function/render/render_type.h"
+
+namespace Vain {
+
+class RenderEntity;
+class RenderScene;
+
+// hierarchical z occlusion culling, reduces the main pass depth into a max depth pyramid
+// and tests the main camera visible nodes against it. results are read back from the
+// latest frame the gpu finished, usually the previous one, and entities added or moved
+// since are left visible
+class OcclusionCullPass : public RenderPass {
+  public:
+    enum {
+        _pipeline_type_depth_pyramid = 0,
+        _pipeline_type_occlusion_cull,
+        _pipeline_type_count
+    };
+
+    OcclusionCullPass() = default;
+    ~OcclusionCullPass();
+
+    virtual void initialize(RenderPassInitInfo *init_info) override;
+    virtual void clear() override;
+
+    void onResize();
+
+    // call after waitForFlight, applies the results of the latest finished frame
+    void updateOcclusion(RenderScene &scene);
+    // call after the main pass, the depth image has to hold the finished frame
+    void draw(const RenderScene &scene);
+
+  private:
+    struct FrameResource {
+        uint32_t capacity{};
+
+        VkBuffer cull_input_buffer{};
+        VmaAllocation cull_input_allocation{};
+        void *cull_input_pointer{};
+
+        VkBuffer cull_output_buffer{};
+        VmaAllocation cull_output_allocation{};
+        void *cull_output_pointer{};
+
+        // entities tested by the dispatch recorded in this slot
+        std::vector<const RenderEntity *> candidates{};
+        // of the frame recorded in this slot, 0 before any, and the scene entity epoch
+        // the candidates were taken at
+        uint64_t frame_number{};
+        uint64_t entity_epoch{};
+    };
+
+    VkImage m_depth_pyramid{};
+    VkDeviceMemory m_depth_pyramid_memory{};
+    VkImageView m_depth_pyramid_view{};
+    std::vector<VkImageView> m_depth_pyramid_level_views{};
+    uint32_t m_depth_pyramid_width{};
+    uint32_t m_depth_pyramid_height{};
+    uint32_t m_depth_pyramid_level_count{};
+
+    std::array<FrameResource, VulkanContext::k_max_frames_in_flight> m_frames{};
+    uint64_t m_frame_number{};
+
+    void createDepthPyramid();
+    void destroyDepthPyramid();
+    void createDescriptorSetLayouts();
+    void createPipelines();
+    void allocateDescriptorSets();
+    void updateDepthPyramidDescriptorSets();
+    VkDescriptorSet writeCullDescriptorSet(const FrameResource &frame);
+
+    void reserveFrameResource(FrameResource &frame, uint32_t candidate_count);
+    void destroyFrameResource(FrameResource &frame);
+};
+
+}  // namespace Vain
\ No newline at end of file
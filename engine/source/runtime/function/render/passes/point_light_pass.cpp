@@ -1,5 +1,7 @@
 #include "point_light_pass.h"
 
+#include <algorithm>
+
 #include "core/base/macro.h"
 #include "core/vulkan/vulkan_utils.h"
 #include "function/render/render_scene.h"
@@ -18,6 +20,8 @@ static std::vector<uint8_t> s_point_light_shadow_frag = {
 
 namespace Vain {
 
+static constexpr uint32_t k_point_light_initial_instance_capacity = 1024;
+
 PointLightPass::~PointLightPass() { clear(); }
 
 void PointLightPass::initialize(RenderPassInitInfo *init_info) {
@@ -32,6 +36,10 @@ void PointLightPass::initialize(RenderPassInitInfo *init_info) {
 }
 
 void PointLightPass::clear() {
+    for (auto &frame : m_frames) {
+        destroyFrameResource(frame);
+    }
+
     vkDestroyFramebuffer(m_ctx->device, framebuffer, nullptr);
 
     if (m_ctx->enablePointLightShadow()) {
@@ -51,19 +59,16 @@ void PointLightPass::clear() {
 }
 
 void PointLightPass::draw(const RenderScene &scene) {
-    using MeshBatch = std::unordered_map<const MeshResource *, std::vector<glm::mat4>>;
-
-    std::unordered_map<const PBRMaterialResource *, MeshBatch>
-        point_light_mesh_drawcall_batch;
+    m_draw_list.update(
+        scene.point_lights_visible_mesh_nodes,
+        scene.point_lights_visible_mesh_nodes_version
+    );
 
-    for (const auto &node : scene.directional_light_visible_mesh_nodes) {
-        auto &mesh_batch = point_light_mesh_drawcall_batch[node.ref_material];
-        auto &batch_nodes = mesh_batch[node.ref_mesh];
+    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
 
-        batch_nodes.push_back(node.model_matrix);
-    }
+    float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    m_ctx->pushEvent(command_buffer, "Point Light Shadow", color);
 
-    VkCommandBuffer command_buffer = m_ctx->currentCommandBuffer();
     {
         VkRenderPassBeginInfo render_pass_begin_info{};
         render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -81,147 +86,109 @@ void PointLightPass::draw(const RenderScene &scene) {
         render_pass_begin_info.pClearValues = clear_values;
 
         m_ctx->cmdBeginRenderPass(
-            command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE
+            command_buffer,
+            &render_pass_begin_info,
+            VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
         );
-
-        float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-        m_ctx->pushEvent(command_buffer, "Point Light Shadow", color);
     }
 
     if (m_ctx->enablePointLightShadow()) {
+        FrameResource &frame = m_frames[m_ctx->currentFrameIndex()];
+
+        RecordingKey key{};
+        key.nodes_version = scene.point_lights_visible_mesh_nodes_version;
+        key.draw_groups_version = m_res->gpu_scene.drawGroupsVersion();
+        key.instance_table_version = m_res->gpu_scene.version();
+        key.ring_buffer_version = m_res->frame_upload_buffer.version();
+        key.gpu_driven_culling = scene.gpuDrivenCulling();
+
+        // a static scene only replays the command buffers this slot recorded before
+        if (!executeCachedRecording(frame.recording, key)) {
+            recordFrame(scene, frame, key);
+        }
+
+        *static_cast<PointLightShadowPerFrameStorageBufferObject *>(frame.pointer) =
+            m_res->point_light_shadow_per_frame_storage_buffer_object;
+    }
+
+    m_ctx->cmdEndRenderPass(command_buffer);
+    m_ctx->popEvent(command_buffer);
+}
+
+void PointLightPass::recordFrame(
+    const RenderScene &scene, FrameResource &frame, const RecordingKey &key
+) {
+    const auto &packets = m_draw_list.packets();
+    const auto &batches = m_draw_list.batches();
+
+    // the slot's previous submission has finished, its buffers can be rewritten
+    reserveFrameResource(frame, packets.size());
+    updateFrameDescriptorSet(frame, key.gpu_driven_culling);
+
+    m_draw_list.splitBatches(recordingChunkCount(packets.size()), m_chunk_begins);
+    uint32_t chunk_count = static_cast<uint32_t>(m_chunk_begins.size() - 1);
+
+    auto record = [&](VkCommandBuffer command_buffer, uint32_t chunk) {
         float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
         m_ctx->pushEvent(command_buffer, "Mesh", color);
 
         m_ctx->cmdBindPipeline(
             command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[0]
         );
-
-        uint32_t per_frame_dynamic_offset = ROUND_UP(
-            m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-            m_res->global_render_resource.storage_buffer
-                .min_storage_buffer_offset_alignment
-        );
-        m_res->global_render_resource.storage_buffer
-            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-            per_frame_dynamic_offset +
-            sizeof(PointLightShadowPerFrameStorageBufferObject);
-        assert(
-            m_res->global_render_resource.storage_buffer
-                .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-            m_res->global_render_resource.storage_buffer
-                    .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()] +
-                m_res->global_render_resource.storage_buffer
-                    .global_upload_ringbuffers_size[m_ctx->currentFrameIndex()]
+        m_ctx->cmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipeline_layouts[0],
+            0,
+            1,
+            &frame.descriptor_set,
+            0,
+            nullptr
         );
 
-        PointLightShadowPerFrameStorageBufferObject *per_frame_storage_buffer_object =
-            reinterpret_cast<PointLightShadowPerFrameStorageBufferObject *>(
-                reinterpret_cast<uintptr_t>(m_res->global_render_resource.storage_buffer
-                                                .global_upload_ringbuffer_memory_pointer
-                ) +
-                per_frame_dynamic_offset
+        MeshBufferBinding mesh_buffer_binding{};
+
+        for (uint32_t batch_index = m_chunk_begins[chunk];
+             batch_index < m_chunk_begins[chunk + 1];
+             ++batch_index) {
+            const DrawList::Batch &batch = batches[batch_index];
+            const MeshResource *mesh =
+                scene.point_lights_visible_mesh_nodes
+                    [packets[batch.packet_begin].node_index]
+                        .ref_mesh;
+
+            // pairs of instance index and point light mask
+            uint32_t *instance_indices = frame.instance_indices + 2 * batch.packet_begin;
+            for (uint32_t i = 0; i < batch.packet_count; ++i) {
+                const RenderNode &node =
+                    scene.point_lights_visible_mesh_nodes
+                        [packets[batch.packet_begin + i].node_index];
+                instance_indices[2 * i] = node.instance_index;
+                instance_indices[2 * i + 1] = node.point_light_mask;
+            }
+
+            bindMeshBuffers(command_buffer, *mesh, mesh_buffer_binding);
+            m_ctx->cmdDrawIndexed(
+                command_buffer,
+                mesh->index_count,
+                batch.packet_count,
+                mesh->first_index,
+                mesh->vertex_offset,
+                batch.packet_begin
             );
-        *per_frame_storage_buffer_object =
-            m_res->point_light_shadow_per_frame_storage_buffer_object;
+        }
 
-        for (auto &[material, mesh_batch] : point_light_mesh_drawcall_batch) {
-            for (auto &[mesh, batch_nodes] : mesh_batch) {
-                uint32_t total_instance_count = batch_nodes.size();
-                if (total_instance_count == 0) {
-                    continue;
-                }
-
-                VkDeviceSize offset = 0;
-                m_ctx->cmdBindVertexBuffers(
-                    command_buffer, 0, 1, &mesh->vertex_buffer, &offset
-                );
-                m_ctx->cmdBindIndexBuffer(
-                    command_buffer, mesh->index_buffer, 0, VK_INDEX_TYPE_UINT32
-                );
-
-                uint32_t per_drawcall_max_instance =
-                    k_mesh_per_drawcall_max_instance_count;
-                uint32_t drawcall_count =
-                    ROUND_UP(total_instance_count, per_drawcall_max_instance) /
-                    per_drawcall_max_instance;
-                for (uint32_t drawcall_index = 0; drawcall_index < drawcall_count;
-                     ++drawcall_index) {
-                    uint32_t current_instance_count = per_drawcall_max_instance;
-                    if (total_instance_count -
-                            per_drawcall_max_instance * drawcall_index <
-                        per_drawcall_max_instance) {
-                        // rest
-                        current_instance_count =
-                            total_instance_count -
-                            per_drawcall_max_instance * drawcall_index;
-                    }
-
-                    uint32_t per_drawcall_dynamic_offset = ROUND_UP(
-                        m_res->global_render_resource.storage_buffer
-                            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()],
-                        m_res->global_render_resource.storage_buffer
-                            .min_storage_buffer_offset_alignment
-                    );
-                    m_res->global_render_resource.storage_buffer
-                        .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-                        per_drawcall_dynamic_offset +
-                        sizeof(MeshPerDrawcallStorageBufferObject);
-                    assert(
-                        m_res->global_render_resource.storage_buffer
-                            .global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] <=
-                        m_res->global_render_resource.storage_buffer
-                                .global_upload_ringbuffers_begin[m_ctx->currentFrameIndex(
-                                )] +
-                            m_res->global_render_resource.storage_buffer
-                                .global_upload_ringbuffers_size[m_ctx->currentFrameIndex(
-                                )]
-                    );
-
-                    MeshPerDrawcallStorageBufferObject
-                        *per_drawcall_storage_buffer_object =
-                            reinterpret_cast<MeshPerDrawcallStorageBufferObject *>(
-                                reinterpret_cast<uintptr_t>(
-                                    m_res->global_render_resource.storage_buffer
-                                        .global_upload_ringbuffer_memory_pointer
-                                ) +
-                                per_drawcall_dynamic_offset
-                            );
-                    for (uint32_t i = 0; i < current_instance_count; ++i) {
-                        per_drawcall_storage_buffer_object->mesh_instances[i]
-                            .model_matrix =
-                            batch_nodes[per_drawcall_max_instance * drawcall_index + i];
-                    }
-
-                    uint32_t dynamic_offsets[2] = {
-                        per_frame_dynamic_offset, per_drawcall_dynamic_offset
-                    };
-
-                    m_ctx->cmdBindDescriptorSets(
-                        command_buffer,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        pipeline_layouts[0],
-                        0,
-                        1,
-                        &descriptor_sets[0],
-                        2,
-                        dynamic_offsets
-                    );
-
-                    m_ctx->cmdDrawIndexed(
-                        command_buffer, mesh->index_count, current_instance_count, 0, 0, 0
-                    );
-                }
-            }
+        // the node list is empty when culling runs on the gpu
+        if (scene.gpuDrivenCulling()) {
+            drawIndirect(command_buffer, GpuScene::_draw_view_point_lights);
         }
 
         m_ctx->popEvent(command_buffer);
-    }
+    };
 
-    {
-        m_ctx->popEvent(command_buffer);
-        m_ctx->cmdEndRenderPass(command_buffer);
-    }
+    recordCachedSecondaryCommandBuffers(
+        frame.recording, key, chunk_count, 0, framebuffer, record
+    );
 }
 
 void PointLightPass::createAttachments() {
@@ -350,21 +317,25 @@ void PointLightPass::createRenderPass() {
 void PointLightPass::createDescriptorSetLayouts() {
     descriptor_set_layouts.resize(1);
 
-    VkDescriptorSetLayoutBinding point_light_shadow_global_layout_bindings[2]{};
+    VkDescriptorSetLayoutBinding point_light_shadow_global_layout_bindings[3]{};
 
     point_light_shadow_global_layout_bindings[0].binding = 0;
     point_light_shadow_global_layout_bindings[0].descriptorType =
-        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     point_light_shadow_global_layout_bindings[0].descriptorCount = 1;
     point_light_shadow_global_layout_bindings[0].stageFlags =
         VK_SHADER_STAGE_GEOMETRY_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
     point_light_shadow_global_layout_bindings[1].binding = 1;
     point_light_shadow_global_layout_bindings[1].descriptorType =
-        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     point_light_shadow_global_layout_bindings[1].descriptorCount = 1;
     point_light_shadow_global_layout_bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+    point_light_shadow_global_layout_bindings[2] =
+        point_light_shadow_global_layout_bindings[1];
+    point_light_shadow_global_layout_bindings[2].binding = 2;
+
     VkDescriptorSetLayoutCreateInfo point_light_shadow_global_layout_create_info{};
     point_light_shadow_global_layout_create_info.sType =
         VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -565,74 +536,15 @@ void PointLightPass::createPipelines() {
 }
 
 void PointLightPass::allocateDescriptorSets() {
-    descriptor_sets.resize(1);
-
-    VkDescriptorSetAllocateInfo point_light_shadow_global_descriptor_set_alloc_info;
-    point_light_shadow_global_descriptor_set_alloc_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    point_light_shadow_global_descriptor_set_alloc_info.pNext = NULL;
-    point_light_shadow_global_descriptor_set_alloc_info.descriptorPool =
-        m_ctx->descriptor_pool;
-    point_light_shadow_global_descriptor_set_alloc_info.descriptorSetCount = 1;
-    point_light_shadow_global_descriptor_set_alloc_info.pSetLayouts =
-        &descriptor_set_layouts[0];
-
-    VkResult res = vkAllocateDescriptorSets(
-        m_ctx->device,
-        &point_light_shadow_global_descriptor_set_alloc_info,
-        &descriptor_sets[0]
-    );
-    if (res != VK_SUCCESS) {
-        VAIN_ERROR("failed to allocate descriptor set");
+    // written when the slot records its command buffers
+    for (auto &frame : m_frames) {
+        VkResult res = m_ctx->descriptor_allocator.allocate(
+            descriptor_set_layouts[0], &frame.descriptor_set
+        );
+        if (res != VK_SUCCESS) {
+            VAIN_ERROR("failed to allocate descriptor set");
+        }
     }
-
-    VkDescriptorBufferInfo mesh_point_light_shadow_per_frame_storage_buffer_info{};
-    mesh_point_light_shadow_per_frame_storage_buffer_info.offset = 0;
-    mesh_point_light_shadow_per_frame_storage_buffer_info.range =
-        sizeof(PointLightShadowPerFrameStorageBufferObject);
-    mesh_point_light_shadow_per_frame_storage_buffer_info.buffer =
-        m_res->global_render_resource.storage_buffer.global_upload_ringbuffer;
-    assert(
-        mesh_point_light_shadow_per_frame_storage_buffer_info.range <
-        m_res->global_render_resource.storage_buffer.max_storage_buffer_range
-    );
-
-    VkDescriptorBufferInfo mesh_point_light_shadow_per_drawcall_storage_buffer_info{};
-    mesh_point_light_shadow_per_drawcall_storage_buffer_info.offset = 0;
-    mesh_point_light_shadow_per_drawcall_storage_buffer_info.range =
-        sizeof(MeshPerDrawcallStorageBufferObject);
-    mesh_point_light_shadow_per_drawcall_storage_buffer_info.buffer =
-        m_res->global_render_resource.storage_buffer.global_upload_ringbuffer;
-    assert(
-        mesh_point_light_shadow_per_drawcall_storage_buffer_info.range <
-        m_res->global_render_resource.storage_buffer.max_storage_buffer_range
-    );
-
-    VkWriteDescriptorSet point_light_shadow_per_frame_storage_buffer_writes[2]{};
-    point_light_shadow_per_frame_storage_buffer_writes[0].sType =
-        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    point_light_shadow_per_frame_storage_buffer_writes[0].dstSet = descriptor_sets[0];
-    point_light_shadow_per_frame_storage_buffer_writes[0].dstBinding = 0;
-    point_light_shadow_per_frame_storage_buffer_writes[0].dstArrayElement = 0;
-    point_light_shadow_per_frame_storage_buffer_writes[0].descriptorType =
-        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-    point_light_shadow_per_frame_storage_buffer_writes[0].descriptorCount = 1;
-    point_light_shadow_per_frame_storage_buffer_writes[0].pBufferInfo =
-        &mesh_point_light_shadow_per_frame_storage_buffer_info;
-
-    point_light_shadow_per_frame_storage_buffer_writes[1] =
-        point_light_shadow_per_frame_storage_buffer_writes[0];
-    point_light_shadow_per_frame_storage_buffer_writes[1].dstBinding = 1;
-    point_light_shadow_per_frame_storage_buffer_writes[1].pBufferInfo =
-        &mesh_point_light_shadow_per_drawcall_storage_buffer_info;
-
-    vkUpdateDescriptorSets(
-        m_ctx->device,
-        ARRAY_SIZE(point_light_shadow_per_frame_storage_buffer_writes),
-        point_light_shadow_per_frame_storage_buffer_writes,
-        0,
-        nullptr
-    );
 }
 
 void PointLightPass::createFramebuffer() {
@@ -658,4 +570,110 @@ void PointLightPass::createFramebuffer() {
     }
 }
 
+void PointLightPass::reserveFrameResource(FrameResource &frame, uint32_t instance_count) {
+    if (frame.buffer && instance_count <= frame.capacity) {
+        return;
+    }
+
+    destroyFrameResource(frame);
+    frame.capacity = std::max(
+        {instance_count, frame.capacity * 2, k_point_light_initial_instance_capacity}
+    );
+
+    VkDeviceSize instance_indices_offset = instanceIndicesOffset();
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = instance_indices_offset + 2 * sizeof(uint32_t) * frame.capacity;
+    buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_info.requiredFlags =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VmaAllocationInfo allocation_info{};
+    if (vmaCreateBuffer(
+            m_ctx->assets_allocator,
+            &buffer_info,
+            &alloc_info,
+            &frame.buffer,
+            &frame.allocation,
+            &allocation_info
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to create point light shadow frame buffer");
+    }
+    frame.pointer = allocation_info.pMappedData;
+    frame.instance_indices = reinterpret_cast<uint32_t *>(
+        static_cast<uint8_t *>(frame.pointer) + instance_indices_offset
+    );
+}
+
+void PointLightPass::destroyFrameResource(FrameResource &frame) {
+    if (frame.buffer) {
+        vmaDestroyBuffer(m_ctx->assets_allocator, frame.buffer, frame.allocation);
+    }
+
+    frame.buffer = VK_NULL_HANDLE;
+    frame.allocation = VK_NULL_HANDLE;
+    frame.pointer = nullptr;
+    frame.instance_indices = nullptr;
+    // the recording reads the destroyed buffer
+    frame.recording.recorded = false;
+}
+
+void PointLightPass::updateFrameDescriptorSet(
+    const FrameResource &frame, bool gpu_driven_culling
+) {
+    VkDescriptorBufferInfo per_frame_storage_buffer_info{};
+    per_frame_storage_buffer_info.buffer = frame.buffer;
+    per_frame_storage_buffer_info.offset = 0;
+    per_frame_storage_buffer_info.range =
+        sizeof(PointLightShadowPerFrameStorageBufferObject);
+
+    VkDescriptorBufferInfo instances_storage_buffer_info{};
+    instances_storage_buffer_info.buffer = m_res->gpu_scene.instanceBuffer();
+    instances_storage_buffer_info.offset = 0;
+    instances_storage_buffer_info.range = VK_WHOLE_SIZE;
+
+    // the gpu cull pass writes its index pairs to the ring buffer, binding 2 sees all of
+    // it and the pairs of a draw are reached through firstInstance
+    VkDescriptorBufferInfo indices_storage_buffer_info{};
+    if (gpu_driven_culling) {
+        indices_storage_buffer_info.buffer = m_res->frame_upload_buffer.buffer();
+        indices_storage_buffer_info.offset = 0;
+    } else {
+        indices_storage_buffer_info.buffer = frame.buffer;
+        indices_storage_buffer_info.offset = instanceIndicesOffset();
+    }
+    indices_storage_buffer_info.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[3]{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = frame.descriptor_set;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].descriptorCount = 1;
+    writes[0].pBufferInfo = &per_frame_storage_buffer_info;
+
+    writes[1] = writes[0];
+    writes[1].dstBinding = 1;
+    writes[1].pBufferInfo = &instances_storage_buffer_info;
+
+    writes[2] = writes[0];
+    writes[2].dstBinding = 2;
+    writes[2].pBufferInfo = &indices_storage_buffer_info;
+
+    vkUpdateDescriptorSets(m_ctx->device, ARRAY_SIZE(writes), writes, 0, nullptr);
+}
+
+VkDeviceSize PointLightPass::instanceIndicesOffset() const {
+    return ROUND_UP(
+        sizeof(PointLightShadowPerFrameStorageBufferObject),
+        m_res->global_render_resource.storage_buffer.min_storage_buffer_offset_alignment
+    );
+}
+
 }  // namespace Vain
\ No newline at end of file
@@ -62,7 +62,7 @@ void UIPass::initializeUIRenderBackend(WindowUI *window_ui) {
     init_info.Device = m_ctx->device;
     init_info.QueueFamily = m_ctx->queue_indices.graphics_family.value();
     init_info.Queue = m_ctx->graphics_queue;
-    init_info.DescriptorPool = m_ctx->descriptor_pool;
+    init_info.DescriptorPool = m_ctx->ui_descriptor_pool;
     init_info.RenderPass = render_pass;
 
     init_info.MinImageCount = 3;
@@ -85,10 +85,10 @@ std::shared_ptr<TextureData> loadTexture(const std::string &file, bool is_srgb)
     AssetManager *asset_manager = g_runtime_global_context.asset_manager.get();
     std::shared_ptr<TextureData> texture = std::make_shared<TextureData>();
 
+    texture->file = asset_manager->getFullPath(file).generic_string();
+
     int iw, ih, n;
-    texture->pixels = stbi_load(
-        asset_manager->getFullPath(file).generic_string().c_str(), &iw, &ih, &n, 4
-    );
+    texture->pixels = stbi_load(texture->file.c_str(), &iw, &ih, &n, 4);
 
     if (!texture->pixels) {
         return nullptr;
@@ -36,14 +36,25 @@ struct TextureData {
 
     VkFormat format{};
 
+    // resolved path of the file decoded, which with the format identifies the texture
+    std::string file{};
+
     ~TextureData();
 };
 
+// position only stand-in inside a mesh for the software occlusion rasterizer
+struct OccluderMesh {
+    std::vector<glm::vec3> vertices{};
+    std::vector<uint32_t> indices{};
+};
+
 struct MeshData {
     std::vector<MeshVertex> vertices{};
     std::vector<uint32_t> indices{};
 
     AxisAlignedBoundingBox aabb{};
+
+    std::shared_ptr<OccluderMesh> occluder{};
 };
 
 struct PBRMaterialData {
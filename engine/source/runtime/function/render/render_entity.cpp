@@ -1,3 +1,9 @@
 #include "render_entity.h"
 
-namespace Vain {}
\ No newline at end of file
+namespace Vain {
+
+void RenderEntity::updateWorldBoundingBox() {
+    world_aabb = boundingBoxTransform(aabb, model_matrix);
+}
+
+}  // namespace Vain
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <memory>
+
 #include "core/math/aabb.h"
+#include "core/math/bvh.h"
 
 namespace Vain {
 
+struct OccluderMesh;
+
 class RenderEntity {
   public:
     glm::mat4 model_matrix{1.0};
@@ -11,6 +16,18 @@ class RenderEntity {
     // mesh
     size_t mesh_asset_id{0};
     AxisAlignedBoundingBox aabb{};
+    // aabb transformed by model_matrix, refreshed by updateWorldBoundingBox
+    AxisAlignedBoundingBox world_aabb{};
+    int32_t bvh_proxy{BoundingVolumeHierarchy::k_null_node};
+    // element of RenderScene::instance_entities while the entity is in the scene
+    uint32_t instance_slot{};
+    // proxy for the software occlusion rasterizer, shared by entities of the same mesh
+    std::shared_ptr<const OccluderMesh> occluder{};
+    // tighten the view cull thresholds for this entity, 0 keeps the view ones
+    float min_screen_coverage{0.0f};
+    float max_draw_distance{0.0f};
+    // RenderScene epoch the entity was last added or moved at
+    uint64_t epoch{0};
 
     // material
     size_t material_asset_id{0};
@@ -22,6 +39,8 @@ class RenderEntity {
     float normal_scale{1.0f};
     float occlusion_strength{1.0f};
     glm::vec3 emissive_factor{0.0f, 0.0f, 0.0f};
+
+    void updateWorldBoundingBox();
 };
 
 }  // namespace Vain
\ No newline at end of file
@@ -5,10 +5,15 @@
 #include <assimp/scene.h>
 
 #include <assimp/Importer.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
 
+#include "core/base/thread_pool.h"
 #include "function/global/global_context.h"
 #include "function/render/render_data.h"
 #include "function/render/render_resource.h"
+#include "function/render/software_occlusion.h"
 #include "resource/asset_manager.h"
 
 namespace Vain {
@@ -56,100 +61,140 @@ MeshData processMeshData(aiMesh *mesh, const aiScene *scene) {
         }
     }
 
+    data.occluder = buildOccluderMesh(data);
+
     return data;
 }
 
-std::shared_ptr<GameObjectNode> GameObjectNode::load(
-    const aiNode *node,
-    const aiScene *scene,
-    const std::string &url,
-    RenderScene &render_scene,
-    RenderResource &render_resource,
-    glm::mat4 parent_model
+// one item a chunk, meshes and textures of a model vary too much in size for more
+static void parallelForEach(uint32_t count, const std::function<void(uint32_t)> &func) {
+    auto run_items = [&func](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            func(i);
+        }
+    };
+
+    ThreadPool *thread_pool = g_runtime_global_context.thread_pool.get();
+    if (thread_pool) {
+        thread_pool->parallelFor(count, 1, run_items);
+    } else {
+        run_items(0, count);
+    }
+}
+
+static PBRMaterialDesc processMaterialDesc(
+    const aiMaterial *material, const std::filesystem::path &dir
 ) {
-    auto go_node = std::make_shared<GameObjectNode>();
+    PBRMaterialDesc desc{};
+    if (material->GetTextureCount(aiTextureType_BASE_COLOR)) {
+        aiString file;
+        material->GetTexture(aiTextureType_BASE_COLOR, 0, &file);
+        desc.base_color_file = (dir / file.C_Str()).generic_string();
+    }
+    if (material->GetTextureCount(aiTextureType_UNKNOWN)) {
+        // metallic roughness
+        aiString file;
+        material->GetTexture(aiTextureType_UNKNOWN, 0, &file);
+        desc.metallic_roughness_file = (dir / file.C_Str()).generic_string();
+    }
+    if (material->GetTextureCount(aiTextureType_NORMALS)) {
+        aiString file;
+        material->GetTexture(aiTextureType_NORMALS, 0, &file);
+        desc.normal_file = (dir / file.C_Str()).generic_string();
+    }
+    if (material->GetTextureCount(aiTextureType_AMBIENT_OCCLUSION)) {
+        aiString file;
+        material->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &file);
+        desc.occlusion_file = (dir / file.C_Str()).generic_string();
+    }
+    if (material->GetTextureCount(aiTextureType_EMISSIVE)) {
+        aiString file;
+        material->GetTexture(aiTextureType_EMISSIVE, 0, &file);
+        desc.emissive_file = (dir / file.C_Str()).generic_string();
+    }
+    return desc;
+}
 
+static void importNode(
+    const aiNode *node, glm::mat4 parent_model, ImportedModel::Node &imported_node
+) {
     glm::mat4 local_model;
     for (int i = 0; i < 4; ++i) {
         for (int j = 0; j < 4; ++j) {
             local_model[i][j] = node->mTransformation[j][i];
         }
     }
-    go_node->original_model = parent_model * local_model;
+    imported_node.original_model = parent_model * local_model;
+
+    imported_node.mesh_indices.assign(node->mMeshes, node->mMeshes + node->mNumMeshes);
+
+    imported_node.children.resize(node->mNumChildren);
+    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+        importNode(
+            node->mChildren[i], imported_node.original_model, imported_node.children[i]
+        );
+    }
+}
 
-    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+std::shared_ptr<GameObjectNode> GameObjectNode::instantiate(
+    const ImportedModel::Node &node,
+    const ImportedModel &model,
+    RenderScene &render_scene,
+    RenderResource &render_resource
+) {
+    auto go_node = std::make_shared<GameObjectNode>();
+    go_node->original_model = node.original_model;
+
+    for (uint32_t mesh_index : node.mesh_indices) {
         auto entity = std::make_shared<RenderEntity>();
         entity->model_matrix = go_node->original_model;
 
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        MeshDesc mesh_desc = {url + "::" + mesh->mName.C_Str()};
-        bool mesh_loaded = render_scene.mesh_guid_allocator.hasAsset(mesh_desc);
-        entity->mesh_asset_id = render_scene.mesh_guid_allocator.allocateGuid(mesh_desc);
+        const ImportedModel::Mesh &mesh = model.meshes[mesh_index];
+        bool mesh_loaded = render_scene.mesh_guid_allocator.hasAsset(mesh.desc);
+        entity->mesh_asset_id = render_scene.mesh_guid_allocator.allocateGuid(mesh.desc);
 
         if (!mesh_loaded) {
-            auto mesh_data = processMeshData(mesh, scene);
-            render_resource.uploadMesh(*entity, mesh_data);
-            entity->aabb = mesh_data.aabb;
+            render_resource.uploadMesh(*entity, mesh.data);
+            entity->aabb = mesh.data.aabb;
+            entity->occluder = mesh.data.occluder;
         } else {
-            entity->aabb = render_resource.getEntityMesh(*entity)->aabb;
+            const MeshResource *mesh_resource =
+                render_resource.getEntityMesh(*entity, true);
+            entity->aabb = mesh_resource->aabb;
+            entity->occluder = mesh_resource->occluder;
         }
 
-        aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-        PBRMaterialDesc material_desc{};
-        auto dir = std::filesystem::path{url}.parent_path();
-        if (material->GetTextureCount(aiTextureType_BASE_COLOR)) {
-            aiString file;
-            material->GetTexture(aiTextureType_BASE_COLOR, 0, &file);
-            material_desc.base_color_file = (dir / file.C_Str()).generic_string();
-        }
-        if (material->GetTextureCount(aiTextureType_UNKNOWN)) {
-            // metallic roughness
-            aiString file;
-            material->GetTexture(aiTextureType_UNKNOWN, 0, &file);
-            material_desc.metallic_roughness_file = (dir / file.C_Str()).generic_string();
-        }
-        if (material->GetTextureCount(aiTextureType_NORMALS)) {
-            aiString file;
-            material->GetTexture(aiTextureType_NORMALS, 0, &file);
-            material_desc.normal_file = (dir / file.C_Str()).generic_string();
-        }
-        if (material->GetTextureCount(aiTextureType_AMBIENT_OCCLUSION)) {
-            aiString file;
-            material->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &file);
-            material_desc.occlusion_file = (dir / file.C_Str()).generic_string();
-        }
-        if (material->GetTextureCount(aiTextureType_EMISSIVE)) {
-            aiString file;
-            material->GetTexture(aiTextureType_EMISSIVE, 0, &file);
-            material_desc.emissive_file = (dir / file.C_Str()).generic_string();
-        }
+        const ImportedModel::Material &material = model.materials[mesh.material_index];
         bool material_loaded =
-            render_scene.material_guid_allocator.hasAsset(material_desc);
+            render_scene.material_guid_allocator.hasAsset(material.desc);
         entity->material_asset_id =
-            render_scene.material_guid_allocator.allocateGuid(material_desc);
+            render_scene.material_guid_allocator.allocateGuid(material.desc);
         if (!material_loaded) {
-            PBRMaterialData material_data = loadPBRMaterial(material_desc);
-            render_resource.uploadPBRMaterial(*entity, material_data);
+            render_resource.uploadPBRMaterial(*entity, material.data);
         }
 
-        render_scene.render_entities.insert(entity);
         go_node->entities.push_back(entity);
     }
 
-    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
-        go_node->children.emplace_back(load(
-            node->mChildren[i],
-            scene,
-            url,
-            render_scene,
-            render_resource,
-            go_node->original_model
-        ));
+    for (const ImportedModel::Node &child : node.children) {
+        go_node->children.emplace_back(
+            instantiate(child, model, render_scene, render_resource)
+        );
     }
 
     return go_node;
 }
 
+void GameObjectNode::addToScene(RenderScene &render_scene) {
+    for (auto &entity : entities) {
+        render_scene.addEntity(entity);
+    }
+
+    for (auto &child : children) {
+        child->addToScene(render_scene);
+    }
+}
+
 void GameObjectNode::clone(
     const std::shared_ptr<GameObjectNode> &node, RenderScene &render_scene
 ) {
@@ -158,7 +203,7 @@ void GameObjectNode::clone(
         entities.emplace_back(std::make_shared<RenderEntity>(*entity));
         entities.back()->model_matrix = original_model;
 
-        render_scene.render_entities.insert(entities.back());
+        render_scene.addEntity(entities.back());
     }
 
     for (auto &child : node->children) {
@@ -167,18 +212,25 @@ void GameObjectNode::clone(
     }
 }
 
-void GameObjectNode::updateTransform(glm::mat4 transform) {
+void GameObjectNode::updateTransform(glm::mat4 transform, RenderScene &render_scene) {
+    glm::mat4 model_matrix = transform * original_model;
     for (auto &entity : entities) {
-        entity->model_matrix = transform * original_model;
+        if (entity->model_matrix == model_matrix) {
+            continue;
+        }
+
+        entity->model_matrix = model_matrix;
+        render_scene.updateEntity(*entity);
     }
 
     for (auto &child : children) {
-        updateTransform(transform);
+        child->updateTransform(transform, render_scene);
     }
 }
 
-void GameObject::load(RenderScene &render_scene, RenderResource &render_resource) {
+std::shared_ptr<ImportedModel> GameObject::import(const std::string &url) {
     auto asset_manager = g_runtime_global_context.asset_manager.get();
+    auto start_time = std::chrono::steady_clock::now();
 
     Assimp::Importer importer;
     auto scene = importer.ReadFile(
@@ -189,17 +241,136 @@ void GameObject::load(RenderScene &render_scene, RenderResource &render_resource
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         VAIN_ERROR("failed to load {}: {} ", url, importer.GetErrorString());
+        return nullptr;
+    }
+
+    auto model = std::make_shared<ImportedModel>();
+    model->url = url;
+
+    model->meshes.resize(scene->mNumMeshes);
+    parallelForEach(scene->mNumMeshes, [&](uint32_t i) {
+        aiMesh *mesh = scene->mMeshes[i];
+        model->meshes[i].desc = {url + "::" + mesh->mName.C_Str()};
+        model->meshes[i].data = processMeshData(mesh, scene);
+        model->meshes[i].material_index = mesh->mMaterialIndex;
+    });
+
+    std::vector<bool> material_used(scene->mNumMaterials);
+    for (const ImportedModel::Mesh &mesh : model->meshes) {
+        material_used[mesh.material_index] = true;
+    }
+
+    // every texture is decoded once however many materials sample it, keyed by file
+    // and whether it is srgb
+    using TextureKey = std::pair<std::string, bool>;
+    std::map<TextureKey, std::shared_ptr<TextureData>> textures;
+    auto dir = std::filesystem::path{url}.parent_path();
+    model->materials.resize(scene->mNumMaterials);
+    for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
+        if (!material_used[i]) {
+            continue;
+        }
+
+        // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html
+        model->materials[i].desc = processMaterialDesc(scene->mMaterials[i], dir);
+        const PBRMaterialDesc &desc = model->materials[i].desc;
+        for (const TextureKey &key : {
+                 TextureKey{desc.base_color_file, true},
+                 TextureKey{desc.metallic_roughness_file, false},
+                 TextureKey{desc.normal_file, false},
+                 TextureKey{desc.occlusion_file, false},
+                 TextureKey{desc.emissive_file, true},
+             }) {
+            if (!key.first.empty()) {
+                textures[key];
+            }
+        }
+    }
+
+    std::vector<decltype(textures)::iterator> decodes;
+    for (auto iter = textures.begin(); iter != textures.end(); ++iter) {
+        decodes.push_back(iter);
+    }
+    parallelForEach(static_cast<uint32_t>(decodes.size()), [&decodes](uint32_t i) {
+        auto &[key, data] = *decodes[i];
+        data = loadTexture(key.first, key.second);
+    });
+
+    auto texture = [&textures](const std::string &file, bool is_srgb) {
+        auto iter = textures.find({file, is_srgb});
+        return iter != textures.end() ? iter->second : nullptr;
+    };
+    for (ImportedModel::Material &material : model->materials) {
+        material.data.base_color_texture = texture(material.desc.base_color_file, true);
+        material.data.metallic_roughness_texture =
+            texture(material.desc.metallic_roughness_file, false);
+        material.data.normal_texture = texture(material.desc.normal_file, false);
+        material.data.occlusion_texture = texture(material.desc.occlusion_file, false);
+        material.data.emissive_texture = texture(material.desc.emissive_file, true);
+    }
+
+    importNode(scene->mRootNode, glm::mat4{1.0f}, model->root_node);
+
+    auto import_time = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - start_time
+    );
+    double import_size{};
+    for (const ImportedModel::Mesh &mesh : model->meshes) {
+        import_size += mesh.data.vertices.size() * sizeof(MeshVertex) +
+                       mesh.data.indices.size() * sizeof(uint32_t);
+    }
+    for (auto &[_, data] : textures) {
+        if (data) {
+            import_size += data->width * data->height * 4.0;
+        }
+    }
+    import_size /= 1024.0 * 1024.0;
+    VAIN_INFO(
+        "imported {} in {} ms, {} MiB at {} MiB/s",
+        url,
+        import_time.count(),
+        import_size,
+        import_size / (import_time.count() / 1000.0)
+    );
+
+    return model;
+}
+
+void GameObject::load(RenderScene &render_scene, RenderResource &render_resource) {
+    std::shared_ptr<ImportedModel> model = import(url);
+    if (!model) {
         return;
     }
 
-    root_node = GameObjectNode::load(
-        scene->mRootNode, scene, url, render_scene, render_resource, m_transform.matrix()
+    instantiate(*model, render_scene, render_resource);
+    show();
+}
+
+void GameObject::instantiate(
+    const ImportedModel &model,
+    RenderScene &render_scene,
+    RenderResource &render_resource
+) {
+    url = model.url;
+    root_node = GameObjectNode::instantiate(
+        model.root_node, model, render_scene, render_resource
+    );
+
+    VAIN_INFO(
+        "instantiated {}, {} MiB waiting for upload",
+        url,
+        render_resource.uploadBatcher().pendingBytes() / (1024.0 * 1024.0)
     );
 
     go_id = ObjectIDAllocator::alloc();
+    m_render_scene = &render_scene;
     m_loaded = true;
 }
 
+void GameObject::show() {
+    root_node->addToScene(*m_render_scene);
+}
+
 void GameObject::clone(const GameObject &gobject, RenderScene &render_scene) {
     if (!gobject.loaded()) {
         return;
@@ -211,12 +382,13 @@ void GameObject::clone(const GameObject &gobject, RenderScene &render_scene) {
     root_node->clone(gobject.root_node, render_scene);
 
     go_id = ObjectIDAllocator::alloc();
+    m_render_scene = &render_scene;
     m_loaded = true;
 }
 
 void GameObject::updateTransform(Transform transform) {
     m_transform = transform;
-    root_node->updateTransform(m_transform.matrix());
+    root_node->updateTransform(m_transform.matrix(), *m_render_scene);
 }
 
 }  // namespace Vain
\ No newline at end of file
@@ -4,34 +4,60 @@
 
 #include "core/math/transform.h"
 #include "function/framework/object_id.h"
+#include "function/render/render_data.h"
 #include "function/render/render_scene.h"
 #include "resource/asset_type.h"
 
-struct aiNode;
-struct aiScene;
-
 namespace Vain {
 
 class RenderScene;
 class RenderResource;
 
+// a model read and decoded without touching the scene or the device, so off the render
+// thread. meshes and materials are indexed like those of the assimp scene
+struct ImportedModel {
+    struct Mesh {
+        MeshDesc desc{};
+        MeshData data{};
+        uint32_t material_index{};
+    };
+
+    struct Material {
+        PBRMaterialDesc desc{};
+        // only decoded when some mesh uses the material
+        PBRMaterialData data{};
+    };
+
+    struct Node {
+        glm::mat4 original_model{};
+        std::vector<uint32_t> mesh_indices{};
+        std::vector<Node> children{};
+    };
+
+    std::string url{};
+    std::vector<Mesh> meshes{};
+    std::vector<Material> materials{};
+    Node root_node{};
+};
+
 struct GameObjectNode {
     glm::mat4 original_model{};
     std::vector<std::shared_ptr<RenderEntity>> entities{};
     std::vector<std::shared_ptr<GameObjectNode>> children{};
 
-    static std::shared_ptr<GameObjectNode> load(
-        const aiNode *node,
-        const aiScene *scene,
-        const std::string &file,
+    // uploads the assets not loaded yet, the entities are left out of the scene
+    static std::shared_ptr<GameObjectNode> instantiate(
+        const ImportedModel::Node &node,
+        const ImportedModel &model,
         RenderScene &render_scene,
-        RenderResource &render_resource,
-        glm::mat4 parent_model
+        RenderResource &render_resource
     );
 
+    void addToScene(RenderScene &render_scene);
+
     void clone(const std::shared_ptr<GameObjectNode> &node, RenderScene &render_scene);
 
-    void updateTransform(glm::mat4 transform);
+    void updateTransform(glm::mat4 transform, RenderScene &render_scene);
 };
 
 class GameObject {
@@ -41,7 +67,18 @@ class GameObject {
     GObjectID go_id{k_invalid_go_id};
     std::shared_ptr<GameObjectNode> root_node{};
 
+    // safe on any thread, null when the model can't be read
+    static std::shared_ptr<ImportedModel> import(const std::string &url);
+
     void load(RenderScene &render_scene, RenderResource &render_resource);
+    // the render thread half of load, the entities join the scene on show, which may
+    // wait until their uploads completed
+    void instantiate(
+        const ImportedModel &model,
+        RenderScene &render_scene,
+        RenderResource &render_resource
+    );
+    void show();
 
     void clone(const GameObject &gobject, RenderScene &render_scene);
 
@@ -53,6 +90,7 @@ class GameObject {
   private:
     bool m_loaded{};
     Transform m_transform{};
+    RenderScene *m_render_scene{};
 };
 
 }  // namespace Vain
\ No newline at end of file
@@ -1,7 +1,18 @@
 #include "render_pass.h"
 
+#include <assert.h>
+
+#include <algorithm>
+
+#include "core/base/macro.h"
+#include "core/base/thread_pool.h"
+#include "function/global/global_context.h"
+
 namespace Vain {
 
+// below this a worker costs more to wake up than it saves
+static constexpr uint32_t k_min_recording_chunk_draw_count = 256;
+
 RenderPass::~RenderPass() { clear(); }
 
 void RenderPass::initialize(RenderPassInitInfo *init_info) {
@@ -11,4 +22,168 @@ void RenderPass::initialize(RenderPassInitInfo *init_info) {
 
 void RenderPass::clear() {}
 
+void RenderPass::bindMeshBuffers(
+    VkCommandBuffer command_buffer,
+    const MeshResource &mesh,
+    MeshBufferBinding &binding
+) const {
+    if (mesh.vertex_buffer != binding.vertex_buffer) {
+        VkDeviceSize offset = 0;
+        m_ctx->cmdBindVertexBuffers(command_buffer, 0, 1, &mesh.vertex_buffer, &offset);
+        binding.vertex_buffer = mesh.vertex_buffer;
+    }
+    if (mesh.index_buffer != binding.index_buffer) {
+        m_ctx->cmdBindIndexBuffer(
+            command_buffer, mesh.index_buffer, 0, VK_INDEX_TYPE_UINT32
+        );
+        binding.index_buffer = mesh.index_buffer;
+    }
+}
+
+void RenderPass::drawIndirect(VkCommandBuffer command_buffer, uint32_t view) const {
+    const GpuScene &gpu_scene = m_res->gpu_scene;
+
+    VkDeviceSize command_size = sizeof(VkDrawIndexedIndirectCommand);
+    VkDeviceSize view_offset =
+        VkDeviceSize{view} * gpu_scene.meshCapacity() * command_size;
+    for (const GpuScene::DrawGroup &group : gpu_scene.drawGroups()) {
+        VkDeviceSize offset = 0;
+        m_ctx->cmdBindVertexBuffers(command_buffer, 0, 1, &group.vertex_buffer, &offset);
+        m_ctx->cmdBindIndexBuffer(
+            command_buffer, group.index_buffer, 0, VK_INDEX_TYPE_UINT32
+        );
+
+        // commands of meshes no instance passed keep an instance count of zero
+        m_ctx->cmdDrawIndexedIndirect(
+            command_buffer,
+            gpu_scene.commandBuffer(),
+            view_offset + group.first_command * command_size,
+            group.command_count,
+            command_size
+        );
+    }
+}
+
+void RenderPass::updateInstanceTableDescriptor(VkDescriptorSet set, uint32_t binding) {
+    if (m_instance_table_version == m_res->gpu_scene.version()) {
+        return;
+    }
+    m_instance_table_version = m_res->gpu_scene.version();
+
+    VkDescriptorBufferInfo buffer_info{};
+    buffer_info.buffer = m_res->gpu_scene.instanceBuffer();
+    buffer_info.offset = 0;
+    buffer_info.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &buffer_info;
+
+    vkUpdateDescriptorSets(m_ctx->device, 1, &write, 0, nullptr);
+}
+
+uint32_t RenderPass::recordingChunkCount(uint32_t draw_count) {
+    ThreadPool *thread_pool = g_runtime_global_context.thread_pool.get();
+    uint32_t thread_count = thread_pool ? thread_pool->threadCount() + 1 : 1;
+
+    uint32_t chunk_count =
+        std::min(thread_count, VulkanContext::k_max_recording_thread_count);
+    chunk_count = std::min(chunk_count, draw_count / k_min_recording_chunk_draw_count);
+
+    return std::max(chunk_count, 1u);
+}
+
+void RenderPass::recordSecondaryCommandBuffers(
+    uint32_t chunk_count,
+    uint32_t subpass,
+    VkFramebuffer framebuffer,
+    const std::function<void(VkCommandBuffer command_buffer, uint32_t chunk)> &record
+) {
+    VkCommandBuffer command_buffers[VulkanContext::k_max_recording_thread_count];
+    recordChunks(chunk_count, subpass, framebuffer, record, command_buffers, false);
+
+    m_ctx->cmdExecuteCommands(
+        m_ctx->currentCommandBuffer(), chunk_count, command_buffers
+    );
+}
+
+bool RenderPass::executeCachedRecording(
+    const CachedRecording &recording, const RecordingKey &key
+) {
+    if (!recording.recorded || recording.key != key) {
+        return false;
+    }
+
+    m_ctx->cmdExecuteCommands(
+        m_ctx->currentCommandBuffer(), recording.chunk_count, recording.command_buffers
+    );
+    return true;
+}
+
+void RenderPass::recordCachedSecondaryCommandBuffers(
+    CachedRecording &recording,
+    const RecordingKey &key,
+    uint32_t chunk_count,
+    uint32_t subpass,
+    VkFramebuffer framebuffer,
+    const std::function<void(VkCommandBuffer command_buffer, uint32_t chunk)> &record
+) {
+    recordChunks(
+        chunk_count, subpass, framebuffer, record, recording.command_buffers, true
+    );
+    recording.recorded = true;
+    recording.key = key;
+    recording.chunk_count = chunk_count;
+
+    m_ctx->cmdExecuteCommands(
+        m_ctx->currentCommandBuffer(), chunk_count, recording.command_buffers
+    );
+}
+
+void RenderPass::recordChunks(
+    uint32_t chunk_count,
+    uint32_t subpass,
+    VkFramebuffer framebuffer,
+    const std::function<void(VkCommandBuffer command_buffer, uint32_t chunk)> &record,
+    VkCommandBuffer *command_buffers,
+    bool cached
+) {
+    assert(0 < chunk_count && chunk_count <= VulkanContext::k_max_recording_thread_count);
+
+    // a chunk only runs on one thread, so it owns the secondary pool of its index
+    auto record_chunks = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; ++chunk) {
+            VkCommandBuffer command_buffer{};
+            if (cached) {
+                command_buffer = command_buffers[chunk];
+                m_ctx->beginCachedSecondaryCommandBuffer(
+                    chunk, command_buffer, render_pass, subpass, framebuffer
+                );
+            } else {
+                command_buffer = m_ctx->beginSecondaryCommandBuffer(
+                    chunk, render_pass, subpass, framebuffer
+                );
+            }
+
+            record(command_buffer, chunk);
+
+            if (m_ctx->endCommandBuffer(command_buffer) != VK_SUCCESS) {
+                VAIN_ERROR("failed to end secondary command buffer");
+            }
+            command_buffers[chunk] = command_buffer;
+        }
+    };
+
+    ThreadPool *thread_pool = g_runtime_global_context.thread_pool.get();
+    if (thread_pool && chunk_count > 1) {
+        thread_pool->parallelFor(chunk_count, 1, record_chunks);
+    } else {
+        record_chunks(0, chunk_count);
+    }
+}
+
 }  // namespace Vain
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "core/vulkan/vulkan_context.h"
 #include "function/render/render_resource.h"
 
@@ -65,8 +67,97 @@ class RenderPass {
     virtual void clear();
 
   protected:
+    // geometry arena blocks bound in a command buffer, meshes sharing a block only
+    // differ in their draw offsets
+    struct MeshBufferBinding {
+        VkBuffer vertex_buffer{};
+        VkBuffer index_buffer{};
+    };
+
+    // what a cached recording depends on besides the pass itself
+    struct RecordingKey {
+        uint64_t nodes_version{};
+        uint64_t draw_groups_version{};
+        uint64_t instance_table_version{};
+        uint64_t ring_buffer_version{};
+        bool gpu_driven_culling{};
+
+        bool operator==(const RecordingKey &other) const {
+            return nodes_version == other.nodes_version &&
+                   draw_groups_version == other.draw_groups_version &&
+                   instance_table_version == other.instance_table_version &&
+                   ring_buffer_version == other.ring_buffer_version &&
+                   gpu_driven_culling == other.gpu_driven_culling;
+        }
+        bool operator!=(const RecordingKey &other) const { return !(*this == other); }
+    };
+
+    // secondary command buffers of one frame slot kept across frames, everything they
+    // read has to stay in place until they are recorded again
+    struct CachedRecording {
+        bool recorded{false};
+        RecordingKey key{};
+        uint32_t chunk_count{};
+        VkCommandBuffer command_buffers[VulkanContext::k_max_recording_thread_count]{};
+    };
+
     VulkanContext *m_ctx{};
     RenderResource *m_res{};
+    // gpu scene version the instance table descriptor was written at
+    uint64_t m_instance_table_version{};
+
+    void bindMeshBuffers(
+        VkCommandBuffer command_buffer,
+        const MeshResource &mesh,
+        MeshBufferBinding &binding
+    ) const;
+
+    // records the indirect draws the gpu cull pass wrote for view, one call per draw
+    // group, the pipeline and descriptor sets must be bound
+    void drawIndirect(VkCommandBuffer command_buffer, uint32_t view) const;
+
+    // points binding of set at the gpu scene instance table again once the table was
+    // recreated, call before recording
+    void updateInstanceTableDescriptor(VkDescriptorSet set, uint32_t binding);
+
+    // how many secondary command buffers draw_count draws are worth splitting into
+    static uint32_t recordingChunkCount(uint32_t draw_count);
+
+    // records one secondary command buffer per chunk on the thread pool, then executes
+    // them in chunk order in the current command buffer, which must be inside subpass
+    // begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    void recordSecondaryCommandBuffers(
+        uint32_t chunk_count,
+        uint32_t subpass,
+        VkFramebuffer framebuffer,
+        const std::function<void(VkCommandBuffer command_buffer, uint32_t chunk)> &record
+    );
+
+    // executes the command buffers kept in recording if they were recorded with key,
+    // otherwise returns false and they have to be recorded again
+    bool executeCachedRecording(
+        const CachedRecording &recording, const RecordingKey &key
+    );
+    // like recordSecondaryCommandBuffers, but into the command buffers of recording,
+    // which must not be pending any more
+    void recordCachedSecondaryCommandBuffers(
+        CachedRecording &recording,
+        const RecordingKey &key,
+        uint32_t chunk_count,
+        uint32_t subpass,
+        VkFramebuffer framebuffer,
+        const std::function<void(VkCommandBuffer command_buffer, uint32_t chunk)> &record
+    );
+
+  private:
+    void recordChunks(
+        uint32_t chunk_count,
+        uint32_t subpass,
+        VkFramebuffer framebuffer,
+        const std::function<void(VkCommandBuffer command_buffer, uint32_t chunk)> &record,
+        VkCommandBuffer *command_buffers,
+        bool cached
+    );
 };
 
 }  // namespace Vain
\ No newline at end of file
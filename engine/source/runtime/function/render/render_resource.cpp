@@ -1,5 +1,8 @@
 #include "render_resource.h"
 
+#include <assert.h>
+
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
@@ -10,28 +13,62 @@
 
 namespace Vain {
 
+const RenderResource::TextureKey RenderResource::k_default_white_srgb_texture{
+    "<white>", VK_FORMAT_R8G8B8A8_SRGB
+};
+const RenderResource::TextureKey RenderResource::k_default_white_texture{
+    "<white>", VK_FORMAT_R8G8B8A8_UNORM
+};
+const RenderResource::TextureKey RenderResource::k_default_normal_texture{
+    "<normal>", VK_FORMAT_R8G8B8A8_UNORM
+};
+
 RenderResource::~RenderResource() { clear(); }
 
-void RenderResource::initialize(VulkanContext *ctx) { m_ctx = ctx; }
+void RenderResource::initialize(VulkanContext *ctx) {
+    m_ctx = ctx;
+
+    m_vertex_arena.initialize(
+        m_ctx,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        sizeof(MeshVertex),
+        k_geometry_arena_block_size / sizeof(MeshVertex)
+    );
+    m_index_arena.initialize(
+        m_ctx,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        sizeof(uint32_t),
+        k_geometry_arena_block_size / sizeof(uint32_t)
+    );
+
+    gpu_scene.initialize(m_ctx, this);
+
+    queryStorageBufferLimits();
+    const StorageBuffer &storage_buffer = global_render_resource.storage_buffer;
+    frame_upload_buffer.initialize(
+        m_ctx,
+        storage_buffer.min_storage_buffer_offset_alignment,
+        storage_buffer.max_storage_buffer_range
+    );
+}
 
 void RenderResource::clear() {
+    // the uploads in flight complete into the maps cleared below
+    m_ctx->upload_batcher.flush();
+
     clearMesh();
+    gpu_scene.clear();
+    m_vertex_arena.clear();
+    m_index_arena.clear();
 
     clearMaterial();
+    vmaDestroyBuffer(
+        m_ctx->assets_allocator, m_materials_buffer, m_materials_buffer_allocation
+    );
 
     freeIBLResource();
 
-    // destroy storage buffer
-    vkDestroyBuffer(
-        m_ctx->device,
-        global_render_resource.storage_buffer.global_upload_ringbuffer,
-        nullptr
-    );
-    vkFreeMemory(
-        m_ctx->device,
-        global_render_resource.storage_buffer.global_upload_ringbuffer_memory,
-        nullptr
-    );
+    frame_upload_buffer.clear();
 }
 
 void RenderResource::updatePerFrame(
@@ -42,7 +79,9 @@ void RenderResource::updatePerFrame(
     glm::vec3 ambient_light = {
         scene.ambient_light.r, scene.ambient_light.g, scene.ambient_light.b
     };
-    uint32_t point_light_num = static_cast<uint32_t>(scene.point_lights.size());
+    uint32_t point_light_num = std::min(
+        static_cast<uint32_t>(scene.point_lights.size()), k_max_point_light_count
+    );
 
     mesh_per_frame_storage_buffer_object.proj_view_matrix = proj_view_matrix;
     mesh_per_frame_storage_buffer_object.camera_position = camera.position;
@@ -74,21 +113,9 @@ void RenderResource::updatePerFrame(
 void RenderResource::uploadGlobalRenderResource(const IBLDesc &ibl_desc) {
     if (m_global_uploaded) {
         freeIBLResource();
-        vkDestroyBuffer(
-            m_ctx->device,
-            global_render_resource.storage_buffer.global_upload_ringbuffer,
-            nullptr
-        );
-        vkFreeMemory(
-            m_ctx->device,
-            global_render_resource.storage_buffer.global_upload_ringbuffer_memory,
-            nullptr
-        );
         m_global_uploaded = false;
     }
 
-    createAndMapStorageBuffer();
-
     std::shared_ptr<TextureData> brdf_map = loadTextureHDR(ibl_desc.brdf_map);
 
     const SkyBoxDesc &skybox_irradiance_map = ibl_desc.skybox_irradiance_map;
@@ -152,6 +179,9 @@ void RenderResource::uploadGlobalRenderResource(const IBLDesc &ibl_desc) {
 
     createIBLTextures(irradiance_maps, specular_maps);
 
+    // the passes bind the ibl textures from the first frame on
+    m_ctx->upload_batcher.flush();
+
     m_global_uploaded = true;
 }
 
@@ -175,11 +205,18 @@ void RenderResource::uploadMesh(const RenderEntity &entity, const MeshData &data
     mesh.index_count = data.indices.size();
     mesh.vertex_count = data.vertices.size();
     mesh.aabb = data.aabb;
+    mesh.occluder = data.occluder;
 
-    uploadVertexBuffer(
-        mesh, data.vertices.data(), mesh.vertex_count * sizeof(MeshVertex)
-    );
-    uploadIndexBuffer(mesh, data.indices.data(), mesh.index_count * sizeof(uint32_t));
+    uploadVertexBuffer(mesh, data.vertices.data());
+    uploadIndexBuffer(mesh, data.indices.data());
+
+    mesh.draw_index = gpu_scene.addMesh(mesh);
+
+    m_pending_meshes.insert(asset_id);
+    m_ctx->upload_batcher.enqueueCompletion([this, asset_id]() {
+        m_pending_meshes.erase(asset_id);
+        m_completed_meshes.insert(asset_id);
+    });
 }
 
 void RenderResource::uploadPBRMaterial(
@@ -193,224 +230,115 @@ void RenderResource::uploadPBRMaterial(
     m_material_map[asset_id] = {};
     auto &material = m_material_map[asset_id];
 
-    float empty_image[] = {1.0f, 1.0f, 1.0f, 1.0f};
-
-    void *base_color_image_pixels = empty_image;
-    uint32_t base_color_image_width = 1;
-    uint32_t base_color_image_height = 1;
-    VkFormat base_color_image_format = VK_FORMAT_R8G8B8A8_SRGB;
-    if (data.base_color_texture) {
-        base_color_image_pixels = data.base_color_texture->pixels;
-        base_color_image_width = data.base_color_texture->width;
-        base_color_image_height = data.base_color_texture->height;
-        base_color_image_format = data.base_color_texture->format;
-    }
-
-    void *metallic_roughness_image_pixels = empty_image;
-    uint32_t metallic_roughness_image_width = 1;
-    uint32_t metallic_roughness_image_height = 1;
-    VkFormat metallic_roughness_image_format = VK_FORMAT_R8G8B8A8_UNORM;
-    if (data.metallic_roughness_texture) {
-        metallic_roughness_image_pixels = data.metallic_roughness_texture->pixels;
-        metallic_roughness_image_width = data.metallic_roughness_texture->width;
-        metallic_roughness_image_height = data.metallic_roughness_texture->height;
-        metallic_roughness_image_format = data.metallic_roughness_texture->format;
-    }
+    // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html
+    material.base_color_texture =
+        acquireTexture(data.base_color_texture, k_default_white_srgb_texture);
+    material.metallic_roughness_texture =
+        acquireTexture(data.metallic_roughness_texture, k_default_white_texture);
+    material.normal_texture =
+        acquireTexture(data.normal_texture, k_default_normal_texture);
+    material.occlusion_texture =
+        acquireTexture(data.occlusion_texture, k_default_white_texture);
+    material.emissive_texture =
+        acquireTexture(data.emissive_texture, k_default_white_srgb_texture);
+
+    MeshMaterial material_data{};
+    material_data.base_color_factor = entity.base_color_factor;
+    material_data.metallic_factor = entity.metallic_factor;
+    material_data.roughness_factor = entity.roughness_factor;
+    material_data.normal_scale = entity.normal_scale;
+    material_data.occlusion_strength = entity.occlusion_strength;
+    material_data.emissive_factor = entity.emissive_factor;
+    material_data.is_blend = entity.blend;
+    material_data.is_double_sided = entity.double_sided;
+
+    material_data.base_color_texture_index = material.base_color_texture;
+    material_data.metallic_roughness_texture_index = material.metallic_roughness_texture;
+    material_data.normal_texture_index = material.normal_texture;
+    material_data.occlusion_texture_index = material.occlusion_texture;
+    material_data.emissive_texture_index = material.emissive_texture;
+
+    material.material_index = addMaterial(material_data);
+
+    m_pending_materials.insert(asset_id);
+    m_ctx->upload_batcher.enqueueCompletion([this, asset_id]() {
+        m_pending_materials.erase(asset_id);
+        m_completed_materials.insert(asset_id);
+    });
+}
 
-    void *normal_image_pixels = empty_image;
-    uint32_t normal_image_width = 1;
-    uint32_t normal_image_height = 1;
-    VkFormat normal_image_format = VK_FORMAT_R8G8B8A8_UNORM;
-    if (data.normal_texture) {
-        normal_image_pixels = data.normal_texture->pixels;
-        normal_image_width = data.normal_texture->width;
-        normal_image_height = data.normal_texture->height;
-        normal_image_format = data.normal_texture->format;
-    }
+void RenderResource::createMaterialsDescriptorSet(VkDescriptorSetLayout layout) {
+    uint32_t texture_count = m_ctx->bindless_texture_count;
 
-    void *occlusion_image_pixels = empty_image;
-    uint32_t occlusion_image_width = 1;
-    uint32_t occlusion_image_height = 1;
-    VkFormat occlusion_image_format = VK_FORMAT_R8G8B8A8_UNORM;
-    if (data.occlusion_texture) {
-        occlusion_image_pixels = data.occlusion_texture->pixels;
-        occlusion_image_width = data.occlusion_texture->width;
-        occlusion_image_height = data.occlusion_texture->height;
-        occlusion_image_format = data.occlusion_texture->format;
-    }
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info{};
+    variable_count_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    variable_count_info.descriptorSetCount = 1;
+    variable_count_info.pDescriptorCounts = &texture_count;
 
-    void *emissive_image_pixels = empty_image;
-    uint32_t emissive_image_width = 1;
-    uint32_t emissive_image_height = 1;
-    VkFormat emissive_image_format = VK_FORMAT_R8G8B8A8_SRGB;
-    if (data.emissive_texture) {
-        emissive_image_pixels = data.emissive_texture->pixels;
-        emissive_image_width = data.emissive_texture->width;
-        emissive_image_height = data.emissive_texture->height;
-        emissive_image_format = data.emissive_texture->format;
+    VkDescriptorSetAllocateInfo materials_descriptor_set_alloc_info{};
+    materials_descriptor_set_alloc_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    materials_descriptor_set_alloc_info.pNext = &variable_count_info;
+    materials_descriptor_set_alloc_info.descriptorPool = m_ctx->bindless_descriptor_pool;
+    materials_descriptor_set_alloc_info.descriptorSetCount = 1;
+    materials_descriptor_set_alloc_info.pSetLayouts = &layout;
+    if (vkAllocateDescriptorSets(
+            m_ctx->device, &materials_descriptor_set_alloc_info, &materials_descriptor_set
+        ) != VK_SUCCESS) {
+        VAIN_ERROR("failed to allocate materials descriptor set");
     }
 
-    uploadMaterialUniformBuffer(material, entity);
-
-    createTexture(
-        m_ctx,
-        base_color_image_width,
-        base_color_image_height,
-        base_color_image_pixels,
-        base_color_image_format,
-        0,
-        material.base_color_texture_image,
-        material.base_color_image_view,
-        material.base_color_image_allocation
-    );
+    growMaterialsBuffer(k_initial_material_capacity);
 
-    createTexture(
-        m_ctx,
-        normal_image_width,
-        normal_image_height,
-        normal_image_pixels,
-        normal_image_format,
-        0,
-        material.normal_texture_image,
-        material.normal_image_view,
-        material.normal_image_allocation
-    );
+    createDefaultTextures();
+}
 
-    createTexture(
-        m_ctx,
-        metallic_roughness_image_width,
-        metallic_roughness_image_height,
-        metallic_roughness_image_pixels,
-        metallic_roughness_image_format,
-        0,
-        material.metallic_texture_image,
-        material.metallic_image_view,
-        material.metallic_image_allocation
-    );
+void RenderResource::beginRingBufferFrame(VkDeviceSize reserve_size) {
+    frame_upload_buffer.beginFrame(reserve_size);
+}
 
-    createTexture(
-        m_ctx,
-        occlusion_image_width,
-        occlusion_image_height,
-        occlusion_image_pixels,
-        occlusion_image_format,
-        0,
-        material.occlusion_texture_image,
-        material.occlusion_image_view,
-        material.occlusion_image_allocation
-    );
+uint32_t RenderResource::allocateRingBuffer(uint32_t size) {
+    return frame_upload_buffer.allocate(size);
+}
 
-    createTexture(
-        m_ctx,
-        emissive_image_width,
-        emissive_image_height,
-        emissive_image_pixels,
-        emissive_image_format,
-        0,
-        material.emissive_texture_image,
-        material.emissive_image_view,
-        material.emissive_image_allocation
-    );
+void *RenderResource::getRingBufferPointer(uint32_t offset) const {
+    return frame_upload_buffer.pointer(offset);
+}
 
-    VkDescriptorSetAllocateInfo material_descriptor_set_alloc_info{};
-    material_descriptor_set_alloc_info.sType =
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    material_descriptor_set_alloc_info.descriptorPool = m_ctx->descriptor_pool;
-    material_descriptor_set_alloc_info.descriptorSetCount = 1;
-    material_descriptor_set_alloc_info.pSetLayouts = &material_descriptor_set_layout;
-    vkAllocateDescriptorSets(
-        m_ctx->device,
-        &material_descriptor_set_alloc_info,
-        &material.material_descriptor_set
-    );
+uint32_t RenderResource::allocateInstanceIndices(uint32_t count, uint32_t stride) {
+    uint32_t element_size = stride * sizeof(uint32_t);
+    // over reserve by one element so the start can be moved to an element boundary
+    uint32_t offset = allocateRingBuffer((count + 1) * element_size);
+    if (offset == FrameUploadBuffer::k_invalid_offset) {
+        return FrameUploadBuffer::k_invalid_offset;
+    }
+    return (offset + element_size - 1) / element_size;
+}
 
-    VkDescriptorBufferInfo material_uniform_buffer_info = {};
-    material_uniform_buffer_info.offset = 0;
-    material_uniform_buffer_info.range = sizeof(MeshPerMaterialUniformBufferObject);
-    material_uniform_buffer_info.buffer = material.material_uniform_buffer;
-
-    VkDescriptorImageInfo base_color_image_info = {};
-    base_color_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    base_color_image_info.imageView = material.base_color_image_view;
-    base_color_image_info.sampler =
-        m_ctx->getOrCreateMipmapSampler(base_color_image_width, base_color_image_height);
-
-    VkDescriptorImageInfo metallic_roughness_image_info{};
-    metallic_roughness_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    metallic_roughness_image_info.imageView = material.metallic_image_view;
-    metallic_roughness_image_info.sampler = m_ctx->getOrCreateMipmapSampler(
-        metallic_roughness_image_width, metallic_roughness_image_height
+uint32_t *RenderResource::getInstanceIndexPointer(uint32_t index, uint32_t stride) const {
+    return static_cast<uint32_t *>(
+        getRingBufferPointer(index * stride * sizeof(uint32_t))
     );
+}
 
-    VkDescriptorImageInfo normal_image_info{};
-    normal_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    normal_image_info.imageView = material.normal_image_view;
-    normal_image_info.sampler =
-        m_ctx->getOrCreateMipmapSampler(normal_image_width, normal_image_height);
-
-    VkDescriptorImageInfo occlusion_image_info{};
-    occlusion_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    occlusion_image_info.imageView = material.occlusion_image_view;
-    occlusion_image_info.sampler =
-        m_ctx->getOrCreateMipmapSampler(occlusion_image_width, occlusion_image_height);
-
-    VkDescriptorImageInfo emissive_image_info{};
-    emissive_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    emissive_image_info.imageView = material.emissive_image_view;
-    emissive_image_info.sampler =
-        m_ctx->getOrCreateMipmapSampler(emissive_image_width, emissive_image_height);
-
-    VkWriteDescriptorSet material_descriptor_writes[6]{};
-
-    material_descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    material_descriptor_writes[0].dstSet = material.material_descriptor_set;
-    material_descriptor_writes[0].dstBinding = 0;
-    material_descriptor_writes[0].dstArrayElement = 0;
-    material_descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    material_descriptor_writes[0].descriptorCount = 1;
-    material_descriptor_writes[0].pBufferInfo = &material_uniform_buffer_info;
-
-    material_descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    material_descriptor_writes[1].dstSet = material.material_descriptor_set;
-    material_descriptor_writes[1].dstBinding = 1;
-    material_descriptor_writes[1].dstArrayElement = 0;
-    material_descriptor_writes[1].descriptorType =
-        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    material_descriptor_writes[1].descriptorCount = 1;
-    material_descriptor_writes[1].pImageInfo = &base_color_image_info;
-
-    material_descriptor_writes[2] = material_descriptor_writes[1];
-    material_descriptor_writes[2].dstBinding = 2;
-    material_descriptor_writes[2].pImageInfo = &metallic_roughness_image_info;
-
-    material_descriptor_writes[3] = material_descriptor_writes[1];
-    material_descriptor_writes[3].dstBinding = 3;
-    material_descriptor_writes[3].pImageInfo = &normal_image_info;
-
-    material_descriptor_writes[4] = material_descriptor_writes[1];
-    material_descriptor_writes[4].dstBinding = 4;
-    material_descriptor_writes[4].pImageInfo = &occlusion_image_info;
-
-    material_descriptor_writes[5] = material_descriptor_writes[1];
-    material_descriptor_writes[5].dstBinding = 5;
-    material_descriptor_writes[5].pImageInfo = &emissive_image_info;
-
-    vkUpdateDescriptorSets(
-        m_ctx->device,
-        ARRAY_SIZE(material_descriptor_writes),
-        material_descriptor_writes,
-        0,
-        nullptr
-    );
+VkDeviceSize RenderResource::ringBufferAllocationSize(uint32_t size) const {
+    return frame_upload_buffer.allocationSize(size);
 }
 
-void RenderResource::resetRingBufferOffset() {
-    StorageBuffer &storage_buffer = global_render_resource.storage_buffer;
-    storage_buffer.global_upload_ringbuffers_end[m_ctx->currentFrameIndex()] =
-        storage_buffer.global_upload_ringbuffers_begin[m_ctx->currentFrameIndex()];
+VkDeviceSize RenderResource::instanceIndicesAllocationSize(
+    uint32_t count, uint32_t stride
+) const {
+    return ringBufferAllocationSize((count + 1) * stride * sizeof(uint32_t));
 }
 
-const MeshResource *RenderResource::getEntityMesh(const RenderEntity &entity) const {
+const MeshResource *RenderResource::getEntityMesh(
+    const RenderEntity &entity, bool include_pending
+) const {
+    if (!include_pending && m_pending_meshes.count(entity.mesh_asset_id)) {
+        return nullptr;
+    }
+
     auto it = m_mesh_map.find(entity.mesh_asset_id);
     if (it != m_mesh_map.end()) {
         return &it->second;
@@ -421,6 +349,10 @@ const MeshResource *RenderResource::getEntityMesh(const RenderEntity &entity) co
 
 const PBRMaterialResource *RenderResource::getEntityMaterial(const RenderEntity &entity
 ) const {
+    if (m_pending_materials.count(entity.material_asset_id)) {
+        return nullptr;
+    }
+
     auto it = m_material_map.find(entity.material_asset_id);
     if (it != m_material_map.end()) {
         return &it->second;
@@ -429,6 +361,19 @@ const PBRMaterialResource *RenderResource::getEntityMaterial(const RenderEntity
     }
 }
 
+void RenderResource::updateUploads(VkCommandBuffer command_buffer) {
+    m_completed_meshes.clear();
+    m_completed_materials.clear();
+
+    m_ctx->upload_batcher.update(command_buffer);
+}
+
+bool RenderResource::entityUploadCompleted(const RenderEntity &entity) const {
+    return (m_completed_meshes.count(entity.mesh_asset_id) ||
+            m_completed_materials.count(entity.material_asset_id)) &&
+           entityResident(entity);
+}
+
 void RenderResource::clearMesh() {
     for (auto &[_, mesh] : m_mesh_map) {
         freeMeshResource(mesh);
@@ -439,10 +384,19 @@ void RenderResource::clearMaterial() {
     for (auto &[_, material] : m_material_map) {
         freePBRMaterialResource(material);
     }
+
+    const TextureKey *default_keys[] = {
+        &k_default_white_srgb_texture, &k_default_white_texture, &k_default_normal_texture
+    };
+    for (const TextureKey *key : default_keys) {
+        auto iter = m_texture_cache.find(*key);
+        if (iter != m_texture_cache.end()) {
+            releaseTexture(iter->second);
+        }
+    }
 }
 
-void RenderResource::createAndMapStorageBuffer() {
-    uint32_t frames_in_flight = m_ctx->k_max_frames_in_flight;
+void RenderResource::queryStorageBufferLimits() {
     StorageBuffer &storage_buffer = global_render_resource.storage_buffer;
 
     VkPhysicalDeviceProperties properties{};
@@ -454,46 +408,6 @@ void RenderResource::createAndMapStorageBuffer() {
         properties.limits.minStorageBufferOffsetAlignment;
     storage_buffer.max_storage_buffer_range = properties.limits.maxStorageBufferRange;
     storage_buffer.non_coherent_atom_size = properties.limits.nonCoherentAtomSize;
-
-    VkDeviceSize global_storage_buffer_size = 1024 * 1024 * 128;
-    if (storage_buffer.global_upload_ringbuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_ctx->device, storage_buffer.global_upload_ringbuffer, nullptr);
-        vkFreeMemory(
-            m_ctx->device, storage_buffer.global_upload_ringbuffer_memory, nullptr
-        );
-    }
-    createBuffer(
-        m_ctx->physical_device,
-        m_ctx->device,
-        global_storage_buffer_size,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        storage_buffer.global_upload_ringbuffer,
-        storage_buffer.global_upload_ringbuffer_memory
-    );
-
-    storage_buffer.global_upload_ringbuffers_begin.resize(frames_in_flight);
-    storage_buffer.global_upload_ringbuffers_end.resize(frames_in_flight);
-    storage_buffer.global_upload_ringbuffers_size.resize(frames_in_flight);
-
-    for (uint32_t i = 0; i < frames_in_flight; ++i) {
-        storage_buffer.global_upload_ringbuffers_begin[i] =
-            (global_storage_buffer_size * i) / frames_in_flight;
-        storage_buffer.global_upload_ringbuffers_end[i] =
-            storage_buffer.global_upload_ringbuffers_begin[i];
-        storage_buffer.global_upload_ringbuffers_size[i] =
-            (global_storage_buffer_size * (i + 1)) / frames_in_flight -
-            (global_storage_buffer_size * i) / frames_in_flight;
-    }
-
-    vkMapMemory(
-        m_ctx->device,
-        storage_buffer.global_upload_ringbuffer_memory,
-        0,
-        VK_WHOLE_SIZE,
-        0,
-        &storage_buffer.global_upload_ringbuffer_memory_pointer
-    );
 }
 
 void RenderResource::createIBLSamplers() {
@@ -635,245 +549,272 @@ void RenderResource::freeIBLResource() {
     );
 }
 
-void RenderResource::uploadVertexBuffer(
-    MeshResource &mesh, const void *vertex_data, size_t vertex_buffer_size
-) {
-    VkBuffer inefficient_staging_buffer;
-    VkDeviceMemory inefficient_staging_buffer_memory;
-    createBuffer(
-        m_ctx->physical_device,
-        m_ctx->device,
-        vertex_buffer_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        inefficient_staging_buffer,
-        inefficient_staging_buffer_memory
-    );
+void RenderResource::uploadVertexBuffer(MeshResource &mesh, const void *vertex_data) {
+    size_t vertex_buffer_size = mesh.vertex_count * sizeof(MeshVertex);
+    if (vertex_buffer_size == 0) {
+        return;
+    }
 
-    void *staging_buffer_data;
-    vkMapMemory(
-        m_ctx->device,
-        inefficient_staging_buffer_memory,
-        0,
+    mesh.vertex_allocation = m_vertex_arena.allocate(mesh.vertex_count);
+    mesh.vertex_buffer = m_vertex_arena.buffer(mesh.vertex_allocation.block);
+    mesh.vertex_offset = static_cast<int32_t>(mesh.vertex_allocation.offset);
+
+    uploadBufferData(
+        vertex_data,
         vertex_buffer_size,
-        0,
-        &staging_buffer_data
+        mesh.vertex_buffer,
+        m_vertex_arena.byteOffset(mesh.vertex_allocation)
     );
-    memcpy(staging_buffer_data, vertex_data, vertex_buffer_size);
-    vkUnmapMemory(m_ctx->device, inefficient_staging_buffer_memory);
+}
 
-    VkBufferCreateInfo buffer_info{};
-    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buffer_info.size = vertex_buffer_size;
-    buffer_info.usage =
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+void RenderResource::uploadIndexBuffer(MeshResource &mesh, const void *index_data) {
+    size_t index_buffer_size = mesh.index_count * sizeof(uint32_t);
+    if (index_buffer_size == 0) {
+        return;
+    }
 
-    VmaAllocationCreateInfo alloc_info{};
-    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    mesh.index_allocation = m_index_arena.allocate(mesh.index_count);
+    mesh.index_buffer = m_index_arena.buffer(mesh.index_allocation.block);
+    mesh.first_index = mesh.index_allocation.offset;
 
-    vmaCreateBuffer(
-        m_ctx->assets_allocator,
-        &buffer_info,
-        &alloc_info,
-        &mesh.vertex_buffer,
-        &mesh.vertex_buffer_allocation,
-        nullptr
+    uploadBufferData(
+        index_data,
+        index_buffer_size,
+        mesh.index_buffer,
+        m_index_arena.byteOffset(mesh.index_allocation)
     );
+}
 
-    copyBuffer(
-        m_ctx, inefficient_staging_buffer, mesh.vertex_buffer, 0, 0, vertex_buffer_size
-    );
+void RenderResource::uploadBufferData(
+    const void *data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset
+) {
+    UploadBatcher *upload_batcher = &m_ctx->upload_batcher;
+
+    UploadBatcher::Upload upload{};
+    upload.data = data;
+    upload.size = size;
+    upload.record = [=](VkCommandBuffer command_buffer,
+                        const UploadBatcher::StagingSlice &staging) {
+        VkBufferCopy copy_region{staging.offset, offset, size};
+        vkCmdCopyBuffer(command_buffer, staging.buffer, buffer, 1, &copy_region);
+    };
+    upload.finish = [=](VkCommandBuffer command_buffer) {
+        upload_batcher->acquireBuffer(
+            command_buffer,
+            buffer,
+            offset,
+            size,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+        );
+    };
+    upload_batcher->enqueue(std::move(upload));
+}
 
-    vkDestroyBuffer(m_ctx->device, inefficient_staging_buffer, nullptr);
-    vkFreeMemory(m_ctx->device, inefficient_staging_buffer_memory, nullptr);
+void RenderResource::freeMeshResource(const MeshResource &mesh) {
+    m_vertex_arena.free(mesh.vertex_allocation);
+    m_index_arena.free(mesh.index_allocation);
+    gpu_scene.removeMesh(mesh.draw_index);
 }
 
-void RenderResource::uploadIndexBuffer(
-    MeshResource &mesh, const void *index_data, size_t index_buffer_size
-) {
-    VkBuffer inefficient_staging_buffer;
-    VkDeviceMemory inefficient_staging_buffer_memory;
-    createBuffer(
-        m_ctx->physical_device,
-        m_ctx->device,
-        index_buffer_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        inefficient_staging_buffer,
-        inefficient_staging_buffer_memory
-    );
+uint32_t RenderResource::addMaterial(const MeshMaterial &material) {
+    if (m_material_count == m_material_capacity) {
+        growMaterialsBuffer(m_material_capacity * 2);
+    }
 
-    void *staging_buffer_data;
-    vkMapMemory(
-        m_ctx->device,
-        inefficient_staging_buffer_memory,
-        0,
-        index_buffer_size,
-        0,
-        &staging_buffer_data
-    );
-    memcpy(staging_buffer_data, index_data, index_buffer_size);
-    vkUnmapMemory(m_ctx->device, inefficient_staging_buffer_memory);
+    m_materials_pointer[m_material_count] = material;
+    return m_material_count++;
+}
+
+void RenderResource::growMaterialsBuffer(uint32_t capacity) {
+    VkBuffer old_buffer = m_materials_buffer;
+    VmaAllocation old_allocation = m_materials_buffer_allocation;
+    MeshMaterial *old_pointer = m_materials_pointer;
 
     VkBufferCreateInfo buffer_info{};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buffer_info.size = index_buffer_size;
-    buffer_info.usage =
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    buffer_info.size = sizeof(MeshMaterial) * capacity;
+    buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    // small and written once per material, the gpu reads it through the host mapping
     VmaAllocationCreateInfo alloc_info{};
-    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    alloc_info.requiredFlags =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
+    VmaAllocationInfo allocation_info{};
     vmaCreateBuffer(
         m_ctx->assets_allocator,
         &buffer_info,
         &alloc_info,
-        &mesh.index_buffer,
-        &mesh.index_buffer_allocation,
-        nullptr
+        &m_materials_buffer,
+        &m_materials_buffer_allocation,
+        &allocation_info
     );
+    m_materials_pointer = static_cast<MeshMaterial *>(allocation_info.pMappedData);
+    m_material_capacity = capacity;
 
-    copyBuffer(
-        m_ctx, inefficient_staging_buffer, mesh.index_buffer, 0, 0, index_buffer_size
-    );
+    if (old_buffer != VK_NULL_HANDLE) {
+        std::copy(old_pointer, old_pointer + m_material_count, m_materials_pointer);
 
-    vkDestroyBuffer(m_ctx->device, inefficient_staging_buffer, nullptr);
-    vkFreeMemory(m_ctx->device, inefficient_staging_buffer_memory, nullptr);
-}
+        // frames in flight may still read the old buffer, growing doubles so it's rare
+        vkDeviceWaitIdle(m_ctx->device);
+        vmaDestroyBuffer(m_ctx->assets_allocator, old_buffer, old_allocation);
+    }
 
-void RenderResource::freeMeshResource(const MeshResource &mesh) {
-    vmaDestroyBuffer(
-        m_ctx->assets_allocator, mesh.vertex_buffer, mesh.vertex_buffer_allocation
-    );
-    vmaDestroyBuffer(
-        m_ctx->assets_allocator, mesh.index_buffer, mesh.index_buffer_allocation
-    );
+    VkDescriptorBufferInfo materials_buffer_info{};
+    materials_buffer_info.buffer = m_materials_buffer;
+    materials_buffer_info.offset = 0;
+    materials_buffer_info.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet materials_descriptor_write{};
+    materials_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    materials_descriptor_write.dstSet = materials_descriptor_set;
+    materials_descriptor_write.dstBinding = 0;
+    materials_descriptor_write.dstArrayElement = 0;
+    materials_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    materials_descriptor_write.descriptorCount = 1;
+    materials_descriptor_write.pBufferInfo = &materials_buffer_info;
+
+    vkUpdateDescriptorSets(m_ctx->device, 1, &materials_descriptor_write, 0, nullptr);
 }
 
-void RenderResource::uploadMaterialUniformBuffer(
-    PBRMaterialResource &material, const RenderEntity &entity
-) {
-    MeshPerMaterialUniformBufferObject material_uniform_data{};
-
-    material_uniform_data.base_color_factor = entity.base_color_factor;
-    material_uniform_data.metallic_factor = entity.metallic_factor;
-    material_uniform_data.roughness_factor = entity.roughness_factor;
-    material_uniform_data.normal_scale = entity.normal_scale;
-    material_uniform_data.occlusion_strength = entity.occlusion_strength;
-    material_uniform_data.emissive_factor = entity.emissive_factor;
-    material_uniform_data.is_blend = entity.blend;
-    material_uniform_data.is_double_sided = entity.double_sided;
-
-    size_t buffer_size = sizeof(MeshPerMaterialUniformBufferObject);
-
-    VkBuffer inefficient_staging_buffer;
-    VkDeviceMemory inefficient_staging_buffer_memory;
-    createBuffer(
-        m_ctx->physical_device,
-        m_ctx->device,
-        buffer_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        inefficient_staging_buffer,
-        inefficient_staging_buffer_memory
-    );
+uint32_t RenderResource::addBindlessTexture(VkImageView view, VkSampler sampler) {
+    uint32_t index = m_bindless_texture_count;
+    if (!m_free_bindless_textures.empty()) {
+        index = m_free_bindless_textures.back();
+        m_free_bindless_textures.pop_back();
+    } else if (m_bindless_texture_count == m_ctx->bindless_texture_count) {
+        VAIN_ERROR("bindless texture array is full");
+    } else {
+        ++m_bindless_texture_count;
+    }
 
-    void *staging_buffer_data;
-    vkMapMemory(
-        m_ctx->device,
-        inefficient_staging_buffer_memory,
-        0,
-        buffer_size,
-        0,
-        &staging_buffer_data
-    );
-    memcpy(staging_buffer_data, &material_uniform_data, buffer_size);
-    vkUnmapMemory(m_ctx->device, inefficient_staging_buffer_memory);
+    VkDescriptorImageInfo image_info{};
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_info.imageView = view;
+    image_info.sampler = sampler;
 
-    VkBufferCreateInfo buffer_info{};
-    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buffer_info.size = buffer_size;
-    buffer_info.usage =
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkWriteDescriptorSet texture_descriptor_write{};
+    texture_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    texture_descriptor_write.dstSet = materials_descriptor_set;
+    texture_descriptor_write.dstBinding = 1;
+    texture_descriptor_write.dstArrayElement = index;
+    texture_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    texture_descriptor_write.descriptorCount = 1;
+    texture_descriptor_write.pImageInfo = &image_info;
 
-    VmaAllocationCreateInfo alloc_info{};
-    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    vkUpdateDescriptorSets(m_ctx->device, 1, &texture_descriptor_write, 0, nullptr);
 
-    vmaCreateBufferWithAlignment(
-        m_ctx->assets_allocator,
-        &buffer_info,
-        &alloc_info,
-        global_render_resource.storage_buffer.min_uniform_buffer_offset_alignment,
-        &material.material_uniform_buffer,
-        &material.material_uniform_buffer_allocation,
-        nullptr
-    );
+    return index;
+}
 
-    copyBuffer(
-        m_ctx,
-        inefficient_staging_buffer,
-        material.material_uniform_buffer,
-        0,
-        0,
-        buffer_size
-    );
+void RenderResource::freePBRMaterialResource(const PBRMaterialResource &material) {
+    releaseTexture(material.base_color_texture);
+    releaseTexture(material.metallic_roughness_texture);
+    releaseTexture(material.normal_texture);
+    releaseTexture(material.occlusion_texture);
+    releaseTexture(material.emissive_texture);
+}
 
-    vkDestroyBuffer(m_ctx->device, inefficient_staging_buffer, nullptr);
-    vkFreeMemory(m_ctx->device, inefficient_staging_buffer_memory, nullptr);
+void RenderResource::freeTextureResource(
+    VkImage image, VkImageView view, VmaAllocation allocation
+) {
+    vkDestroyImageView(m_ctx->device, view, nullptr);
+    vmaDestroyImage(m_ctx->assets_allocator, image, allocation);
 }
 
-void RenderResource::freePBRMaterialResource(const PBRMaterialResource &material) {
-    freeTextureResource(
-        material.base_color_texture_image,
-        material.base_color_image_view,
-        material.base_color_image_allocation
-    );
+void RenderResource::createDefaultTextures() {
+    uint8_t white[] = {255, 255, 255, 255};
+    uint8_t normal[] = {128, 128, 255, 255};
+
+    // the resource holds a reference to each, released by clearMaterial
+    for (uint32_t bindless_index : {
+             createCachedTexture(k_default_white_srgb_texture, 1, 1, white),
+             createCachedTexture(k_default_white_texture, 1, 1, white),
+             createCachedTexture(k_default_normal_texture, 1, 1, normal),
+         }) {
+        ++m_textures[bindless_index].ref_count;
+    }
+}
 
-    freeTextureResource(
-        material.normal_texture_image,
-        material.normal_image_view,
-        material.normal_image_allocation
-    );
+uint32_t RenderResource::acquireTexture(
+    const std::shared_ptr<TextureData> &data, const TextureKey &default_key
+) {
+    TextureKey key = default_key;
+    if (data) {
+        key = {data->file, data->format};
+        if (key.first.empty()) {
+            key.first = "<texture " + std::to_string(m_unnamed_texture_count++) + ">";
+        }
+    }
 
-    freeTextureResource(
-        material.metallic_texture_image,
-        material.metallic_image_view,
-        material.metallic_image_allocation
-    );
+    uint32_t bindless_index;
+    auto iter = m_texture_cache.find(key);
+    if (iter != m_texture_cache.end()) {
+        bindless_index = iter->second;
 
-    freeTextureResource(
-        material.roughness_texture_image,
-        material.roughness_image_view,
-        material.roughness_image_allocation
-    );
+        ++m_texture_cache_statistics.hit_count;
+        m_texture_cache_statistics.saved_memory += m_textures[bindless_index].size;
+    } else {
+        bindless_index =
+            createCachedTexture(key, data->width, data->height, data->pixels);
+    }
 
-    freeTextureResource(
-        material.occlusion_texture_image,
-        material.occlusion_image_view,
-        material.occlusion_image_allocation
-    );
+    ++m_textures[bindless_index].ref_count;
+    return bindless_index;
+}
 
-    freeTextureResource(
-        material.emissive_texture_image,
-        material.emissive_image_view,
-        material.emissive_image_allocation
+uint32_t RenderResource::createCachedTexture(
+    const TextureKey &key, uint32_t width, uint32_t height, void *pixels
+) {
+    TextureResource texture{};
+    texture.key = key;
+    // a full mip chain adds a third
+    texture.size = VkDeviceSize{texelSize(key.second)} * width * height * 4 / 3;
+
+    createTexture(
+        m_ctx,
+        width,
+        height,
+        pixels,
+        key.second,
+        0,
+        texture.image,
+        texture.view,
+        texture.allocation
     );
 
-    vmaDestroyBuffer(
-        m_ctx->assets_allocator,
-        material.material_uniform_buffer,
-        material.material_uniform_buffer_allocation
+    uint32_t bindless_index = addBindlessTexture(
+        texture.view, m_ctx->getOrCreateMipmapSampler(width, height)
     );
+    m_texture_cache[key] = bindless_index;
+    m_textures[bindless_index] = texture;
+
+    ++m_texture_cache_statistics.texture_count;
+    m_texture_cache_statistics.memory += texture.size;
+
+    return bindless_index;
 }
 
-void RenderResource::freeTextureResource(
-    VkImage image, VkImageView view, VmaAllocation allocation
-) {
-    vkDestroyImageView(m_ctx->device, view, nullptr);
-    vmaDestroyImage(m_ctx->assets_allocator, image, allocation);
+void RenderResource::releaseTexture(uint32_t bindless_index) {
+    auto iter = m_textures.find(bindless_index);
+    assert(iter != m_textures.end() && iter->second.ref_count > 0);
+    TextureResource &texture = iter->second;
+    if (--texture.ref_count > 0) {
+        return;
+    }
+
+    freeTextureResource(texture.image, texture.view, texture.allocation);
+    m_free_bindless_textures.push_back(bindless_index);
+
+    --m_texture_cache_statistics.texture_count;
+    m_texture_cache_statistics.memory -= texture.size;
+
+    m_texture_cache.erase(texture.key);
+    m_textures.erase(iter);
 }
 
 }  // namespace Vain
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <array>
+#include <map>
+#include <unordered_set>
 
 #include "core/vulkan/vulkan_context.h"
+#include "function/render/geometry_arena.h"
+#include "function/render/gpu_scene.h"
 #include "function/render/render_data.h"
 #include "function/render/render_entity.h"
 #include "function/render/render_type.h"
+#include "function/render/frame_upload_buffer.h"
 
 namespace Vain {
 
@@ -35,13 +40,6 @@ struct StorageBuffer {
     VkDeviceSize min_storage_buffer_offset_alignment{256};
     uint32_t max_storage_buffer_range{1 << 27};
     uint32_t non_coherent_atom_size{256};
-
-    VkBuffer global_upload_ringbuffer{};
-    VkDeviceMemory global_upload_ringbuffer_memory{};
-    void *global_upload_ringbuffer_memory_pointer{};
-    std::vector<uint32_t> global_upload_ringbuffers_begin{};
-    std::vector<uint32_t> global_upload_ringbuffers_end{};
-    std::vector<uint32_t> global_upload_ringbuffers_size{};
 };
 
 struct GlobalRenderResource {
@@ -49,53 +47,70 @@ struct GlobalRenderResource {
     StorageBuffer storage_buffer{};
 };
 
+// vertices and indices live in the shared geometry arenas, the buffers are the arena
+// blocks holding them
 struct MeshResource {
     uint32_t vertex_count{};
     VkBuffer vertex_buffer{};
-    VmaAllocation vertex_buffer_allocation{};
+    int32_t vertex_offset{};
+    GeometryArena::Allocation vertex_allocation{};
 
     uint32_t index_count{};
     VkBuffer index_buffer{};
-    VmaAllocation index_buffer_allocation{};
+    uint32_t first_index{};
+    GeometryArena::Allocation index_allocation{};
 
     AxisAlignedBoundingBox aabb{};
-};
-
-struct PBRMaterialResource {
-    VkImage base_color_texture_image{};
-    VkImageView base_color_image_view{};
-    VmaAllocation base_color_image_allocation{};
-
-    VkImage metallic_texture_image{};
-    VkImageView metallic_image_view{};
-    VmaAllocation metallic_image_allocation{};
-
-    VkImage roughness_texture_image{};
-    VkImageView roughness_image_view{};
-    VmaAllocation roughness_image_allocation{};
+    std::shared_ptr<const OccluderMesh> occluder{};
 
-    VkImage normal_texture_image{};
-    VkImageView normal_image_view{};
-    VmaAllocation normal_image_allocation{};
-
-    VkImage occlusion_texture_image{};
-    VkImageView occlusion_image_view{};
-    VmaAllocation occlusion_image_allocation{};
+    // element of the gpu scene meshes
+    uint32_t draw_index{};
+};
 
-    VkImage emissive_texture_image{};
-    VkImageView emissive_image_view{};
-    VmaAllocation emissive_image_allocation{};
+// a material texture, shared by every material sampling the same file in the same format
+struct TextureResource {
+    VkImage image{};
+    VkImageView view{};
+    VmaAllocation allocation{};
+    // bytes with the mip chain
+    VkDeviceSize size{};
+
+    uint32_t ref_count{};
+    // resolved file and format the texture is cached under
+    std::pair<std::string, VkFormat> key{};
+};
 
-    VkBuffer material_uniform_buffer{};
-    VmaAllocation material_uniform_buffer_allocation{};
+struct TextureCacheStatistics {
+    uint32_t texture_count{};
+    VkDeviceSize memory{};
+    // material slots that found their texture cached, and what their own copies would
+    // have taken
+    uint32_t hit_count{};
+    VkDeviceSize saved_memory{};
+};
 
-    VkDescriptorSet material_descriptor_set{};
+struct PBRMaterialResource {
+    // elements of the bindless texture array
+    uint32_t base_color_texture{};
+    uint32_t metallic_roughness_texture{};
+    uint32_t normal_texture{};
+    uint32_t occlusion_texture{};
+    uint32_t emissive_texture{};
+
+    // element of the bindless materials buffer
+    uint32_t material_index{};
 };
 
 class RenderResource {
   public:
     GlobalRenderResource global_render_resource{};
-    VkDescriptorSetLayout material_descriptor_set_layout{};
+    // bindless materials, one storage buffer of MeshMaterial and one texture array
+    // shared by every material
+    VkDescriptorSet materials_descriptor_set{};
+    // the instance table every pass reads, and the gpu driven draws
+    GpuScene gpu_scene{};
+    // per frame data and index lists, bound with dynamic offsets
+    FrameUploadBuffer frame_upload_buffer{};
 
     MeshPerFrameStorageBufferObject mesh_per_frame_storage_buffer_object{};
     PointLightShadowPerFrameStorageBufferObject
@@ -109,6 +124,8 @@ class RenderResource {
     void initialize(VulkanContext *ctx);
     void clear();
 
+    void createMaterialsDescriptorSet(VkDescriptorSetLayout layout);
+
     void updatePerFrame(const RenderScene &scene, const RenderCamera &camera);
 
     void uploadGlobalRenderResource(const IBLDesc &ibl_desc);
@@ -118,24 +135,96 @@ class RenderResource {
     void uploadMesh(const RenderEntity &entity, const MeshData &data);
     void uploadPBRMaterial(const RenderEntity &entity, const PBRMaterialData &data);
 
-    void resetRingBufferOffset();
-
-    const MeshResource *getEntityMesh(const RenderEntity &entity) const;
+    // call before anything of the frame is recorded, reserve_size is an upper bound of
+    // what the frame allocates from the ring buffer
+    void beginRingBufferFrame(VkDeviceSize reserve_size);
+    // reserves size bytes of the current frame ring buffer at a dynamic storage buffer
+    // offset, returns the offset or FrameUploadBuffer::k_invalid_offset when the
+    // allocation wasn't reserved and doesn't fit
+    uint32_t allocateRingBuffer(uint32_t size);
+    void *getRingBufferPointer(uint32_t offset) const;
+    // reserves count contiguous elements of the instance index lists, which are the
+    // whole ring buffer seen as an array of stride uint32_t elements, returns the
+    // first element index, k_invalid_offset the same way
+    uint32_t allocateInstanceIndices(uint32_t count, uint32_t stride = 1);
+    uint32_t *getInstanceIndexPointer(uint32_t index, uint32_t stride = 1) const;
+    // upper bounds of the ring buffer bytes the calls above take, for the reservation
+    VkDeviceSize ringBufferAllocationSize(uint32_t size) const;
+    VkDeviceSize instanceIndicesAllocationSize(uint32_t count, uint32_t stride = 1) const;
+
+    // null until the upload of the resource has completed, unless include_pending
+    const MeshResource *getEntityMesh(
+        const RenderEntity &entity, bool include_pending = false
+    ) const;
     const PBRMaterialResource *getEntityMaterial(const RenderEntity &entity) const;
+    bool entityResident(const RenderEntity &entity) const {
+        return getEntityMesh(entity) && getEntityMaterial(entity);
+    }
+
+    // once a frame, with the frame command buffer begun, before anything uses the
+    // resources
+    void updateUploads(VkCommandBuffer command_buffer);
+    // whether the last updateUploads completed any mesh or material, and whether it
+    // made the entity resident
+    bool uploadsCompleted() const {
+        return !m_completed_meshes.empty() || !m_completed_materials.empty();
+    }
+    bool entityUploadCompleted(const RenderEntity &entity) const;
 
     void freeMeshResource(const MeshResource &mesh);
+    // the gpu must be done with the material, its textures go with their last user
     void freePBRMaterialResource(const PBRMaterialResource &material);
 
+    const TextureCacheStatistics &textureCacheStatistics() const {
+        return m_texture_cache_statistics;
+    }
+
     void clearMesh();
     void clearMaterial();
 
+    UploadBatcher &uploadBatcher() const { return m_ctx->upload_batcher; }
+
   private:
     VulkanContext *m_ctx{};
     bool m_global_uploaded{false};
     std::unordered_map<size_t, MeshResource> m_mesh_map{};
+
+    static constexpr uint32_t k_geometry_arena_block_size{64 * 1024 * 1024};
+    GeometryArena m_vertex_arena{};
+    GeometryArena m_index_arena{};
     std::unordered_map<size_t, PBRMaterialResource> m_material_map{};
 
-    void createAndMapStorageBuffer();
+    // assets whose upload hasn't completed, and those that completed in the last update
+    std::unordered_set<size_t> m_pending_meshes{};
+    std::unordered_set<size_t> m_pending_materials{};
+    std::unordered_set<size_t> m_completed_meshes{};
+    std::unordered_set<size_t> m_completed_materials{};
+
+    static constexpr uint32_t k_initial_material_capacity{256};
+    VkBuffer m_materials_buffer{};
+    VmaAllocation m_materials_buffer_allocation{};
+    MeshMaterial *m_materials_pointer{};
+    uint32_t m_material_capacity{};
+    uint32_t m_material_count{};
+    uint32_t m_bindless_texture_count{};
+    // elements of textures freed, reused before the array grows
+    std::vector<uint32_t> m_free_bindless_textures{};
+
+    using TextureKey = std::pair<std::string, VkFormat>;
+    // built in 1x1 textures of the material slots without one, as glTF defines them.
+    // cached like the others under names no resolved path takes, and held by the
+    // resource so they're never freed before clear
+    static const TextureKey k_default_white_srgb_texture;
+    static const TextureKey k_default_white_texture;
+    static const TextureKey k_default_normal_texture;
+
+    std::map<TextureKey, uint32_t> m_texture_cache{};
+    // by bindless element
+    std::unordered_map<uint32_t, TextureResource> m_textures{};
+    uint32_t m_unnamed_texture_count{};
+    TextureCacheStatistics m_texture_cache_statistics{};
+
+    void queryStorageBufferLimits();
     void createIBLSamplers();
     void createIBLTextures(
         std::array<std::shared_ptr<TextureData>, 6> irradiance_maps,
@@ -143,17 +232,27 @@ class RenderResource {
     );
     void freeIBLResource();
 
-    void uploadVertexBuffer(
-        MeshResource &mesh, const void *vertex_data, size_t vertex_buffer_size
-    );
-    void uploadIndexBuffer(
-        MeshResource &mesh, const void *index_data, size_t index_buffer_size
+    void uploadVertexBuffer(MeshResource &mesh, const void *vertex_data);
+    void uploadIndexBuffer(MeshResource &mesh, const void *index_data);
+    void uploadBufferData(
+        const void *data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset
     );
 
-    void uploadMaterialUniformBuffer(
-        PBRMaterialResource &material, const RenderEntity &entity
-    );
+    uint32_t addMaterial(const MeshMaterial &material);
+    void growMaterialsBuffer(uint32_t capacity);
+    uint32_t addBindlessTexture(VkImageView view, VkSampler sampler);
     void freeTextureResource(VkImage image, VkImageView view, VmaAllocation allocation);
+
+    void createDefaultTextures();
+    // returns the bindless element of the texture of data, uploading it unless cached,
+    // or of default_key when the material has none
+    uint32_t acquireTexture(
+        const std::shared_ptr<TextureData> &data, const TextureKey &default_key
+    );
+    uint32_t createCachedTexture(
+        const TextureKey &key, uint32_t width, uint32_t height, void *pixels
+    );
+    void releaseTexture(uint32_t bindless_index);
 };
 
 }  // namespace Vain
@@ -1,105 +1,642 @@
 #include "render_scene.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "core/math/frustum.h"
+#include "function/global/global_context.h"
 #include "function/render/render_camera.h"
 #include "function/render/render_resource.h"
+#include "function/render/software_occlusion.h"
 
 namespace Vain {
 
+static constexpr uint32_t k_max_software_occluder_count = 32;
+// bounding radius over distance an entity needs to be picked as an occluder
+static constexpr float k_min_software_occluder_screen_ratio = 0.1f;
+
+RenderScene::RenderScene() = default;
+
 RenderScene::~RenderScene() { clear(); }
 
 void RenderScene::clear() {}
 
+// boxes touching the scene bounds may shrink them when they move or go away
+static bool strictlyInside(
+    const AxisAlignedBoundingBox &inner, const AxisAlignedBoundingBox &outer
+) {
+    glm::vec3 inner_min = inner.minCorner();
+    glm::vec3 inner_max = inner.maxCorner();
+    glm::vec3 outer_min = outer.minCorner();
+    glm::vec3 outer_max = outer.maxCorner();
+
+    return glm::all(glm::greaterThan(inner_min, outer_min)) &&
+           glm::all(glm::lessThan(inner_max, outer_max));
+}
+
+static float boxDistance(const AxisAlignedBoundingBox &aabb, const glm::vec3 &point) {
+    return glm::length(glm::max(glm::abs(point - aabb.center) - aabb.half_extent, 0.0f));
+}
+
+// projection_scale is proj[1][1] of the view, view_depth is 1 for orthographic views
+static bool contributes(
+    const RenderEntity &entity,
+    const ViewCullSettings &settings,
+    float projection_scale,
+    float view_depth,
+    const glm::vec3 &camera_position
+) {
+    float max_draw_distance = settings.max_draw_distance;
+    if (entity.max_draw_distance > 0.0f) {
+        max_draw_distance = max_draw_distance > 0.0f
+                                ? std::min(max_draw_distance, entity.max_draw_distance)
+                                : entity.max_draw_distance;
+    }
+    if (max_draw_distance > 0.0f &&
+        boxDistance(entity.world_aabb, camera_position) > max_draw_distance) {
+        return false;
+    }
+
+    float min_screen_coverage =
+        std::max(settings.min_screen_coverage, entity.min_screen_coverage);
+    if (min_screen_coverage > 0.0f) {
+        float radius = glm::length(entity.world_aabb.half_extent);
+        // the view is inside the bounds or right at them
+        if (view_depth <= radius) {
+            return true;
+        }
+        if (radius * projection_scale < min_screen_coverage * view_depth) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// returns how many entities were dropped
+static uint32_t contributionCullEntities(
+    const ViewCullSettings &settings,
+    const glm::mat4 &proj_view,
+    float projection_scale,
+    const glm::vec3 &camera_position,
+    std::vector<const RenderEntity *> &entities
+) {
+    size_t count = entities.size();
+    entities.erase(
+        std::remove_if(
+            entities.begin(),
+            entities.end(),
+            [&](const RenderEntity *entity) {
+                float view_depth =
+                    (proj_view * glm::vec4{entity->world_aabb.center, 1.0f}).w;
+                return !contributes(
+                    *entity, settings, projection_scale, view_depth, camera_position
+                );
+            }
+        ),
+        entities.end()
+    );
+
+    return static_cast<uint32_t>(count - entities.size());
+}
+
 void RenderScene::updateVisibleNodes(RenderResource &resource, RenderCamera &camera) {
+    updateSceneBoundingBox();
+
     updateVisibleNodesDirectionalLight(resource, camera);
+    if (m_gpu_driven_culling) {
+        return;
+    }
     updateVisibleNodesPointLights(resource, camera);
     updateVisibleNodesMainCamera(resource, camera);
 }
 
-void RenderScene::clearForReloading() { render_entities.clear(); }
+void RenderScene::refreshUploadedEntities(const RenderResource &resource) {
+    if (!resource.uploadsCompleted()) {
+        return;
+    }
+
+    bool refreshed = false;
+    for (const RenderEntity *entity : instance_entities) {
+        if (resource.entityUploadCompleted(*entity)) {
+            markInstanceSlotDirty(entity->instance_slot);
+            refreshed = true;
+        }
+    }
+
+    if (refreshed) {
+        ++m_entity_epoch;
+    }
+}
+
+void RenderScene::clearDirtyInstanceSlots() {
+    for (uint32_t slot : dirty_instance_slots) {
+        m_instance_slot_dirty[slot] = false;
+    }
+    dirty_instance_slots.clear();
+}
+
+void RenderScene::markInstanceSlotDirty(uint32_t slot) {
+    if (slot >= m_instance_slot_dirty.size()) {
+        m_instance_slot_dirty.resize(slot + 1, false);
+    }
+    if (!m_instance_slot_dirty[slot]) {
+        m_instance_slot_dirty[slot] = true;
+        dirty_instance_slots.push_back(slot);
+    }
+}
+
+void RenderScene::addEntity(const std::shared_ptr<RenderEntity> &entity) {
+    entity->updateWorldBoundingBox();
+    entity->bvh_proxy = m_entity_bvh.createProxy(entity->world_aabb, entity.get());
+    render_entities.insert(entity);
+
+    entity->instance_slot = static_cast<uint32_t>(instance_entities.size());
+    instance_entities.push_back(entity.get());
+    markInstanceSlotDirty(entity->instance_slot);
+
+    m_scene_bounding_box.merge(entity->world_aabb);
+    entity->epoch = ++m_entity_epoch;
+}
+
+void RenderScene::removeEntity(const std::shared_ptr<RenderEntity> &entity) {
+    if (render_entities.erase(entity) == 0) {
+        return;
+    }
+
+    m_entity_bvh.destroyProxy(entity->bvh_proxy);
+    entity->bvh_proxy = BoundingVolumeHierarchy::k_null_node;
+    main_camera_occluded_entities.erase(entity.get());
+
+    // the last entity fills the hole, the old last slot is dirty so the table shrinks
+    uint32_t last_slot = static_cast<uint32_t>(instance_entities.size() - 1);
+    if (entity->instance_slot != last_slot) {
+        RenderEntity *moved = instance_entities[last_slot];
+        moved->instance_slot = entity->instance_slot;
+        instance_entities[moved->instance_slot] = moved;
+        markInstanceSlotDirty(moved->instance_slot);
+    }
+    instance_entities.pop_back();
+    markInstanceSlotDirty(last_slot);
+
+    if (!strictlyInside(entity->world_aabb, m_scene_bounding_box)) {
+        m_scene_bounding_box_dirty = true;
+    }
+    m_entity_removal_epoch = ++m_entity_epoch;
+}
+
+void RenderScene::updateEntity(RenderEntity &entity) {
+    AxisAlignedBoundingBox old_world_aabb = entity.world_aabb;
+    entity.updateWorldBoundingBox();
+
+    if (entity.bvh_proxy == BoundingVolumeHierarchy::k_null_node) {
+        return;
+    }
+
+    m_entity_bvh.moveProxy(entity.bvh_proxy, entity.world_aabb);
+    markInstanceSlotDirty(entity.instance_slot);
+
+    if (!strictlyInside(old_world_aabb, m_scene_bounding_box)) {
+        m_scene_bounding_box_dirty = true;
+    } else {
+        m_scene_bounding_box.merge(entity.world_aabb);
+    }
+    entity.epoch = ++m_entity_epoch;
+}
+
+void RenderScene::clearForReloading() {
+    for (const auto &entity : render_entities) {
+        entity->bvh_proxy = BoundingVolumeHierarchy::k_null_node;
+    }
+    render_entities.clear();
+    m_entity_bvh.clear();
+    main_camera_occluded_entities.clear();
+
+    for (uint32_t slot = 0; slot < instance_entities.size(); ++slot) {
+        markInstanceSlotDirty(slot);
+    }
+    instance_entities.clear();
+
+    m_scene_bounding_box = AxisAlignedBoundingBox{};
+    m_scene_bounding_box_dirty = false;
+    m_entity_removal_epoch = ++m_entity_epoch;
+}
+
+void RenderScene::updateSceneBoundingBox() {
+    if (!m_scene_bounding_box_dirty) {
+        return;
+    }
+
+    m_scene_bounding_box = AxisAlignedBoundingBox{};
+    for (const auto &entity : render_entities) {
+        m_scene_bounding_box.merge(entity->world_aabb);
+    }
+    m_scene_bounding_box_dirty = false;
+}
 
 void RenderScene::updateVisibleNodesDirectionalLight(
     RenderResource &resource, RenderCamera &camera
 ) {
-    directional_light_visible_mesh_nodes.clear();
-
-    glm::mat4 light_proj_view = calculateDirectionalLightView(*this, camera);
+    glm::mat4 light_proj{1.0};
+    glm::mat4 light_proj_view = calculateDirectionalLightView(*this, camera, light_proj);
     resource.mesh_per_frame_storage_buffer_object.directional_light_proj_view =
         light_proj_view;
     resource.directional_light_shadow_per_frame_storage_buffer_object.light_proj_view =
         light_proj_view;
 
+    if (m_gpu_driven_culling) {
+        return;
+    }
+
+    const ViewCullSettings &cull_settings = m_cull_settings.directional_light_shadow;
+    // casters are culled against the camera view as well
+    glm::mat4 camera_proj_view = camera.projection() * camera.view();
+
+    if (m_directional_light_visibility_epoch == m_entity_epoch &&
+        m_directional_light_visibility_proj_view == light_proj_view &&
+        m_directional_light_visibility_camera_proj_view == camera_proj_view) {
+        return;
+    }
+    m_directional_light_visibility_epoch = m_entity_epoch;
+    m_directional_light_visibility_proj_view = light_proj_view;
+    m_directional_light_visibility_camera_proj_view = camera_proj_view;
+
+    directional_light_visible_mesh_nodes.clear();
+    ++directional_light_visible_mesh_nodes_version;
+
     Frustum frustum{light_proj_view, -1.0, 1.0, -1.0, 1.0, 0.0, 1.0};
 
-    for (const auto &entity : render_entities) {
-        if (!frustum.intersect(boundingBoxTransform(entity->aabb, entity->model_matrix))) {
-            continue;
-        }
+    frustumCullEntities(frustum, m_visible_entities);
+    removeNonResidentEntities(resource, m_visible_entities);
+    visibility_statistics.directional_light_contribution_culled_count = 0;
+    if (cull_settings.enabled()) {
+        visibility_statistics.directional_light_contribution_culled_count =
+            contributionCullEntities(
+                cull_settings,
+                light_proj_view,
+                // the view rotation mustn't scale the coverage, only the ortho extent
+                std::abs(light_proj[1][1]),
+                camera.position,
+                m_visible_entities
+            );
+    }
+    receiverCullShadowCasters(camera, m_visible_entities);
 
+    for (const auto *entity : m_visible_entities) {
         directional_light_visible_mesh_nodes.emplace_back();
         RenderNode &node = directional_light_visible_mesh_nodes.back();
 
         node.model_matrix = entity->model_matrix;
+        node.ref_entity = entity;
 
         node.ref_mesh = resource.getEntityMesh(*entity);
         node.ref_material = resource.getEntityMaterial(*entity);
+        node.instance_index = entity->instance_slot;
     }
 }
 
 void RenderScene::updateVisibleNodesPointLights(
     RenderResource &resource, RenderCamera &camera
 ) {
-    point_lights_visible_mesh_nodes.clear();
+    uint32_t point_light_count =
+        std::min(static_cast<uint32_t>(point_lights.size()), k_max_point_light_count);
+
+    // compared and updated in place, so an unchanged frame doesn't allocate
+    std::vector<glm::vec4> &position_and_radius =
+        m_point_lights_visibility_position_and_radius;
+    bool lights_changed = position_and_radius.size() != point_light_count;
+    position_and_radius.resize(point_light_count);
+    for (uint32_t i = 0; i < point_light_count; ++i) {
+        glm::vec4 light{point_lights[i].position, point_lights[i].getRadius()};
+        if (position_and_radius[i] != light) {
+            position_and_radius[i] = light;
+            lights_changed = true;
+        }
+    }
 
-    for (const auto &entity : render_entities) {
-        bool intersect = false;
-        for (const auto &point_light : point_lights) {
-            intersect = boundingBoxTransform(entity->aabb, entity->model_matrix)
-                            .intersect(point_light.position, point_light.getRadius());
-            if (intersect) {
-                break;
+    const ViewCullSettings &cull_settings = m_cull_settings.point_light_shadow;
+    glm::vec3 camera_position =
+        cull_settings.max_draw_distance > 0.0f ? camera.position : glm::vec3{0.0f};
+
+    if (!lights_changed && m_point_lights_visibility_epoch == m_entity_epoch &&
+        m_point_lights_visibility_camera_position == camera_position) {
+        return;
+    }
+    m_point_lights_visibility_epoch = m_entity_epoch;
+    m_point_lights_visibility_camera_position = camera_position;
+
+    point_lights_visible_mesh_nodes.clear();
+    ++point_lights_visible_mesh_nodes_version;
+    visibility_statistics.point_lights_contribution_culled_count = 0;
+
+    std::vector<LitEntity> &lit_entities = m_lit_entities;
+    lit_entities.clear();
+
+    for (uint32_t i = 0; i < point_light_count; ++i) {
+        glm::vec3 position = position_and_radius[i];
+        float radius = position_and_radius[i].w;
+
+        m_entity_bvh.query(
+            [&](const AxisAlignedBoundingBox &aabb) {
+                return aabb.intersect(position, radius);
+            },
+            [&](void *user_data) {
+                const auto *entity = static_cast<const RenderEntity *>(user_data);
+                if (!entity->world_aabb.intersect(position, radius) ||
+                    !resource.entityResident(*entity)) {
+                    return;
+                }
+
+                // the cube map faces have a 90 degree fov, so a projection scale of 1
+                if (cull_settings.enabled() &&
+                    !contributes(
+                        *entity,
+                        cull_settings,
+                        1.0f,
+                        glm::length(entity->world_aabb.center - position),
+                        camera.position
+                    )) {
+                    ++visibility_statistics.point_lights_contribution_culled_count;
+                    return;
+                }
+
+                lit_entities.emplace_back(entity, 1u << i);
             }
-        }
+        );
+    }
 
-        if (!intersect) {
-            continue;
+    // an entity may be lit by several point lights, merge them into one mask
+    std::sort(
+        lit_entities.begin(),
+        lit_entities.end(),
+        [](const LitEntity &a, const LitEntity &b) { return a.first < b.first; }
+    );
+
+    for (size_t i = 0; i < lit_entities.size(); ++i) {
+        const RenderEntity *entity = lit_entities[i].first;
+        uint32_t point_light_mask = lit_entities[i].second;
+        while (i + 1 < lit_entities.size() && lit_entities[i + 1].first == entity) {
+            point_light_mask |= lit_entities[++i].second;
         }
 
         point_lights_visible_mesh_nodes.emplace_back();
         RenderNode &node = point_lights_visible_mesh_nodes.back();
 
         node.model_matrix = entity->model_matrix;
+        node.ref_entity = entity;
 
         node.ref_mesh = resource.getEntityMesh(*entity);
         node.ref_material = resource.getEntityMaterial(*entity);
+        node.instance_index = entity->instance_slot;
+        node.point_light_mask = point_light_mask;
     }
 }
 
 void RenderScene::updateVisibleNodesMainCamera(
     RenderResource &resource, RenderCamera &camera
 ) {
+    glm::mat4 proj_view_matrix = camera.projection() * camera.view();
+
+    if (m_main_camera_visibility_epoch == m_entity_epoch &&
+        m_main_camera_visibility_proj_view == proj_view_matrix) {
+        return;
+    }
+    m_main_camera_visibility_epoch = m_entity_epoch;
+    m_main_camera_visibility_proj_view = proj_view_matrix;
+
     main_camera_visible_mesh_nodes.clear();
+    ++main_camera_visible_mesh_nodes_version;
 
-    glm::mat4 proj_view_matrix = camera.projection() * camera.view();
     Frustum frustum{proj_view_matrix, -1.0, 1.0, -1.0, 1.0, 0.0, 1.0};
 
-    for (const auto &entity : render_entities) {
-        if (!frustum.intersect(boundingBoxTransform(entity->aabb, entity->model_matrix))) {
-            continue;
-        }
+    frustumCullEntities(frustum, m_visible_entities);
+    removeNonResidentEntities(resource, m_visible_entities);
+    visibility_statistics.main_camera_contribution_culled_count = 0;
+    if (m_cull_settings.main_camera.enabled()) {
+        visibility_statistics.main_camera_contribution_culled_count =
+            contributionCullEntities(
+                m_cull_settings.main_camera,
+                proj_view_matrix,
+                std::abs(camera.projection()[1][1]),
+                camera.position,
+                m_visible_entities
+            );
+    }
+    visibility_statistics.main_camera_frustum_visible_count = m_visible_entities.size();
+
+    if (m_software_occlusion_culling) {
+        softwareOcclusionCullEntities(camera, m_visible_entities);
+    }
 
+    for (const auto *entity : m_visible_entities) {
         main_camera_visible_mesh_nodes.emplace_back();
         RenderNode &node = main_camera_visible_mesh_nodes.back();
 
         node.model_matrix = entity->model_matrix;
+        node.ref_entity = entity;
 
         node.ref_mesh = resource.getEntityMesh(*entity);
         node.ref_material = resource.getEntityMaterial(*entity);
+        node.instance_index = entity->instance_slot;
+    }
+}
+
+void RenderScene::setCullSettings(const CullSettings &settings) {
+    m_cull_settings = settings;
+
+    // rebuild every visible node list on the next update
+    m_directional_light_visibility_epoch = 0;
+    m_point_lights_visibility_epoch = 0;
+    m_main_camera_visibility_epoch = 0;
+}
+
+void RenderScene::setSoftwareOcclusionCulling(bool enabled) {
+    if (m_software_occlusion_culling == enabled) {
+        return;
+    }
+
+    m_software_occlusion_culling = enabled;
+    visibility_statistics.main_camera_software_occluder_count = 0;
+    visibility_statistics.main_camera_software_occluded_count = 0;
+    // rebuild the main camera nodes on the next update
+    m_main_camera_visibility_epoch = 0;
+}
+
+void RenderScene::setGpuDrivenCulling(bool enabled) {
+    if (m_gpu_driven_culling == enabled) {
+        return;
+    }
+
+    m_gpu_driven_culling = enabled;
+
+    directional_light_visible_mesh_nodes.clear();
+    point_lights_visible_mesh_nodes.clear();
+    main_camera_visible_mesh_nodes.clear();
+    ++directional_light_visible_mesh_nodes_version;
+    ++point_lights_visible_mesh_nodes_version;
+    ++main_camera_visible_mesh_nodes_version;
+    main_camera_occluded_entities.clear();
+
+    m_directional_light_visibility_epoch = 0;
+    m_point_lights_visibility_epoch = 0;
+    m_main_camera_visibility_epoch = 0;
+}
+
+void RenderScene::frustumCullEntities(
+    const Frustum &frustum, std::vector<const RenderEntity *> &visible_entities
+) {
+    visible_entities.clear();
+
+    // the tree only holds fattened bounds, test the candidates exactly in one batch
+    m_cull_candidates.clear();
+    m_cull_bounds.clear();
+    m_entity_bvh.query(
+        [&frustum](const AxisAlignedBoundingBox &aabb) {
+            return frustum.intersect(aabb);
+        },
+        [this](void *user_data) {
+            const auto *entity = static_cast<const RenderEntity *>(user_data);
+            m_cull_candidates.push_back(entity);
+            m_cull_bounds.push_back(entity->world_aabb);
+        }
+    );
+
+    frustum.intersect(m_cull_bounds, m_cull_visibility);
+
+    for (size_t i = 0; i < m_cull_candidates.size(); ++i) {
+        if (m_cull_visibility[i / 64] & (uint64_t{1} << (i % 64))) {
+            visible_entities.push_back(m_cull_candidates[i]);
+        }
     }
 }
 
+void RenderScene::removeNonResidentEntities(
+    const RenderResource &resource, std::vector<const RenderEntity *> &entities
+) const {
+    entities.erase(
+        std::remove_if(
+            entities.begin(),
+            entities.end(),
+            [&](const RenderEntity *entity) { return !resource.entityResident(*entity); }
+        ),
+        entities.end()
+    );
+}
+
+void RenderScene::receiverCullShadowCasters(
+    const RenderCamera &camera, std::vector<const RenderEntity *> &casters
+) {
+    visibility_statistics.directional_light_receiver_culled_count = 0;
+
+    float light_direction_length = glm::length(directional_light.direction);
+    if (m_scene_bounding_box.empty() || light_direction_length == 0.0f) {
+        return;
+    }
+
+    glm::vec3 shadow_direction = -directional_light.direction / light_direction_length;
+    Frustum camera_frustum{
+        camera.projection() * camera.view(), -1.0, 1.0, -1.0, 1.0, 0.0, 1.0
+    };
+
+    size_t caster_count = casters.size();
+    casters.erase(
+        std::remove_if(
+            casters.begin(),
+            casters.end(),
+            [&](const RenderEntity *caster) {
+                const AxisAlignedBoundingBox &aabb = caster->world_aabb;
+
+                // receivers are inside the scene bounds, so the shadow can stop where
+                // the caster leaves them, grown by the caster extent to stay conservative
+                glm::vec3 scene_min = m_scene_bounding_box.minCorner() - aabb.half_extent;
+                glm::vec3 scene_max = m_scene_bounding_box.maxCorner() + aabb.half_extent;
+                float shadow_length = std::numeric_limits<float>::max();
+                for (int i = 0; i < 3; ++i) {
+                    if (shadow_direction[i] > 0.0f) {
+                        shadow_length = std::min(
+                            shadow_length,
+                            (scene_max[i] - aabb.center[i]) / shadow_direction[i]
+                        );
+                    } else if (shadow_direction[i] < 0.0f) {
+                        shadow_length = std::min(
+                            shadow_length,
+                            (scene_min[i] - aabb.center[i]) / shadow_direction[i]
+                        );
+                    }
+                }
+                shadow_length = std::max(shadow_length, 0.0f);
+
+                return !camera_frustum.intersectSwept(
+                    aabb, shadow_direction * shadow_length
+                );
+            }
+        ),
+        casters.end()
+    );
+
+    visibility_statistics.directional_light_receiver_culled_count =
+        static_cast<uint32_t>(caster_count - casters.size());
+}
+
+void RenderScene::softwareOcclusionCullEntities(
+    const RenderCamera &camera, std::vector<const RenderEntity *> &visible_entities
+) {
+    if (!m_software_occlusion_culler) {
+        m_software_occlusion_culler = std::make_unique<SoftwareOcclusionCuller>(
+            g_runtime_global_context.thread_pool.get()
+        );
+    }
+
+    // the entities covering the most screen make the best occluders
+    m_occluder_candidates.clear();
+    for (const auto *entity : visible_entities) {
+        if (!entity->occluder) {
+            continue;
+        }
+
+        float radius = glm::length(entity->world_aabb.half_extent);
+        float distance = glm::length(entity->world_aabb.center - camera.position);
+        float screen_ratio = radius / std::max(distance, 1e-3f);
+        if (screen_ratio >= k_min_software_occluder_screen_ratio) {
+            m_occluder_candidates.emplace_back(screen_ratio, entity);
+        }
+    }
+
+    size_t occluder_count =
+        std::min<size_t>(m_occluder_candidates.size(), k_max_software_occluder_count);
+    std::partial_sort(
+        m_occluder_candidates.begin(),
+        m_occluder_candidates.begin() + occluder_count,
+        m_occluder_candidates.end(),
+        [](const auto &a, const auto &b) { return a.first > b.first; }
+    );
+
+    m_software_occlusion_culler->beginFrame(camera.projection() * camera.view());
+    for (size_t i = 0; i < occluder_count; ++i) {
+        const RenderEntity *entity = m_occluder_candidates[i].second;
+        m_software_occlusion_culler->addOccluder(*entity->occluder, entity->model_matrix);
+    }
+    m_software_occlusion_culler->rasterize();
+
+    size_t frustum_visible_count = visible_entities.size();
+    visible_entities.erase(
+        std::remove_if(
+            visible_entities.begin(),
+            visible_entities.end(),
+            [this](const RenderEntity *entity) {
+                return !m_software_occlusion_culler->visible(entity->world_aabb);
+            }
+        ),
+        visible_entities.end()
+    );
+
+    visibility_statistics.main_camera_software_occluder_count = occluder_count;
+    visibility_statistics.main_camera_software_occluded_count =
+        frustum_visible_count - visible_entities.size();
+}
+
 glm::mat4 calculateDirectionalLightView(
-    const RenderScene &scene, const RenderCamera &camera
+    const RenderScene &scene, const RenderCamera &camera, glm::mat4 &light_proj
 ) {
     glm::mat4 proj_view_matrix = camera.projection() * camera.view();
 
@@ -128,13 +665,9 @@ glm::mat4 calculateDirectionalLightView(
         }
     }
 
-    AxisAlignedBoundingBox scene_bounding_box;
-    for (const auto &entity : scene.render_entities) {
-        auto mesh_bounding_box = boundingBoxTransform(entity->aabb, entity->model_matrix);
-        scene_bounding_box.merge(mesh_bounding_box);
-    }
+    const AxisAlignedBoundingBox &scene_bounding_box = scene.getSceneBoundingBox();
 
-    glm::mat4 light_proj{1.0}, light_view{1.0};
+    glm::mat4 light_view{1.0};
     {
         float extent_len = frustum_bounding_box.half_extent.length();
         glm::vec3 eye =
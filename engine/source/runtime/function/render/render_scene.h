@@ -9,6 +9,8 @@
 
 namespace Vain {
 
+class Frustum;
+class SoftwareOcclusionCuller;
 class MeshResource;
 class PBRMaterialResource;
 class RenderCamera;
@@ -16,8 +18,46 @@ class RenderResource;
 
 struct RenderNode {
     glm::mat4 model_matrix{1.0};
+    const RenderEntity *ref_entity{};
     const MeshResource *ref_mesh{};
     const PBRMaterialResource *ref_material{};
+    // bit i set if the node overlaps point light i, only for point light nodes
+    uint32_t point_light_mask{};
+    // instance table slot of the entity
+    uint32_t instance_index{};
+};
+
+// small or far entities are dropped from a view, 0 disables a threshold
+struct ViewCullSettings {
+    // projected bounding sphere diameter over the view height
+    float min_screen_coverage{0.0f};
+    // distance from the main camera to the entity bounds
+    float max_draw_distance{0.0f};
+
+    bool enabled() const {
+        return min_screen_coverage > 0.0f || max_draw_distance > 0.0f;
+    }
+};
+
+struct CullSettings {
+    ViewCullSettings main_camera{};
+    // shadow casters usually stand more aggressive thresholds than the main view
+    ViewCullSettings directional_light_shadow{};
+    ViewCullSettings point_light_shadow{};
+};
+
+struct VisibilityStatistics {
+    uint32_t main_camera_contribution_culled_count{};
+    uint32_t directional_light_contribution_culled_count{};
+    // casters whose shadow can't reach anything the main camera sees
+    uint32_t directional_light_receiver_culled_count{};
+    // counted once per light an entity is dropped from
+    uint32_t point_lights_contribution_culled_count{};
+    uint32_t main_camera_frustum_visible_count{};
+    uint32_t main_camera_software_occluder_count{};
+    uint32_t main_camera_software_occluded_count{};
+    // from the latest occlusion readback, a few frames old
+    uint32_t main_camera_occluded_count{};
 };
 
 class RenderScene {
@@ -34,26 +74,130 @@ class RenderScene {
     std::vector<RenderNode> directional_light_visible_mesh_nodes{};
     std::vector<RenderNode> point_lights_visible_mesh_nodes{};
     std::vector<RenderNode> main_camera_visible_mesh_nodes{};
+    // bumped whenever the matching node list is rebuilt
+    uint64_t directional_light_visible_mesh_nodes_version{};
+    uint64_t point_lights_visible_mesh_nodes_version{};
+    uint64_t main_camera_visible_mesh_nodes_version{};
+
+    // the persistent instance table, one slot per entity, kept dense by moving the
+    // last entity into the slot of a removed one
+    std::vector<RenderEntity *> instance_entities{};
+    // slots whose entity moved or changed since clearDirtyInstanceSlots, may hold
+    // slots past the end of the table
+    std::vector<uint32_t> dirty_instance_slots{};
+
+    // main camera nodes of these entities are skipped, filled by the occlusion cull pass
+    std::unordered_set<const RenderEntity *> main_camera_occluded_entities{};
 
-    RenderScene() = default;
+    VisibilityStatistics visibility_statistics{};
+
+    RenderScene();
     ~RenderScene();
 
     void clear();
 
+    void addEntity(const std::shared_ptr<RenderEntity> &entity);
+    void removeEntity(const std::shared_ptr<RenderEntity> &entity);
+    // call after the model matrix of the entity changed
+    void updateEntity(RenderEntity &entity);
+
     void updateVisibleNodes(RenderResource &resource, RenderCamera &camera);
+    // entities stay out of every view until their mesh and material are resident, call
+    // after the uploads of the resource were updated to bring them in
+    void refreshUploadedEntities(const RenderResource &resource);
+
+    void clearDirtyInstanceSlots();
 
     void clearForReloading();
 
+    uint64_t entityEpoch() const { return m_entity_epoch; }
+    // epoch of the last removal, pointers to entities kept from before may dangle
+    uint64_t entityRemovalEpoch() const { return m_entity_removal_epoch; }
+
+    const AxisAlignedBoundingBox &getSceneBoundingBox() const {
+        return m_scene_bounding_box;
+    }
+
+    const CullSettings &getCullSettings() const { return m_cull_settings; }
+    void setCullSettings(const CullSettings &settings);
+
+    bool softwareOcclusionCulling() const { return m_software_occlusion_culling; }
+    void setSoftwareOcclusionCulling(bool enabled);
+
+    // the gpu cull pass culls the whole instance table and writes the indirect draws,
+    // the visible node lists stay empty
+    bool gpuDrivenCulling() const { return m_gpu_driven_culling; }
+    void setGpuDrivenCulling(bool enabled);
+
   private:
+    BoundingVolumeHierarchy m_entity_bvh{};
+
+    // grows in place, rebuilt lazily once an entity on its boundary moves or leaves
+    AxisAlignedBoundingBox m_scene_bounding_box{};
+    bool m_scene_bounding_box_dirty{false};
+
+    // bumped whenever an entity is added, removed or moved
+    uint64_t m_entity_epoch{1};
+    uint64_t m_entity_removal_epoch{0};
+
+    // inputs the visible node lists were last built from, the lists are reused
+    // while these still match
+    uint64_t m_directional_light_visibility_epoch{0};
+    glm::mat4 m_directional_light_visibility_proj_view{};
+    glm::mat4 m_directional_light_visibility_camera_proj_view{};
+    uint64_t m_point_lights_visibility_epoch{0};
+    std::vector<glm::vec4> m_point_lights_visibility_position_and_radius{};
+    glm::vec3 m_point_lights_visibility_camera_position{};
+    uint64_t m_main_camera_visibility_epoch{0};
+    glm::mat4 m_main_camera_visibility_proj_view{};
+
+    std::vector<bool> m_instance_slot_dirty{};
+
+    // scratch buffers reused across frames
+    std::vector<const RenderEntity *> m_visible_entities{};
+    std::vector<const RenderEntity *> m_cull_candidates{};
+    AxisAlignedBoundingBoxArray m_cull_bounds{};
+    std::vector<uint64_t> m_cull_visibility{};
+    // entity and the mask of the point light lighting it
+    using LitEntity = std::pair<const RenderEntity *, uint32_t>;
+    std::vector<LitEntity> m_lit_entities{};
+
+    CullSettings m_cull_settings{};
+
+    // cpu alternative to the gpu occlusion cull pass, drops main camera entities
+    // hidden behind the largest on screen occluders
+    bool m_software_occlusion_culling{false};
+    std::unique_ptr<SoftwareOcclusionCuller> m_software_occlusion_culler{};
+    std::vector<std::pair<float, const RenderEntity *>> m_occluder_candidates{};
+
+    bool m_gpu_driven_culling{false};
+
+    void updateSceneBoundingBox();
+
     void updateVisibleNodesDirectionalLight(
         RenderResource &resource, RenderCamera &camera
     );
     void updateVisibleNodesPointLights(RenderResource &resource, RenderCamera &camera);
     void updateVisibleNodesMainCamera(RenderResource &resource, RenderCamera &camera);
+    void markInstanceSlotDirty(uint32_t slot);
+
+    void frustumCullEntities(
+        const Frustum &frustum, std::vector<const RenderEntity *> &visible_entities
+    );
+    void removeNonResidentEntities(
+        const RenderResource &resource, std::vector<const RenderEntity *> &entities
+    ) const;
+    void receiverCullShadowCasters(
+        const RenderCamera &camera, std::vector<const RenderEntity *> &casters
+    );
+    void softwareOcclusionCullEntities(
+        const RenderCamera &camera, std::vector<const RenderEntity *> &visible_entities
+    );
 };
 
+// returns the proj view of the light, light_proj is its projection alone
 glm::mat4 calculateDirectionalLightView(
-    const RenderScene &scene, const RenderCamera &camera
+    const RenderScene &scene, const RenderCamera &camera, glm::mat4 &light_proj
 );
 
 }  // namespace Vain
\ No newline at end of file
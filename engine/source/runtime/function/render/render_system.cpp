@@ -1,7 +1,9 @@
 #include "render_system.h"
 
 #include <algorithm>
+#include <chrono>
 
+#include "core/base/thread_pool.h"
 #include "function/global/global_context.h"
 #include "function/render/window_system.h"
 #include "resource/asset_manager.h"
@@ -67,6 +69,14 @@ void RenderSystem::initialize(WindowSystem *window_system) {
     };
     m_main_pass->initialize(&main_pass_info);
 
+    m_occlusion_cull_pass = std::make_unique<OcclusionCullPass>();
+    RenderPassInitInfo occlusion_cull_pass_info{m_ctx.get(), m_render_resource.get()};
+    m_occlusion_cull_pass->initialize(&occlusion_cull_pass_info);
+
+    m_gpu_cull_pass = std::make_unique<GpuCullPass>();
+    RenderPassInitInfo gpu_cull_pass_info{m_ctx.get(), m_render_resource.get()};
+    m_gpu_cull_pass->initialize(&gpu_cull_pass_info);
+
     m_tone_mapping_pass = std::make_unique<ToneMappingPass>();
     ToneMappingPassInitInfo tone_mapping_pass_info{
         m_ctx.get(),
@@ -92,16 +102,27 @@ void RenderSystem::initialize(WindowSystem *window_system) {
     };
     m_combine_ui_pass->initialize(&combine_ui_pass_info);
 
-    m_render_resource->material_descriptor_set_layout =
-        m_main_pass->descriptor_set_layouts[MainPass::_layout_type_mesh_per_material];
+    m_render_resource->createMaterialsDescriptorSet(
+        m_main_pass->descriptor_set_layouts[MainPass::_layout_type_mesh_materials]
+    );
 }
 
 void RenderSystem::clear() {
+    // imports still running would outlive the asset manager
+    for (PendingSpawn &spawn : m_pending_spawns) {
+        if (spawn.import.valid()) {
+            spawn.import.wait();
+        }
+    }
+    m_pending_spawns.clear();
+
     vkDeviceWaitIdle(m_ctx->device);
 
     m_combine_ui_pass.reset();
     m_ui_pass.reset();
     m_tone_mapping_pass.reset();
+    m_gpu_cull_pass.reset();
+    m_occlusion_cull_pass.reset();
     m_main_pass.reset();
     m_directional_light_pass.reset();
     m_point_light_pass.reset();
@@ -120,6 +141,11 @@ void RenderSystem::initializeUIRenderBackend(WindowUI *window_ui) {
 }
 
 void RenderSystem::tick(float delta_time) {
+    updatePendingSpawns();
+
+    // entities whose uploads completed last frame, before their slots are counted
+    m_render_scene->refreshUploadedEntities(*m_render_resource);
+
     m_render_resource->updatePerFrame(*m_render_scene, *m_render_camera);
 
     m_render_scene->updateVisibleNodes(*m_render_resource, *m_render_camera);
@@ -128,28 +154,125 @@ void RenderSystem::tick(float delta_time) {
 }
 
 void RenderSystem::spawnObject(const std::string &url) {
+    if (cloneObject(url) != k_invalid_go_id) {
+        return;
+    }
+
     GameObject go;
     go.url = url;
-    go.name = std::filesystem::path{url}.filename().stem().generic_string();
+    go.load(*m_render_scene, *m_render_resource);
+    if (!go.loaded()) {
+        return;
+    }
+
+    addObject(go);
+}
+
+std::shared_future<GObjectID> RenderSystem::spawnObjectAsync(const std::string &url) {
+    PendingSpawn spawn{};
+    spawn.url = url;
+    std::shared_future<GObjectID> go_id = spawn.promise.get_future().share();
+
+    GObjectID clone_id = cloneObject(url);
+    if (clone_id != k_invalid_go_id) {
+        spawn.promise.set_value(clone_id);
+        return go_id;
+    }
+
+    // a url already being imported is cloned once the first spawn of it is added
+    bool importing = std::any_of(
+        m_pending_spawns.begin(),
+        m_pending_spawns.end(),
+        [&url](const PendingSpawn &pending) { return pending.url == url; }
+    );
+    if (!importing) {
+        spawn.import = g_runtime_global_context.thread_pool->submit([url]() {
+            return GameObject::import(url);
+        });
+    }
+
+    m_pending_spawns.push_back(std::move(spawn));
+    return go_id;
+}
 
+GObjectID RenderSystem::addObject(GameObject &go) {
+    go.name = std::filesystem::path{go.url}.filename().stem().generic_string() +
+              "::" + std::to_string(go.go_id);
+
+    m_url_go[go.url].insert(go.go_id);
+    m_gobjects[go.go_id] = go;
+
+    return go.go_id;
+}
+
+GObjectID RenderSystem::cloneObject(const std::string &url) {
     auto iter = m_url_go.find(url);
     if (iter == m_url_go.end()) {
-        go.load(*m_render_scene, *m_render_resource);
-        if (!go.loaded()) {
-            return;
+        return k_invalid_go_id;
+    }
+
+    GameObject go;
+    go.clone(m_gobjects[*(iter->second.begin())], *m_render_scene);
+    if (!go.loaded()) {
+        return k_invalid_go_id;
+    }
+
+    return addObject(go);
+}
+
+void RenderSystem::updatePendingSpawns() {
+    auto iter = m_pending_spawns.begin();
+    while (iter != m_pending_spawns.end()) {
+        PendingSpawn &spawn = *iter;
+
+        if (!spawn.import.valid() && !spawn.uploaded) {
+            GObjectID clone_id = cloneObject(spawn.url);
+            bool importing = std::any_of(
+                m_pending_spawns.begin(),
+                iter,
+                [&spawn](const PendingSpawn &pending) { return pending.url == spawn.url; }
+            );
+            // without an earlier spawn of the url its import failed
+            if (clone_id == k_invalid_go_id && importing) {
+                ++iter;
+                continue;
+            }
+
+            spawn.promise.set_value(clone_id);
+            iter = m_pending_spawns.erase(iter);
+            continue;
         }
 
-        m_url_go[url].insert(go.go_id);
-    } else {
-        auto url_set = iter->second;
+        if (spawn.import.valid()) {
+            if (spawn.import.wait_for(std::chrono::seconds{0}) !=
+                std::future_status::ready) {
+                ++iter;
+                continue;
+            }
+
+            std::shared_ptr<ImportedModel> model = spawn.import.get();
+            if (!model) {
+                spawn.promise.set_value(k_invalid_go_id);
+                iter = m_pending_spawns.erase(iter);
+                continue;
+            }
+
+            spawn.gobject.instantiate(*model, *m_render_scene, *m_render_resource);
+            spawn.uploaded = std::make_shared<bool>(false);
+            m_ctx->upload_batcher.enqueueCompletion([uploaded = spawn.uploaded]() {
+                *uploaded = true;
+            });
+        }
 
-        go.clone(m_gobjects[*(url_set.begin())], *m_render_scene);
+        if (!*spawn.uploaded) {
+            ++iter;
+            continue;
+        }
 
-        url_set.insert(go.go_id);
+        spawn.gobject.show();
+        spawn.promise.set_value(addObject(spawn.gobject));
+        iter = m_pending_spawns.erase(iter);
     }
-
-    go.name += "::" + std::to_string(go.go_id);
-    m_gobjects[go.go_id] = go;
 }
 
 std::vector<GameObject *> RenderSystem::getObjects() {
@@ -163,6 +286,7 @@ std::vector<GameObject *> RenderSystem::getObjects() {
 
 void RenderSystem::passUpdateAfterRecreateSwapchain() {
     m_main_pass->onResize();
+    m_occlusion_cull_pass->onResize();
     m_tone_mapping_pass->onResize(
         m_main_pass->framebuffer_info.attachments[_backup_buffer_odd].view
     );
@@ -173,11 +297,23 @@ void RenderSystem::passUpdateAfterRecreateSwapchain() {
 }
 
 void RenderSystem::render() {
-    m_render_resource->resetRingBufferOffset();
+    // the ring buffer can't grow once descriptors of the frame point into it, so the
+    // frame reserves everything it may allocate up front
+    VkDeviceSize ring_buffer_usage =
+        m_main_pass->ringBufferUsage(*m_render_scene) +
+        m_render_resource->gpu_scene.ringBufferUsage(*m_render_scene);
+    if (m_render_scene->gpuDrivenCulling()) {
+        ring_buffer_usage += m_gpu_cull_pass->ringBufferUsage(*m_render_scene);
+    }
+    m_render_resource->beginRingBufferFrame(ring_buffer_usage);
 
     m_ctx->waitForFlight();
 
+    m_occlusion_cull_pass->updateOcclusion(*m_render_scene);
+
     vkResetCommandPool(m_ctx->device, m_ctx->currentCommandPool(), 0);
+    m_ctx->resetSecondaryCommandPools();
+    m_ctx->resetTransientDescriptorPools();
 
     bool recreate_swapchain =
         m_ctx->prepareBeforePass([this]() { passUpdateAfterRecreateSwapchain(); });
@@ -185,6 +321,14 @@ void RenderSystem::render() {
         return;
     }
 
+    // finished uploads are acquired ahead of every pass of the frame
+    m_render_resource->updateUploads(m_ctx->currentCommandBuffer());
+
+    m_render_resource->gpu_scene.update(*m_render_scene);
+    if (m_render_scene->gpuDrivenCulling()) {
+        m_gpu_cull_pass->draw(*m_render_scene);
+    }
+
     m_directional_light_pass->draw(*m_render_scene);
     m_point_light_pass->draw(*m_render_scene);
 
@@ -198,6 +342,8 @@ void RenderSystem::render() {
         );
     }
 
+    m_occlusion_cull_pass->draw(*m_render_scene);
+
     m_ctx->submitRendering([this]() { passUpdateAfterRecreateSwapchain(); });
 }
 
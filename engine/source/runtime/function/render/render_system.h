@@ -1,11 +1,15 @@
 #pragma once
 
+#include <future>
+#include <list>
 #include <memory>
 
 #include "core/vulkan/vulkan_context.h"
 #include "function/render/passes/combine_ui_pass.h"
 #include "function/render/passes/directional_light_pass.h"
+#include "function/render/passes/gpu_cull_pass.h"
 #include "function/render/passes/main_pass.h"
+#include "function/render/passes/occlusion_cull_pass.h"
 #include "function/render/passes/point_light_pass.h"
 #include "function/render/passes/tone_mapping_pass.h"
 #include "function/render/passes/ui_pass.h"
@@ -40,9 +44,51 @@ class RenderSystem {
     RenderCamera *getRenderCamera() { return m_render_camera.get(); }
 
     void spawnObject(const std::string &url);
+    // imports on the thread pool and adds the object on the render thread once its
+    // uploads completed, the future holds k_invalid_go_id when the import failed
+    std::shared_future<GObjectID> spawnObjectAsync(const std::string &url);
+    uint32_t pendingSpawnCount() const {
+        return static_cast<uint32_t>(m_pending_spawns.size());
+    }
 
     std::vector<GameObject *> getObjects();
 
+    const VisibilityStatistics &getVisibilityStatistics() const {
+        return m_render_scene->visibility_statistics;
+    }
+
+    const CullSettings &getCullSettings() const {
+        return m_render_scene->getCullSettings();
+    }
+    void setCullSettings(const CullSettings &settings) {
+        m_render_scene->setCullSettings(settings);
+    }
+
+    bool softwareOcclusionCulling() const {
+        return m_render_scene->softwareOcclusionCulling();
+    }
+    void setSoftwareOcclusionCulling(bool enabled) {
+        m_render_scene->setSoftwareOcclusionCulling(enabled);
+    }
+
+    const FrameUploadBuffer &getFrameUploadBuffer() const {
+        return m_render_resource->frame_upload_buffer;
+    }
+
+    const TextureCacheStatistics &getTextureCacheStatistics() const {
+        return m_render_resource->textureCacheStatistics();
+    }
+
+    const UploadBatcher &getUploadBatcher() const { return m_ctx->upload_batcher; }
+    void setUploadFrameBudget(VkDeviceSize budget) {
+        m_ctx->upload_batcher.setFrameBudget(budget);
+    }
+
+    bool gpuDrivenCulling() const { return m_render_scene->gpuDrivenCulling(); }
+    void setGpuDrivenCulling(bool enabled) {
+        m_render_scene->setGpuDrivenCulling(enabled);
+    }
+
   private:
     std::unique_ptr<VulkanContext> m_ctx{};
     std::unique_ptr<RenderResource> m_render_resource{};
@@ -52,6 +98,8 @@ class RenderSystem {
     std::unique_ptr<PointLightPass> m_point_light_pass{};
     std::unique_ptr<DirectionalLightPass> m_directional_light_pass{};
     std::unique_ptr<MainPass> m_main_pass{};
+    std::unique_ptr<OcclusionCullPass> m_occlusion_cull_pass{};
+    std::unique_ptr<GpuCullPass> m_gpu_cull_pass{};
     std::unique_ptr<ToneMappingPass> m_tone_mapping_pass{};
     std::unique_ptr<UIPass> m_ui_pass{};
     std::unique_ptr<CombineUIPass> m_combine_ui_pass{};
@@ -59,6 +107,22 @@ class RenderSystem {
     std::unordered_map<std::string, std::unordered_set<GObjectID>> m_url_go{};
     std::unordered_map<GObjectID, GameObject> m_gobjects{};
 
+    struct PendingSpawn {
+        std::string url{};
+        // not valid for a spawn cloning the object of an earlier one of its url
+        std::future<std::shared_ptr<ImportedModel>> import{};
+        GameObject gobject{};
+        // set by the upload batcher once the uploads of gobject completed
+        std::shared_ptr<bool> uploaded{};
+        std::promise<GObjectID> promise{};
+    };
+    // in spawn order
+    std::list<PendingSpawn> m_pending_spawns{};
+
+    GObjectID addObject(GameObject &go);
+    GObjectID cloneObject(const std::string &url);
+    void updatePendingSpawns();
+
     void passUpdateAfterRecreateSwapchain();
 
     void render();
@@ -16,7 +16,6 @@ namespace Vain {
 static const uint32_t k_point_light_shadow_map_dimension = 2048;
 static const uint32_t k_directional_light_shadow_map_dimension = 4096;
 
-static uint32_t const k_mesh_per_drawcall_max_instance_count = 64;
 static uint32_t const k_max_point_light_count = 15;
 
 struct MeshVertex {
@@ -63,15 +62,24 @@ struct MeshPerFrameStorageBufferObject {
     glm::mat4 directional_light_proj_view{};
 };
 
+// element of the persistent instance table, one per scene entity, the model matrix is
+// affine so only its top three rows are stored
 struct MeshInstance {
-    glm::mat4 model_matrix{};
-};
-
-struct MeshPerDrawcallStorageBufferObject {
-    MeshInstance mesh_instances[k_mesh_per_drawcall_max_instance_count]{};
+    float model_rows[12]{};
+    uint32_t material_index{};
+
+    void setModelMatrix(const glm::mat4 &model_matrix) {
+        for (uint32_t row = 0; row < 3; ++row) {
+            for (uint32_t column = 0; column < 4; ++column) {
+                model_rows[row * 4 + column] = model_matrix[column][row];
+            }
+        }
+    }
 };
 
-struct MeshPerMaterialUniformBufferObject {
+// one element of the bindless materials storage buffer, textures are indices into the
+// bindless texture array
+struct MeshMaterial {
     glm::vec4 base_color_factor{};
 
     float metallic_factor{};
@@ -82,6 +90,14 @@ struct MeshPerMaterialUniformBufferObject {
     glm::vec3 emissive_factor{};
     uint32_t is_blend{};
     uint32_t is_double_sided{};
+
+    uint32_t base_color_texture_index{};
+    uint32_t metallic_roughness_texture_index{};
+    uint32_t normal_texture_index{};
+    uint32_t occlusion_texture_index{};
+    uint32_t emissive_texture_index{};
+    uint32_t _padding_emissive_texture_index_1{};
+    uint32_t _padding_emissive_texture_index_2{};
 };
 
 struct DirectionalLightShadowPerFrameStorageBufferObject {
@@ -96,6 +112,55 @@ struct PointLightShadowPerFrameStorageBufferObject {
     glm::vec4 point_lights_position_and_radius[k_max_point_light_count]{};
 };
 
+struct OcclusionCullCandidate {
+    glm::vec4 center{};
+    glm::vec4 half_extent{};
+};
+
+// bounds and mesh of one scene entity, tested by the gpu cull pass
+struct GpuCullObject {
+    glm::vec4 center{};
+    glm::vec4 half_extent{};
+    uint32_t mesh_draw_index{};
+    uint32_t _padding_mesh_draw_index_1{};
+    uint32_t _padding_mesh_draw_index_2{};
+    uint32_t _padding_mesh_draw_index_3{};
+};
+
+// one mesh of the gpu scene, its indirect command slot of every view and the first of
+// the index list elements reserved for its instances
+struct GpuCullMesh {
+    uint32_t index_count{};
+    uint32_t first_index{};
+    int32_t vertex_offset{};
+    uint32_t command_index{};
+    uint32_t instance_base{};
+    uint32_t _padding_instance_base_1{};
+    uint32_t _padding_instance_base_2{};
+    uint32_t _padding_instance_base_3{};
+};
+
+struct GpuCullPerFrameStorageBufferObject {
+    glm::vec4 main_camera_planes[6]{};
+    glm::vec4 directional_light_planes[6]{};
+    glm::vec4 point_lights_position_and_radius[k_max_point_light_count]{};
+    uint32_t object_count{};
+    uint32_t mesh_count{};
+    uint32_t mesh_capacity{};
+    uint32_t point_light_num{};
+    // first index list element of each view, the point light list has pairs
+    uint32_t view_instance_first[4]{};
+};
+
+// followed by candidate_count OcclusionCullCandidate
+struct OcclusionCullPerFrameStorageBufferObject {
+    glm::mat4 proj_view_matrix{};
+    uint32_t depth_pyramid_width{};
+    uint32_t depth_pyramid_height{};
+    uint32_t depth_pyramid_level_count{};
+    uint32_t candidate_count{};
+};
+
 }  // namespace Vain
 
 namespace std {
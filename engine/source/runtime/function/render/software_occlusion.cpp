@@ -0,0 +1,707 @@
+#include "software_occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "core/base/thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VAIN_SOFTWARE_OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Vain {
+
+// cells along each axis of the mesh bounds the inside is voxelized into
+static constexpr uint32_t k_occluder_grid_resolution = 16;
+static constexpr uint32_t k_occluder_max_box_count = 32;
+
+static constexpr uint32_t k_tile_count_x =
+    SoftwareOcclusionCuller::k_width / SoftwareOcclusionCuller::k_tile_width;
+static constexpr uint32_t k_tile_count_y =
+    SoftwareOcclusionCuller::k_height / SoftwareOcclusionCuller::k_tile_height;
+static constexpr uint32_t k_block_count_x =
+    SoftwareOcclusionCuller::k_width / SoftwareOcclusionCuller::k_block_size;
+static constexpr uint32_t k_block_count_y =
+    SoftwareOcclusionCuller::k_height / SoftwareOcclusionCuller::k_block_size;
+
+static_assert(SoftwareOcclusionCuller::k_tile_width % 4 == 0, "spans are 4 wide");
+static_assert(
+    SoftwareOcclusionCuller::k_tile_width % SoftwareOcclusionCuller::k_block_size == 0 &&
+        SoftwareOcclusionCuller::k_tile_height % SoftwareOcclusionCuller::k_block_size ==
+            0,
+    "blocks must not straddle tiles"
+);
+
+// every edge of a closed mesh, welded by position, is shared by exactly two triangles
+static bool closedMesh(
+    const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices
+) {
+    std::unordered_map<uint64_t, uint32_t> edge_counts;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (size_t j = 0; j < 3; ++j) {
+            uint32_t a = indices[i + j];
+            uint32_t b = indices[i + (j + 1) % 3];
+            uint64_t key = (uint64_t{std::min(a, b)} << 32) | std::max(a, b);
+            ++edge_counts[key];
+        }
+    }
+
+    for (const auto &[key, count] : edge_counts) {
+        if (count != 2) {
+            return false;
+        }
+    }
+    return !edge_counts.empty();
+}
+
+// separating axis test, a degenerate axis never separates so the test errs on overlap
+static bool triangleOverlapsBox(
+    const glm::vec3 triangle[3], const glm::vec3 &center, const glm::vec3 &half_extent
+) {
+    glm::vec3 v[3] = {triangle[0] - center, triangle[1] - center, triangle[2] - center};
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float min_v = std::min(v[0][axis], std::min(v[1][axis], v[2][axis]));
+        float max_v = std::max(v[0][axis], std::max(v[1][axis], v[2][axis]));
+        if (min_v > half_extent[axis] || max_v < -half_extent[axis]) {
+            return false;
+        }
+    }
+
+    glm::vec3 edges[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+    glm::vec3 normal = glm::cross(edges[0], edges[1]);
+    if (std::abs(glm::dot(normal, v[0])) > glm::dot(half_extent, glm::abs(normal))) {
+        return false;
+    }
+
+    for (const glm::vec3 &edge : edges) {
+        for (int axis = 0; axis < 3; ++axis) {
+            glm::vec3 unit{0.0f};
+            unit[axis] = 1.0f;
+            glm::vec3 separating = glm::cross(unit, edge);
+
+            float p0 = glm::dot(separating, v[0]);
+            float p1 = glm::dot(separating, v[1]);
+            float p2 = glm::dot(separating, v[2]);
+            float radius = glm::dot(half_extent, glm::abs(separating));
+            if (std::min(p0, std::min(p1, p2)) > radius ||
+                std::max(p0, std::max(p1, p2)) < -radius) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// parity of the triangles a ray crosses, odd inside a closed mesh
+static bool rayCrossesOddly(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &indices,
+    const glm::vec3 &origin,
+    const glm::vec3 &direction
+) {
+    bool odd = false;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3 &a = positions[indices[i]];
+        glm::vec3 ab = positions[indices[i + 1]] - a;
+        glm::vec3 ac = positions[indices[i + 2]] - a;
+
+        glm::vec3 p = glm::cross(direction, ac);
+        float determinant = glm::dot(ab, p);
+        if (std::abs(determinant) < 1e-12f) {
+            continue;
+        }
+        float inv_determinant = 1.0f / determinant;
+
+        glm::vec3 t = origin - a;
+        float u = glm::dot(t, p) * inv_determinant;
+        if (u < 0.0f || u > 1.0f) {
+            continue;
+        }
+        glm::vec3 q = glm::cross(t, ab);
+        float v = glm::dot(direction, q) * inv_determinant;
+        if (v < 0.0f || u + v > 1.0f) {
+            continue;
+        }
+        if (glm::dot(ac, q) * inv_determinant > 0.0f) {
+            odd = !odd;
+        }
+    }
+    return odd;
+}
+
+std::shared_ptr<OccluderMesh> buildOccluderMesh(const MeshData &data) {
+    if (data.indices.size() < 3 || data.aabb.empty() ||
+        glm::any(glm::lessThanEqual(data.aabb.half_extent, glm::vec3{0.0f}))) {
+        return nullptr;
+    }
+
+    // split vertices of uv and normal seams share a position
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    {
+        std::unordered_map<glm::vec3, uint32_t> position_to_index;
+        std::vector<uint32_t> remap(data.vertices.size());
+        for (size_t i = 0; i < data.vertices.size(); ++i) {
+            auto [iter, inserted] = position_to_index.emplace(
+                data.vertices[i].position, uint32_t(positions.size())
+            );
+            if (inserted) {
+                positions.push_back(data.vertices[i].position);
+            }
+            remap[i] = iter->second;
+        }
+
+        for (size_t i = 0; i + 2 < data.indices.size(); i += 3) {
+            uint32_t a = remap[data.indices[i]];
+            uint32_t b = remap[data.indices[i + 1]];
+            uint32_t c = remap[data.indices[i + 2]];
+            if (a == b || b == c || c == a) {
+                continue;
+            }
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    }
+
+    // only a closed mesh has an inside the proxy can stay within
+    if (!closedMesh(positions, indices)) {
+        return nullptr;
+    }
+
+    constexpr int32_t resolution = int32_t(k_occluder_grid_resolution);
+    glm::vec3 min_corner = data.aabb.minCorner();
+    glm::vec3 cell_size = data.aabb.half_extent * 2.0f / float(resolution);
+    auto cell_index = [&](int32_t x, int32_t y, int32_t z) {
+        return x + resolution * (y + resolution * z);
+    };
+
+    // cells touching a triangle, grown a little so rounding never misses one
+    enum CellState : uint8_t { CELL_FREE, CELL_SURFACE, CELL_INSIDE, CELL_USED };
+    std::vector<uint8_t> cells(resolution * resolution * resolution, CELL_FREE);
+    glm::vec3 cell_half_extent = cell_size * (0.5f + 1e-3f);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 triangle[3] = {
+            positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]
+        };
+        glm::vec3 lo_corner = glm::min(triangle[0], glm::min(triangle[1], triangle[2]));
+        glm::vec3 hi_corner = glm::max(triangle[0], glm::max(triangle[1], triangle[2]));
+        glm::ivec3 lo = glm::clamp(
+            glm::ivec3{glm::floor((lo_corner - min_corner) / cell_size)} - 1,
+            glm::ivec3{0},
+            glm::ivec3{resolution - 1}
+        );
+        glm::ivec3 hi = glm::clamp(
+            glm::ivec3{glm::floor((hi_corner - min_corner) / cell_size)} + 1,
+            glm::ivec3{0},
+            glm::ivec3{resolution - 1}
+        );
+
+        for (int32_t z = lo.z; z <= hi.z; ++z) {
+            for (int32_t y = lo.y; y <= hi.y; ++y) {
+                for (int32_t x = lo.x; x <= hi.x; ++x) {
+                    uint8_t &cell = cells[cell_index(x, y, z)];
+                    if (cell == CELL_SURFACE) {
+                        continue;
+                    }
+                    glm::vec3 center =
+                        min_corner + (glm::vec3{x, y, z} + 0.5f) * cell_size;
+                    if (triangleOverlapsBox(triangle, center, cell_half_extent)) {
+                        cell = CELL_SURFACE;
+                    }
+                }
+            }
+        }
+    }
+
+    // free cells connected without crossing the surface are all inside or all outside.
+    // a component is inside only if rays from several of its cells along different
+    // directions all cross the mesh an odd number of times, so an enclosed cavity like
+    // a sealed room, which an even number of walls surrounds, stays empty
+    const glm::vec3 directions[3] = {
+        glm::normalize(glm::vec3{1.0f, 0.3137f, 0.1743f}),
+        glm::normalize(glm::vec3{-0.2718f, 1.0f, 0.4142f}),
+        glm::normalize(glm::vec3{0.1618f, -0.5772f, 1.0f})
+    };
+    std::vector<int32_t> component;
+    std::vector<int32_t> stack;
+    for (int32_t seed = 0; seed < int32_t(cells.size()); ++seed) {
+        if (cells[seed] != CELL_FREE) {
+            continue;
+        }
+
+        component.clear();
+        stack.push_back(seed);
+        cells[seed] = CELL_USED;
+        while (!stack.empty()) {
+            int32_t index = stack.back();
+            stack.pop_back();
+            component.push_back(index);
+
+            int32_t x = index % resolution;
+            int32_t y = index / resolution % resolution;
+            int32_t z = index / (resolution * resolution);
+            const glm::ivec3 neighbors[6] = {
+                {x - 1, y, z}, {x + 1, y, z}, {x, y - 1, z},
+                {x, y + 1, z}, {x, y, z - 1}, {x, y, z + 1}
+            };
+            for (const glm::ivec3 &neighbor : neighbors) {
+                if (glm::any(glm::lessThan(neighbor, glm::ivec3{0})) ||
+                    glm::any(glm::greaterThanEqual(neighbor, glm::ivec3{resolution}))) {
+                    continue;
+                }
+                int32_t neighbor_index = cell_index(neighbor.x, neighbor.y, neighbor.z);
+                if (cells[neighbor_index] == CELL_FREE) {
+                    cells[neighbor_index] = CELL_USED;
+                    stack.push_back(neighbor_index);
+                }
+            }
+        }
+
+        bool inside = true;
+        for (int i = 0; i < 3 && inside; ++i) {
+            int32_t index = component[component.size() * i / 3];
+            glm::vec3 cell{
+                index % resolution,
+                index / resolution % resolution,
+                index / (resolution * resolution)
+            };
+            glm::vec3 center = min_corner + (cell + 0.5f) * cell_size;
+            inside = rayCrossesOddly(positions, indices, center, directions[i]);
+        }
+        if (inside) {
+            for (int32_t index : component) {
+                cells[index] = CELL_INSIDE;
+            }
+        }
+    }
+
+    // greedy boxes of inside cells, grown along x, then y, then z
+    struct CellBox {
+        glm::ivec3 lo{};
+        glm::ivec3 hi{};
+        int32_t volume{};
+    };
+    std::vector<CellBox> boxes;
+    auto inside_run = [&](int32_t x0, int32_t x1, int32_t y0, int32_t y1, int32_t z) {
+        for (int32_t y = y0; y < y1; ++y) {
+            for (int32_t x = x0; x < x1; ++x) {
+                if (cells[cell_index(x, y, z)] != CELL_INSIDE) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    for (int32_t z = 0; z < resolution; ++z) {
+        for (int32_t y = 0; y < resolution; ++y) {
+            for (int32_t x = 0; x < resolution; ++x) {
+                if (cells[cell_index(x, y, z)] != CELL_INSIDE) {
+                    continue;
+                }
+
+                glm::ivec3 hi{x + 1, y + 1, z + 1};
+                while (hi.x < resolution && inside_run(hi.x, hi.x + 1, y, y + 1, z)) {
+                    ++hi.x;
+                }
+                while (hi.y < resolution && inside_run(x, hi.x, hi.y, hi.y + 1, z)) {
+                    ++hi.y;
+                }
+                while (hi.z < resolution) {
+                    bool layer_inside = true;
+                    for (int32_t row = y; row < hi.y && layer_inside; ++row) {
+                        layer_inside = inside_run(x, hi.x, row, row + 1, hi.z);
+                    }
+                    if (!layer_inside) {
+                        break;
+                    }
+                    ++hi.z;
+                }
+
+                for (int32_t bz = z; bz < hi.z; ++bz) {
+                    for (int32_t by = y; by < hi.y; ++by) {
+                        for (int32_t bx = x; bx < hi.x; ++bx) {
+                            cells[cell_index(bx, by, bz)] = CELL_USED;
+                        }
+                    }
+                }
+                glm::ivec3 size = hi - glm::ivec3{x, y, z};
+                boxes.push_back({{x, y, z}, hi, size.x * size.y * size.z});
+            }
+        }
+    }
+    if (boxes.empty()) {
+        return nullptr;
+    }
+
+    // dropping boxes only uncovers pixels, the largest ones occlude the most
+    std::stable_sort(boxes.begin(), boxes.end(), [](const CellBox &a, const CellBox &b) {
+        return a.volume > b.volume;
+    });
+    boxes.resize(std::min<size_t>(boxes.size(), k_occluder_max_box_count));
+
+    // two triangles a face, corner i has bit 0 for x, 1 for y and 2 for z
+    static constexpr uint32_t k_box_indices[36] = {
+        0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5
+    };
+    auto occluder = std::make_shared<OccluderMesh>();
+    for (const CellBox &box : boxes) {
+        glm::vec3 lo = min_corner + glm::vec3{box.lo} * cell_size;
+        glm::vec3 hi = min_corner + glm::vec3{box.hi} * cell_size;
+        uint32_t base = uint32_t(occluder->vertices.size());
+        for (uint32_t corner = 0; corner < 8; ++corner) {
+            occluder->vertices.push_back(
+                {(corner & 1) ? hi.x : lo.x,
+                 (corner & 2) ? hi.y : lo.y,
+                 (corner & 4) ? hi.z : lo.z}
+            );
+        }
+        for (uint32_t index : k_box_indices) {
+            occluder->indices.push_back(base + index);
+        }
+    }
+
+    return occluder;
+}
+
+SoftwareOcclusionCuller::SoftwareOcclusionCuller(ThreadPool *thread_pool)
+    : m_thread_pool{thread_pool} {
+    m_depth.resize(k_width * k_height, 1.0f);
+    m_block_max_depth.resize(k_block_count_x * k_block_count_y, 1.0f);
+}
+
+void SoftwareOcclusionCuller::beginFrame(const glm::mat4 &proj_view_matrix) {
+    m_proj_view_matrix = proj_view_matrix;
+    m_occluders.clear();
+    m_triangles.clear();
+
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+    std::fill(m_block_max_depth.begin(), m_block_max_depth.end(), 1.0f);
+}
+
+void SoftwareOcclusionCuller::addOccluder(
+    const OccluderMesh &mesh, const glm::mat4 &model_matrix
+) {
+    m_occluders.push_back({&mesh, model_matrix});
+}
+
+void SoftwareOcclusionCuller::rasterize() {
+    if (m_occluder_triangles.size() < m_occluders.size()) {
+        m_occluder_triangles.resize(m_occluders.size());
+    }
+
+    auto transform_occluders = [this](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            transformOccluder(i);
+        }
+    };
+    auto rasterize_tiles = [this](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            rasterizeTile(i);
+        }
+    };
+
+    if (m_thread_pool) {
+        m_thread_pool->parallelFor(m_occluders.size(), 1, transform_occluders);
+    } else {
+        transform_occluders(0, m_occluders.size());
+    }
+
+    for (size_t i = 0; i < m_occluders.size(); ++i) {
+        const auto &triangles = m_occluder_triangles[i];
+        m_triangles.insert(m_triangles.end(), triangles.begin(), triangles.end());
+    }
+    if (m_triangles.empty()) {
+        return;
+    }
+
+    if (m_thread_pool) {
+        m_thread_pool->parallelFor(k_tile_count_x * k_tile_count_y, 1, rasterize_tiles);
+    } else {
+        rasterize_tiles(0, k_tile_count_x * k_tile_count_y);
+    }
+}
+
+void SoftwareOcclusionCuller::transformOccluder(uint32_t index) {
+    const Occluder &occluder = m_occluders[index];
+    std::vector<ScreenTriangle> &triangles = m_occluder_triangles[index];
+    triangles.clear();
+
+    glm::mat4 transform = m_proj_view_matrix * occluder.model_matrix;
+
+    const auto &vertices = occluder.mesh->vertices;
+    const auto &indices = occluder.mesh->indices;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec4 clip[3] = {
+            transform * glm::vec4{vertices[indices[i]], 1.0f},
+            transform * glm::vec4{vertices[indices[i + 1]], 1.0f},
+            transform * glm::vec4{vertices[indices[i + 2]], 1.0f}
+        };
+
+        // clip against the near plane z = 0, a triangle becomes at most a quad
+        glm::vec4 polygon[4];
+        uint32_t polygon_size = 0;
+        for (uint32_t j = 0; j < 3; ++j) {
+            const glm::vec4 &a = clip[j];
+            const glm::vec4 &b = clip[(j + 1) % 3];
+            if (a.z >= 0.0f) {
+                polygon[polygon_size++] = a;
+            }
+            if ((a.z >= 0.0f) != (b.z >= 0.0f)) {
+                polygon[polygon_size++] = glm::mix(a, b, a.z / (a.z - b.z));
+            }
+        }
+        if (polygon_size < 3) {
+            continue;
+        }
+
+        glm::vec3 screen[4];
+        for (uint32_t j = 0; j < polygon_size; ++j) {
+            glm::vec3 ndc = glm::vec3{polygon[j]} / std::max(polygon[j].w, 1e-6f);
+            screen[j].x = (ndc.x * 0.5f + 0.5f) * k_width;
+            screen[j].y = (ndc.y * 0.5f + 0.5f) * k_height;
+            screen[j].z = ndc.z;
+        }
+
+        for (uint32_t j = 1; j + 1 < polygon_size; ++j) {
+            ScreenTriangle triangle{};
+            triangle.vertices[0] = screen[0];
+            triangle.vertices[1] = screen[j];
+            triangle.vertices[2] = screen[j + 1];
+            glm::vec2 a{screen[0]};
+            glm::vec2 b{screen[j]};
+            glm::vec2 c{screen[j + 1]};
+            triangle.min = glm::min(a, glm::min(b, c));
+            triangle.max = glm::max(a, glm::max(b, c));
+
+            if (triangle.max.x < 0.0f || triangle.max.y < 0.0f ||
+                triangle.min.x >= k_width || triangle.min.y >= k_height) {
+                continue;
+            }
+
+            triangles.push_back(triangle);
+        }
+    }
+}
+
+void SoftwareOcclusionCuller::rasterizeTile(uint32_t tile) {
+    int32_t tile_x0 = (tile % k_tile_count_x) * k_tile_width;
+    int32_t tile_y0 = (tile / k_tile_count_x) * k_tile_height;
+    int32_t tile_x1 = tile_x0 + k_tile_width;
+    int32_t tile_y1 = tile_y0 + k_tile_height;
+
+    for (const auto &triangle : m_triangles) {
+        if (triangle.max.x < tile_x0 || triangle.max.y < tile_y0 ||
+            triangle.min.x >= tile_x1 || triangle.min.y >= tile_y1) {
+            continue;
+        }
+
+        const glm::vec3 &v0 = triangle.vertices[0];
+        const glm::vec3 &v1 = triangle.vertices[1];
+        const glm::vec3 &v2 = triangle.vertices[2];
+
+        // edge i runs from vertex i to vertex i + 1, e(x, y) = a * x + b * y + c. it is
+        // set up from its endpoints in a fixed order and negated, so that the triangles
+        // sharing an edge get exactly opposite values and leave no crack between them
+        float edge_a[3];
+        float edge_b[3];
+        float edge_c[3];
+        const glm::vec3 *corners[4] = {&v0, &v1, &v2, &v0};
+        for (int i = 0; i < 3; ++i) {
+            const glm::vec3 *from = corners[i];
+            const glm::vec3 *to = corners[i + 1];
+            bool flip = from->x > to->x || (from->x == to->x && from->y > to->y);
+            if (flip) {
+                std::swap(from, to);
+            }
+            float sign = flip ? -1.0f : 1.0f;
+            float a = to->y - from->y;
+            float b = from->x - to->x;
+            edge_a[i] = sign * a;
+            edge_b[i] = sign * b;
+            edge_c[i] = sign * -(a * from->x + b * from->y);
+        }
+
+        float area = edge_a[0] * v2.x + edge_b[0] * v2.y + edge_c[0];
+        if (std::abs(area) < 1e-6f) {
+            continue;
+        }
+        // no back face culling, the winding of occluders is not relied on
+        if (area < 0.0f) {
+            for (int i = 0; i < 3; ++i) {
+                edge_a[i] = -edge_a[i];
+                edge_b[i] = -edge_b[i];
+                edge_c[i] = -edge_c[i];
+            }
+            area = -area;
+        }
+
+        // depth plane from the barycentric weights, edge i is opposite vertex i + 2
+        float inv_area = 1.0f / area;
+        float depth_a = (edge_a[1] * v0.z + edge_a[2] * v1.z + edge_a[0] * v2.z);
+        float depth_b = (edge_b[1] * v0.z + edge_b[2] * v1.z + edge_b[0] * v2.z);
+        depth_a *= inv_area;
+        depth_b *= inv_area;
+        // through v0 rather than from the edge constants, which cancel badly on steep
+        // planes far from the origin
+        float depth_c = v0.z - depth_a * v0.x - depth_b * v0.y;
+        // the plane extrapolates badly across triangles seen edge on, keep it in range so
+        // an occluder never ends up nearer than it is
+        float min_depth = std::min(v0.z, std::min(v1.z, v2.z));
+        float max_depth = std::max(v0.z, std::max(v1.z, v2.z));
+
+        // clamp in float first, projected vertices near the camera can be far off screen
+        int32_t x0 = int32_t(std::floor(std::max(triangle.min.x, float(tile_x0)))) & ~3;
+        int32_t x1 = int32_t(std::ceil(std::min(triangle.max.x + 1.0f, float(tile_x1))));
+        int32_t y0 = int32_t(std::floor(std::max(triangle.min.y, float(tile_y0))));
+        int32_t y1 = int32_t(std::ceil(std::min(triangle.max.y + 1.0f, float(tile_y1))));
+
+        for (int32_t y = y0; y < y1; ++y) {
+            float center_y = y + 0.5f;
+            float *row = m_depth.data() + y * k_width;
+
+#ifdef VAIN_SOFTWARE_OCCLUSION_SSE
+            __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            __m128 row_edge[3];
+            __m128 step_edge[3];
+            for (int i = 0; i < 3; ++i) {
+                row_edge[i] = _mm_set1_ps(edge_b[i] * center_y + edge_c[i]);
+                step_edge[i] = _mm_set1_ps(edge_a[i]);
+            }
+            __m128 row_depth = _mm_set1_ps(depth_b * center_y + depth_c);
+            __m128 step_depth = _mm_set1_ps(depth_a);
+            __m128 depth_min = _mm_set1_ps(min_depth);
+            __m128 depth_max = _mm_set1_ps(max_depth);
+            __m128 zero = _mm_setzero_ps();
+
+            for (int32_t x = x0; x < x1; x += 4) {
+                __m128 center_x = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(step_edge[0], center_x), row_edge[0]);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(step_edge[1], center_x), row_edge[1]);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(step_edge[2], center_x), row_edge[2]);
+                __m128 inside = _mm_and_ps(
+                    _mm_cmpge_ps(e0, zero),
+                    _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero))
+                );
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+
+                __m128 depth = _mm_add_ps(_mm_mul_ps(step_depth, center_x), row_depth);
+                depth = _mm_max_ps(_mm_min_ps(depth, depth_max), depth_min);
+                __m128 stored = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(stored, depth);
+                _mm_storeu_ps(
+                    row + x,
+                    _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored))
+                );
+            }
+#else
+            for (int32_t x = x0; x < x1; ++x) {
+                float center_x = x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 3; ++i) {
+                    float edge = edge_a[i] * center_x + edge_b[i] * center_y + edge_c[i];
+                    inside &= edge >= 0.0f;
+                }
+                if (!inside) {
+                    continue;
+                }
+
+                float depth = depth_a * center_x + depth_b * center_y + depth_c;
+                depth = std::clamp(depth, min_depth, max_depth);
+                row[x] = std::min(row[x], depth);
+            }
+#endif
+        }
+    }
+
+    for (int32_t block_y = tile_y0; block_y < tile_y1; block_y += k_block_size) {
+        for (int32_t block_x = tile_x0; block_x < tile_x1; block_x += k_block_size) {
+            float max_depth = 0.0f;
+            for (int32_t y = block_y; y < block_y + int32_t(k_block_size); ++y) {
+                const float *row = m_depth.data() + y * k_width;
+                for (int32_t x = block_x; x < block_x + int32_t(k_block_size); ++x) {
+                    max_depth = std::max(max_depth, row[x]);
+                }
+            }
+
+            m_block_max_depth
+                [(block_y / k_block_size) * k_block_count_x + block_x / k_block_size] =
+                max_depth;
+        }
+    }
+}
+
+bool SoftwareOcclusionCuller::visible(const AxisAlignedBoundingBox &world_aabb) const {
+    if (m_triangles.empty()) {
+        return true;
+    }
+
+    glm::vec2 screen_min{std::numeric_limits<float>::max()};
+    glm::vec2 screen_max{std::numeric_limits<float>::lowest()};
+    float min_depth = std::numeric_limits<float>::max();
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 sign{
+            (i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f
+        };
+        glm::vec3 corner = world_aabb.center + world_aabb.half_extent * sign;
+        glm::vec4 clip = m_proj_view_matrix * glm::vec4{corner, 1.0f};
+        // crosses the camera plane
+        if (clip.w <= 1e-6f || clip.z < 0.0f) {
+            return true;
+        }
+
+        glm::vec3 ndc = glm::vec3{clip} / clip.w;
+        glm::vec2 screen{
+            (ndc.x * 0.5f + 0.5f) * k_width, (ndc.y * 0.5f + 0.5f) * k_height
+        };
+        screen_min = glm::min(screen_min, screen);
+        screen_max = glm::max(screen_max, screen);
+        min_depth = std::min(min_depth, ndc.z);
+    }
+
+    screen_min = glm::max(screen_min, glm::vec2{0.0f});
+    screen_max = glm::min(screen_max, glm::vec2{float(k_width), float(k_height)});
+    int32_t x0 = int32_t(std::floor(screen_min.x));
+    int32_t y0 = int32_t(std::floor(screen_min.y));
+    int32_t x1 = int32_t(std::ceil(screen_max.x));
+    int32_t y1 = int32_t(std::ceil(screen_max.y));
+    // off screen, leave it to the frustum test
+    if (x0 >= x1 || y0 >= y1) {
+        return true;
+    }
+
+    for (int32_t block_y = y0 / k_block_size; block_y * int32_t(k_block_size) < y1;
+         ++block_y) {
+        for (int32_t block_x = x0 / k_block_size; block_x * int32_t(k_block_size) < x1;
+             ++block_x) {
+            if (m_block_max_depth[block_y * k_block_count_x + block_x] < min_depth) {
+                continue;
+            }
+
+            int32_t px0 = std::max(x0, block_x * int32_t(k_block_size));
+            int32_t px1 = std::min(x1, (block_x + 1) * int32_t(k_block_size));
+            int32_t py0 = std::max(y0, block_y * int32_t(k_block_size));
+            int32_t py1 = std::min(y1, (block_y + 1) * int32_t(k_block_size));
+            for (int32_t y = py0; y < py1; ++y) {
+                const float *row = m_depth.data() + y * k_width;
+                for (int32_t x = px0; x < px1; ++x) {
+                    if (row[x] >= min_depth) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+}  // namespace Vain
\ No newline at end of file
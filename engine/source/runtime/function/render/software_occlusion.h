@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "core/math/aabb.h"
+#include "function/render/render_data.h"
+
+namespace Vain {
+
+class ThreadPool;
+
+// boxes of grid cells that lie wholly inside the mesh, so the proxy never covers a
+// pixel the mesh doesn't or sits in front of it. nullptr unless the mesh is closed and
+// thick enough to hold a cell
+std::shared_ptr<OccluderMesh> buildOccluderMesh(const MeshData &data);
+
+// rasterizes occluders into a small depth buffer on the cpu and tests bounding boxes
+// against it. tiles are owned by one thread each, so results don't depend on the
+// thread count
+class SoftwareOcclusionCuller {
+  public:
+    static constexpr uint32_t k_width = 256;
+    static constexpr uint32_t k_height = 128;
+    static constexpr uint32_t k_tile_width = 64;
+    static constexpr uint32_t k_tile_height = 32;
+    static constexpr uint32_t k_block_size = 8;
+
+    explicit SoftwareOcclusionCuller(ThreadPool *thread_pool = nullptr);
+
+    void beginFrame(const glm::mat4 &proj_view_matrix);
+    void addOccluder(const OccluderMesh &mesh, const glm::mat4 &model_matrix);
+    void rasterize();
+
+    // false only if the box lies behind the rasterized occluders everywhere
+    bool visible(const AxisAlignedBoundingBox &world_aabb) const;
+
+    size_t occluderCount() const { return m_occluders.size(); }
+    size_t triangleCount() const { return m_triangles.size(); }
+
+    const std::vector<float> &depthBuffer() const { return m_depth; }
+
+  private:
+    struct Occluder {
+        const OccluderMesh *mesh{};
+        glm::mat4 model_matrix{1.0f};
+    };
+
+    // x and y in pixels, z in [0, 1]
+    struct ScreenTriangle {
+        glm::vec3 vertices[3]{};
+        glm::vec2 min{};
+        glm::vec2 max{};
+    };
+
+    ThreadPool *m_thread_pool{};
+
+    glm::mat4 m_proj_view_matrix{1.0f};
+    std::vector<Occluder> m_occluders{};
+    // written per occluder in parallel, then concatenated
+    std::vector<std::vector<ScreenTriangle>> m_occluder_triangles{};
+    std::vector<ScreenTriangle> m_triangles{};
+
+    std::vector<float> m_depth{};
+    // farthest depth of every k_block_size square
+    std::vector<float> m_block_max_depth{};
+
+    void transformOccluder(uint32_t index);
+    void rasterizeTile(uint32_t tile);
+};
+
+}  // namespace Vain
\ No newline at end of file